@@ -0,0 +1,113 @@
+#include <string.h>
+#include <time.h>
+#include "adv-rotator.h"
+
+static int64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void plaintext(const adv_rotator *rotator, uint64_t slot, unsigned char *block)
+{
+    memcpy(block, rotator->identity, ADV_IDENTITY_SIZE);
+    for (int i = 0; i < 8; i++)
+        block[ADV_IDENTITY_SIZE + i] = (unsigned char)(slot >> (56 - 8 * i));
+}
+
+int adv_rotator_init(adv_rotator *rotator, const unsigned char *key, size_t keyLength,
+                     const unsigned char *identity, int64_t epochNs, int64_t intervalNs, size_t capacity)
+{
+    if (intervalNs <= 0 || capacity == 0)
+        return -1;
+    if (aes_context_init_key(&rotator->ctx, key, keyLength) != 0)
+        return -1;
+    memcpy(rotator->identity, identity, ADV_IDENTITY_SIZE);
+    rotator->epochNs = epochNs;
+    rotator->intervalNs = intervalNs;
+    rotator->capacity = capacity;
+    rotator->cache.assign(capacity * ADV_PAYLOAD_SIZE, 0);
+    rotator->staging.assign(capacity * ADV_PAYLOAD_SIZE, 0);
+    rotator->first = 0;
+    rotator->end = 0;
+    rotator->generated = 0;
+    rotator->generateNs = 0;
+    rotator->refills = 0;
+    rotator->hits = 0;
+    rotator->misses = 0;
+    return 0;
+}
+
+uint64_t adv_rotator_slot(const adv_rotator *rotator, int64_t timeNs)
+{
+    if (timeNs < rotator->epochNs)
+        return 0;
+    return (uint64_t)(timeNs - rotator->epochNs) / (uint64_t)rotator->intervalNs;
+}
+
+size_t adv_rotator_refill(adv_rotator *rotator, int64_t nowNs)
+{
+    uint64_t current = adv_rotator_slot(rotator, nowNs);
+    uint64_t stop = current + rotator->capacity;
+    uint64_t start;
+    {
+        std::lock_guard<std::mutex> guard(rotator->lock);
+        start = rotator->end > current ? rotator->end : current;
+    }
+    if (start >= stop)
+        return 0;
+
+    // the context is read-only, so the batch is encrypted while readers keep using the cache
+    size_t count = stop - start;
+    int64_t began = monotonic_ns();
+    for (size_t i = 0; i < count; i++)
+        plaintext(rotator, start + i, rotator->staging.data() + i * ADV_PAYLOAD_SIZE);
+    aes_context_encrypt(&rotator->ctx, rotator->staging.data(), count * ADV_PAYLOAD_SIZE);
+    int64_t took = monotonic_ns() - began;
+
+    std::lock_guard<std::mutex> guard(rotator->lock);
+    for (size_t i = 0; i < count; i++)
+        memcpy(rotator->cache.data() + (start + i) % rotator->capacity * ADV_PAYLOAD_SIZE,
+               rotator->staging.data() + i * ADV_PAYLOAD_SIZE, ADV_PAYLOAD_SIZE);
+    // after a gap (the refill was not called for a while) nothing older is contiguous
+    if (start > rotator->end)
+        rotator->first = start;
+    rotator->end = stop;
+    if (rotator->end - rotator->first > rotator->capacity)
+        rotator->first = rotator->end - rotator->capacity;
+    rotator->generated += count;
+    rotator->generateNs += took;
+    rotator->refills++;
+    return count;
+}
+
+int adv_rotator_payload(adv_rotator *rotator, uint64_t slot, unsigned char *out)
+{
+    {
+        std::lock_guard<std::mutex> guard(rotator->lock);
+        if (slot >= rotator->first && slot < rotator->end) {
+            memcpy(out, rotator->cache.data() + slot % rotator->capacity * ADV_PAYLOAD_SIZE, ADV_PAYLOAD_SIZE);
+            rotator->hits++;
+            return 1;
+        }
+        rotator->misses++;
+    }
+    plaintext(rotator, slot, out);
+    aes_context_encrypt(&rotator->ctx, out, ADV_PAYLOAD_SIZE);
+    return 0;
+}
+
+void adv_rotator_get_stats(adv_rotator *rotator, int64_t nowNs, adv_rotator_stats *stats)
+{
+    uint64_t current = adv_rotator_slot(rotator, nowNs);
+    std::lock_guard<std::mutex> guard(rotator->lock);
+    stats->generated = rotator->generated;
+    stats->generateNs = rotator->generateNs;
+    stats->refills = rotator->refills;
+    stats->hits = rotator->hits;
+    stats->misses = rotator->misses;
+    uint64_t from = rotator->first > current ? rotator->first : current;
+    stats->cached = rotator->end > from ? rotator->end - from : 0;
+    stats->payloadsPerSecond = rotator->generateNs > 0 ? rotator->generated * 1e9 / rotator->generateNs : 0;
+}
@@ -0,0 +1,63 @@
+#ifndef ADV_ROTATOR_H
+#define ADV_ROTATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+#include "aes-core.h"
+
+// rolling encrypted advertisement payloads for phones acting as test beacons
+// time is cut into slots of intervalNs from epochNs; the payload of a slot is one AES block
+//   AES_k(identity (8 bytes) || slot (u64 BE))
+// so a receiver holding the key decrypts it back to the identity and the slot it was sent in.
+// A background refill encrypts the slots ahead of now in one batch through the fast engine
+// into a ring cache, and the rotation itself only copies a cached block. A slot that is not
+// cached (the refill fell behind) is encrypted on the spot and counted as a miss.
+// Any number of threads may read payloads; one thread at a time refills.
+
+#define ADV_PAYLOAD_SIZE AES_BLOCK_SIZE
+#define ADV_IDENTITY_SIZE 8
+
+struct adv_rotator {
+    aes_context ctx;
+    unsigned char identity[ADV_IDENTITY_SIZE];
+    int64_t epochNs;
+    int64_t intervalNs;
+    size_t capacity;
+    std::vector<unsigned char> cache;   // capacity payloads, slot s at s % capacity
+    std::vector<unsigned char> staging; // refill batch, encrypted outside the lock
+    uint64_t first;                     // cached slots are [first, end)
+    uint64_t end;
+    std::mutex lock;
+    uint64_t generated;                 // payloads encrypted by refills
+    uint64_t generateNs;                // time spent encrypting them
+    uint64_t refills;
+    uint64_t hits;
+    uint64_t misses;
+};
+
+struct adv_rotator_stats {
+    uint64_t generated;
+    uint64_t generateNs;
+    uint64_t refills;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t cached;        // slots from now on that are ready
+    double payloadsPerSecond;
+};
+
+// keyLength 16, 24 or 32; returns -1 for a bad key length, intervalNs <= 0 or capacity 0
+int adv_rotator_init(adv_rotator *rotator, const unsigned char *key, size_t keyLength,
+                     const unsigned char *identity, int64_t epochNs, int64_t intervalNs, size_t capacity);
+// slot that timeNs falls in, 0 before the epoch
+uint64_t adv_rotator_slot(const adv_rotator *rotator, int64_t timeNs);
+// encrypts every slot from the one at nowNs up to capacity slots ahead that is not cached
+// yet; returns the payloads generated
+size_t adv_rotator_refill(adv_rotator *rotator, int64_t nowNs);
+// writes the payload of slot to out; returns 1 when it came from the cache, 0 when it had to
+// be encrypted here
+int adv_rotator_payload(adv_rotator *rotator, uint64_t slot, unsigned char *out);
+void adv_rotator_get_stats(adv_rotator *rotator, int64_t nowNs, adv_rotator_stats *stats);
+
+#endif //ADV_ROTATOR_H
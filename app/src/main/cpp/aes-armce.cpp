@@ -0,0 +1,84 @@
+#include "aes-core.h"
+#include "aes-rounds.h"
+
+// ARMv8 Crypto Extensions engine for arm64 devices
+// compiled with -march=armv8-a+crypto, only entered after HWCAP_AES was reported at runtime
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+
+template <int Rounds>
+static void armce_encrypt_blocks(const aes_context *ctx, unsigned char *data, size_t blocks)
+{
+    uint8x16_t rk[Rounds + 1];
+    for (int i = 0; i <= Rounds; i++)
+        rk[i] = vld1q_u8(ctx->expandedKey + i * AES_BLOCK_SIZE);
+    size_t b = 0;
+    // four independent blocks keep the aese/aesmc pairs fused and pipelined
+    for (; b + 4 <= blocks; b += 4, data += 4 * AES_BLOCK_SIZE) {
+        uint8x16_t s0 = vld1q_u8(data), s1 = vld1q_u8(data + 16);
+        uint8x16_t s2 = vld1q_u8(data + 32), s3 = vld1q_u8(data + 48);
+        aes_unroll<Rounds - 1>([&](auto round) {
+            s0 = vaesmcq_u8(vaeseq_u8(s0, rk[round]));
+            s1 = vaesmcq_u8(vaeseq_u8(s1, rk[round]));
+            s2 = vaesmcq_u8(vaeseq_u8(s2, rk[round]));
+            s3 = vaesmcq_u8(vaeseq_u8(s3, rk[round]));
+        });
+        vst1q_u8(data, veorq_u8(vaeseq_u8(s0, rk[Rounds - 1]), rk[Rounds]));
+        vst1q_u8(data + 16, veorq_u8(vaeseq_u8(s1, rk[Rounds - 1]), rk[Rounds]));
+        vst1q_u8(data + 32, veorq_u8(vaeseq_u8(s2, rk[Rounds - 1]), rk[Rounds]));
+        vst1q_u8(data + 48, veorq_u8(vaeseq_u8(s3, rk[Rounds - 1]), rk[Rounds]));
+    }
+    for (; b < blocks; b++, data += AES_BLOCK_SIZE) {
+        uint8x16_t s = vld1q_u8(data);
+        aes_unroll<Rounds - 1>([&](auto round) { s = vaesmcq_u8(vaeseq_u8(s, rk[round])); });
+        vst1q_u8(data, veorq_u8(vaeseq_u8(s, rk[Rounds - 1]), rk[Rounds]));
+    }
+}
+
+template <int Rounds>
+static void armce_decrypt_blocks(const aes_context *ctx, unsigned char *data, size_t blocks)
+{
+    uint8x16_t rk[Rounds + 1];
+    for (int i = 0; i <= Rounds; i++)
+        rk[i] = vld1q_u8(ctx->decryptKey + i * AES_BLOCK_SIZE);
+    size_t b = 0;
+    for (; b + 4 <= blocks; b += 4, data += 4 * AES_BLOCK_SIZE) {
+        uint8x16_t s0 = vld1q_u8(data), s1 = vld1q_u8(data + 16);
+        uint8x16_t s2 = vld1q_u8(data + 32), s3 = vld1q_u8(data + 48);
+        aes_unroll<Rounds - 1>([&](auto round) {
+            s0 = vaesimcq_u8(vaesdq_u8(s0, rk[round]));
+            s1 = vaesimcq_u8(vaesdq_u8(s1, rk[round]));
+            s2 = vaesimcq_u8(vaesdq_u8(s2, rk[round]));
+            s3 = vaesimcq_u8(vaesdq_u8(s3, rk[round]));
+        });
+        vst1q_u8(data, veorq_u8(vaesdq_u8(s0, rk[Rounds - 1]), rk[Rounds]));
+        vst1q_u8(data + 16, veorq_u8(vaesdq_u8(s1, rk[Rounds - 1]), rk[Rounds]));
+        vst1q_u8(data + 32, veorq_u8(vaesdq_u8(s2, rk[Rounds - 1]), rk[Rounds]));
+        vst1q_u8(data + 48, veorq_u8(vaesdq_u8(s3, rk[Rounds - 1]), rk[Rounds]));
+    }
+    for (; b < blocks; b++, data += AES_BLOCK_SIZE) {
+        uint8x16_t s = vld1q_u8(data);
+        aes_unroll<Rounds - 1>([&](auto round) { s = vaesimcq_u8(vaesdq_u8(s, rk[round])); });
+        vst1q_u8(data, veorq_u8(vaesdq_u8(s, rk[Rounds - 1]), rk[Rounds]));
+    }
+}
+
+const aes_engine *aes_engine_armce()
+{
+    static const aes_engine engine = {"armce", AES_KERNELS(armce_encrypt_blocks),
+                                      AES_KERNELS(armce_decrypt_blocks)};
+    static const bool supported = (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+    return supported ? &engine : NULL;
+}
+
+#else
+
+const aes_engine *aes_engine_armce()
+{
+    return NULL;
+}
+
+#endif
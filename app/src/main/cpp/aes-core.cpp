@@ -0,0 +1,528 @@
+#include <cstring>
+#include "aes-core.h"
+#include "aes-rounds.h"
+
+// GF(2^8) arithmetic modulo x^8 + x^4 + x^3 + x + 1, usable at compile time
+static constexpr unsigned char gf_xtime(unsigned char value)
+{
+    return (unsigned char)((value << 1) ^ (value & 0x80 ? 0x1b : 0));
+}
+
+static constexpr unsigned char gf_mul(unsigned char a, unsigned char b)
+{
+    unsigned char result = 0;
+    while (b) {
+        if (b & 1)
+            result ^= a;
+        a = gf_xtime(a);
+        b >>= 1;
+    }
+    return result;
+}
+
+static constexpr unsigned char rotl8(unsigned char value, int shift)
+{
+    return (unsigned char)((value << shift) | (value >> (8 - shift)));
+}
+
+static constexpr uint32_t ror8(uint32_t value)
+{
+    return (value >> 8) | (value << 24);
+}
+
+static constexpr aes_tables make_tables()
+{
+    aes_tables t = {};
+    // p runs through the powers of the generator 3 and q through their inverses, the S-box
+    // is the affine transform of the inverse
+    unsigned char p = 1, q = 1;
+    do {
+        p = p ^ gf_xtime(p);
+        q ^= (unsigned char)(q << 1);
+        q ^= (unsigned char)(q << 2);
+        q ^= (unsigned char)(q << 4);
+        if (q & 0x80)
+            q ^= 0x09;
+        t.sbox[p] = q ^ rotl8(q, 1) ^ rotl8(q, 2) ^ rotl8(q, 3) ^ rotl8(q, 4) ^ 0x63;
+    } while (p != 1);
+    t.sbox[0] = 0x63;
+    for (int x = 0; x < 256; x++)
+        t.rsbox[t.sbox[x]] = (unsigned char)x;
+    for (int x = 0; x < 256; x++) {
+        unsigned char s = t.sbox[x], si = t.rsbox[x];
+        uint32_t e = ((uint32_t)gf_mul(s, 2) << 24) | ((uint32_t)s << 16) | ((uint32_t)s << 8) | gf_mul(s, 3);
+        uint32_t d = ((uint32_t)gf_mul(si, 14) << 24) | ((uint32_t)gf_mul(si, 9) << 16)
+                     | ((uint32_t)gf_mul(si, 13) << 8) | gf_mul(si, 11);
+        for (int i = 0; i < 4; i++, e = ror8(e), d = ror8(d)) {
+            t.Te[i][x] = e;
+            t.Td[i][x] = d;
+        }
+    }
+    return t;
+}
+
+constexpr aes_tables aesTables = make_tables();
+static_assert(aesTables.sbox[0x00] == 0x63 && aesTables.sbox[0x53] == 0xed && aesTables.sbox[0xff] == 0x16,
+              "FIPS-197 S-box");
+static_assert(aesTables.rsbox[0xed] == 0x53 && aesTables.Te[0][0x00] == 0xc66363a5, "derived tables");
+
+static constexpr const unsigned char *sbox = aesTables.sbox;
+static constexpr const unsigned char *rsbox = aesTables.rsbox;
+
+// round constants x^(i-1), enough for the 10 steps of the AES-128 schedule (192 and 256 use fewer)
+struct aes_rcon {
+    unsigned char value[11];
+};
+
+static constexpr aes_rcon make_rcon()
+{
+    aes_rcon rcon = {};
+    rcon.value[0] = 0x8d;
+    unsigned char power = 1;
+    for (int i = 1; i < 11; i++, power = gf_xtime(power))
+        rcon.value[i] = power;
+    return rcon;
+}
+
+static constexpr aes_rcon Rcon = make_rcon();
+
+// FIPS-197 key expansion; every step derives the next KeyBytes of schedule from the previous
+// KeyBytes, the step count and lengths are compile-time so all of it unrolls
+template <int KeyBytes>
+static void expand_key(unsigned char *expandedKey, const unsigned char *key)
+{
+    typedef aes_key_size<KeyBytes> shape;
+    memcpy(expandedKey, key, KeyBytes);
+    aes_unroll<(shape::expandedSize - 1) / KeyBytes>([&](auto step) {
+        constexpr int offset = (decltype(step)::value + 1) * KeyBytes;
+        constexpr int length = shape::expandedSize - offset < KeyBytes ? shape::expandedSize - offset : KeyBytes;
+        unsigned char *next = expandedKey + offset;
+        const unsigned char *previous = next - KeyBytes;
+        // RotWord, SubWord and Rcon on the first word
+        next[0] = previous[0] ^ sbox[next[-3]] ^ Rcon.value[decltype(step)::value + 1];
+        next[1] = previous[1] ^ sbox[next[-2]];
+        next[2] = previous[2] ^ sbox[next[-1]];
+        next[3] = previous[3] ^ sbox[next[-4]];
+        for (int i = 4; i < length; i++) {
+            // AES-256 adds a SubWord half way through
+            if (KeyBytes == 32 && i >= 16 && i < 20)
+                next[i] = previous[i] ^ sbox[next[i - 4]];
+            else
+                next[i] = previous[i] ^ next[i - 4];
+        }
+    });
+}
+
+// expand the key
+void expandKey(unsigned char *expandedKey,
+               unsigned char *key)
+{
+    expand_key<16>(expandedKey, key);
+}
+
+// multiply by 2 in the galois field
+unsigned char galois_mul2(unsigned char value)
+{
+    value&=0xff; /*rkvmod*/
+    if (value>>7)
+    {
+        value = ((value<<1)&(0xff));
+        return (value^0x1b);
+    } else
+        return ((value<<1)&(0xff));
+}
+
+// straight foreward aes encryption implementation
+//   first the group of operations
+//     - addroundkey
+//     - subbytes
+//     - shiftrows
+//     - mixcolums
+//   is executed Rounds - 1 times, after this addroundkey to finish that round,
+//   after that the last round without mixcolums
+//   no further subfunctions to save cycles for function calls
+//   no structuring with "for (....)" to save cycles
+template <int Rounds>
+static void aes_encrypt_block(unsigned char *state, const unsigned char *expandedKey)
+{
+    unsigned char buf1, buf2, buf3, round;
+
+
+    for (round = 0; round < Rounds - 1; round ++){
+        // addroundkey, sbox and shiftrows
+        // row 0
+        state[ 0]  = sbox[(state[ 0] ^ expandedKey[(round*16)     ])];
+        state[ 4]  = sbox[(state[ 4] ^ expandedKey[(round*16) +  4])];
+        state[ 8]  = sbox[(state[ 8] ^ expandedKey[(round*16) +  8])];
+        state[12]  = sbox[(state[12] ^ expandedKey[(round*16) + 12])];
+        // row 1
+        buf1 = state[1] ^ expandedKey[(round*16) + 1];
+        state[ 1]  = sbox[(state[ 5] ^ expandedKey[(round*16) +  5])];
+        state[ 5]  = sbox[(state[ 9] ^ expandedKey[(round*16) +  9])];
+        state[ 9]  = sbox[(state[13] ^ expandedKey[(round*16) + 13])];
+        state[13]  = sbox[buf1];
+        // row 2
+        buf1 = state[2] ^ expandedKey[(round*16) + 2];
+        buf2 = state[6] ^ expandedKey[(round*16) + 6];
+        state[ 2]  = sbox[(state[10] ^ expandedKey[(round*16) + 10])];
+        state[ 6]  = sbox[(state[14] ^ expandedKey[(round*16) + 14])];
+        state[10]  = sbox[buf1];
+        state[14]  = sbox[buf2];
+        // row 3
+        buf1 = state[15] ^ expandedKey[(round*16) + 15];
+        state[15]  = sbox[(state[11] ^ expandedKey[(round*16) + 11])];
+        state[11]  = sbox[(state[ 7] ^ expandedKey[(round*16) +  7])];
+        state[ 7]  = sbox[(state[ 3] ^ expandedKey[(round*16) +  3])];
+        state[ 3]  = sbox[buf1];
+
+        // mixcolums //////////
+        // col1
+        buf1 = state[0] ^ state[1] ^ state[2] ^ state[3];
+        buf2 = state[0];
+        buf3 = state[0]^state[1]; buf3=galois_mul2(buf3); state[0] = state[0] ^ buf3 ^ buf1;
+        buf3 = state[1]^state[2]; buf3=galois_mul2(buf3); state[1] = state[1] ^ buf3 ^ buf1;
+        buf3 = state[2]^state[3]; buf3=galois_mul2(buf3); state[2] = state[2] ^ buf3 ^ buf1;
+        buf3 = state[3]^buf2;     buf3=galois_mul2(buf3); state[3] = state[3] ^ buf3 ^ buf1;
+        // col2
+        buf1 = state[4] ^ state[5] ^ state[6] ^ state[7];
+        buf2 = state[4];
+        buf3 = state[4]^state[5]; buf3=galois_mul2(buf3); state[4] = state[4] ^ buf3 ^ buf1;
+        buf3 = state[5]^state[6]; buf3=galois_mul2(buf3); state[5] = state[5] ^ buf3 ^ buf1;
+        buf3 = state[6]^state[7]; buf3=galois_mul2(buf3); state[6] = state[6] ^ buf3 ^ buf1;
+        buf3 = state[7]^buf2;     buf3=galois_mul2(buf3); state[7] = state[7] ^ buf3 ^ buf1;
+        // col3
+        buf1 = state[8] ^ state[9] ^ state[10] ^ state[11];
+        buf2 = state[8];
+        buf3 = state[8]^state[9];   buf3=galois_mul2(buf3); state[8] = state[8] ^ buf3 ^ buf1;
+        buf3 = state[9]^state[10];  buf3=galois_mul2(buf3); state[9] = state[9] ^ buf3 ^ buf1;
+        buf3 = state[10]^state[11]; buf3=galois_mul2(buf3); state[10] = state[10] ^ buf3 ^ buf1;
+        buf3 = state[11]^buf2;      buf3=galois_mul2(buf3); state[11] = state[11] ^ buf3 ^ buf1;
+        // col4
+        buf1 = state[12] ^ state[13] ^ state[14] ^ state[15];
+        buf2 = state[12];
+        buf3 = state[12]^state[13]; buf3=galois_mul2(buf3); state[12] = state[12] ^ buf3 ^ buf1;
+        buf3 = state[13]^state[14]; buf3=galois_mul2(buf3); state[13] = state[13] ^ buf3 ^ buf1;
+        buf3 = state[14]^state[15]; buf3=galois_mul2(buf3); state[14] = state[14] ^ buf3 ^ buf1;
+        buf3 = state[15]^buf2;      buf3=galois_mul2(buf3); state[15] = state[15] ^ buf3 ^ buf1;
+
+    }
+    // last round without mixcols
+    state[ 0]  = sbox[(state[ 0] ^ expandedKey[(round*16)     ])];
+    state[ 4]  = sbox[(state[ 4] ^ expandedKey[(round*16) +  4])];
+    state[ 8]  = sbox[(state[ 8] ^ expandedKey[(round*16) +  8])];
+    state[12]  = sbox[(state[12] ^ expandedKey[(round*16) + 12])];
+    // row 1
+    buf1 = state[1] ^ expandedKey[(round*16) + 1];
+    state[ 1]  = sbox[(state[ 5] ^ expandedKey[(round*16) +  5])];
+    state[ 5]  = sbox[(state[ 9] ^ expandedKey[(round*16) +  9])];
+    state[ 9]  = sbox[(state[13] ^ expandedKey[(round*16) + 13])];
+    state[13]  = sbox[buf1];
+    // row 2
+    buf1 = state[2] ^ expandedKey[(round*16) + 2];
+    buf2 = state[6] ^ expandedKey[(round*16) + 6];
+    state[ 2]  = sbox[(state[10] ^ expandedKey[(round*16) + 10])];
+    state[ 6]  = sbox[(state[14] ^ expandedKey[(round*16) + 14])];
+    state[10]  = sbox[buf1];
+    state[14]  = sbox[buf2];
+    // row 3
+    buf1 = state[15] ^ expandedKey[(round*16) + 15];
+    state[15]  = sbox[(state[11] ^ expandedKey[(round*16) + 11])];
+    state[11]  = sbox[(state[ 7] ^ expandedKey[(round*16) +  7])];
+    state[ 7]  = sbox[(state[ 3] ^ expandedKey[(round*16) +  3])];
+    state[ 3]  = sbox[buf1];
+    // last addroundkey
+    state[ 0]^=expandedKey[Rounds*16 +  0];
+    state[ 1]^=expandedKey[Rounds*16 +  1];
+    state[ 2]^=expandedKey[Rounds*16 +  2];
+    state[ 3]^=expandedKey[Rounds*16 +  3];
+    state[ 4]^=expandedKey[Rounds*16 +  4];
+    state[ 5]^=expandedKey[Rounds*16 +  5];
+    state[ 6]^=expandedKey[Rounds*16 +  6];
+    state[ 7]^=expandedKey[Rounds*16 +  7];
+    state[ 8]^=expandedKey[Rounds*16 +  8];
+    state[ 9]^=expandedKey[Rounds*16 +  9];
+    state[10]^=expandedKey[Rounds*16 + 10];
+    state[11]^=expandedKey[Rounds*16 + 11];
+    state[12]^=expandedKey[Rounds*16 + 12];
+    state[13]^=expandedKey[Rounds*16 + 13];
+    state[14]^=expandedKey[Rounds*16 + 14];
+    state[15]^=expandedKey[Rounds*16 + 15];
+}
+
+
+
+// straight foreward aes decryption implementation
+//   the order of substeps is the exact reverse of decryption
+//   inverse functions:
+//       - addRoundKey is its own inverse
+//       - rsbox is inverse of sbox
+//       - rightshift instead of leftshift
+//       - invMixColumns = barreto + mixColumns
+//   no further subfunctions to save cycles for function calls
+//   no structuring with "for (....)" to save cycles
+template <int Rounds>
+static void aes_decrypt_block(unsigned char *state, const unsigned char *expandedKey)
+{
+    unsigned char buf1, buf2, buf3;
+    signed char round;
+    round = Rounds - 1;
+    // initial addroundkey
+    state[ 0]^=expandedKey[Rounds*16 +  0];
+    state[ 1]^=expandedKey[Rounds*16 +  1];
+    state[ 2]^=expandedKey[Rounds*16 +  2];
+    state[ 3]^=expandedKey[Rounds*16 +  3];
+    state[ 4]^=expandedKey[Rounds*16 +  4];
+    state[ 5]^=expandedKey[Rounds*16 +  5];
+    state[ 6]^=expandedKey[Rounds*16 +  6];
+    state[ 7]^=expandedKey[Rounds*16 +  7];
+    state[ 8]^=expandedKey[Rounds*16 +  8];
+    state[ 9]^=expandedKey[Rounds*16 +  9];
+    state[10]^=expandedKey[Rounds*16 + 10];
+    state[11]^=expandedKey[Rounds*16 + 11];
+    state[12]^=expandedKey[Rounds*16 + 12];
+    state[13]^=expandedKey[Rounds*16 + 13];
+    state[14]^=expandedKey[Rounds*16 + 14];
+    state[15]^=expandedKey[Rounds*16 + 15];
+
+    // last round without mixcols
+    state[ 0]  = rsbox[state[ 0]] ^ expandedKey[(round*16)     ];
+    state[ 4]  = rsbox[state[ 4]] ^ expandedKey[(round*16) +  4];
+    state[ 8]  = rsbox[state[ 8]] ^ expandedKey[(round*16) +  8];
+    state[12]  = rsbox[state[12]] ^ expandedKey[(round*16) + 12];
+    // row 1
+    buf1 =       rsbox[state[13]] ^ expandedKey[(round*16) +  1];
+    state[13]  = rsbox[state[ 9]] ^ expandedKey[(round*16) + 13];
+    state[ 9]  = rsbox[state[ 5]] ^ expandedKey[(round*16) +  9];
+    state[ 5]  = rsbox[state[ 1]] ^ expandedKey[(round*16) +  5];
+    state[ 1]  = buf1;
+    // row 2
+    buf1 =       rsbox[state[ 2]] ^ expandedKey[(round*16) + 10];
+    buf2 =       rsbox[state[ 6]] ^ expandedKey[(round*16) + 14];
+    state[ 2]  = rsbox[state[10]] ^ expandedKey[(round*16) +  2];
+    state[ 6]  = rsbox[state[14]] ^ expandedKey[(round*16) +  6];
+    state[10]  = buf1;
+    state[14]  = buf2;
+    // row 3
+    buf1 =       rsbox[state[ 3]] ^ expandedKey[(round*16) + 15];
+    state[ 3]  = rsbox[state[ 7]] ^ expandedKey[(round*16) +  3];
+    state[ 7]  = rsbox[state[11]] ^ expandedKey[(round*16) +  7];
+    state[11]  = rsbox[state[15]] ^ expandedKey[(round*16) + 11];
+    state[15]  = buf1;
+
+    for (round = Rounds - 2; round >= 0; round--){
+        // barreto
+        //col1
+        buf1 = galois_mul2(galois_mul2(state[0]^state[2]));
+        buf2 = galois_mul2(galois_mul2(state[1]^state[3]));
+        state[0] ^= buf1;     state[1] ^= buf2;    state[2] ^= buf1;    state[3] ^= buf2;
+        //col2
+        buf1 = galois_mul2(galois_mul2(state[4]^state[6]));
+        buf2 = galois_mul2(galois_mul2(state[5]^state[7]));
+        state[4] ^= buf1;    state[5] ^= buf2;    state[6] ^= buf1;    state[7] ^= buf2;
+        //col3
+        buf1 = galois_mul2(galois_mul2(state[8]^state[10]));
+        buf2 = galois_mul2(galois_mul2(state[9]^state[11]));
+        state[8] ^= buf1;    state[9] ^= buf2;    state[10] ^= buf1;    state[11] ^= buf2;
+        //col4
+        buf1 = galois_mul2(galois_mul2(state[12]^state[14]));
+        buf2 = galois_mul2(galois_mul2(state[13]^state[15]));
+        state[12] ^= buf1;    state[13] ^= buf2;    state[14] ^= buf1;    state[15] ^= buf2;
+        // mixcolums //////////
+        // col1
+        buf1 = state[0] ^ state[1] ^ state[2] ^ state[3];
+        buf2 = state[0];
+        buf3 = state[0]^state[1]; buf3=galois_mul2(buf3); state[0] = state[0] ^ buf3 ^ buf1;
+        buf3 = state[1]^state[2]; buf3=galois_mul2(buf3); state[1] = state[1] ^ buf3 ^ buf1;
+        buf3 = state[2]^state[3]; buf3=galois_mul2(buf3); state[2] = state[2] ^ buf3 ^ buf1;
+        buf3 = state[3]^buf2;     buf3=galois_mul2(buf3); state[3] = state[3] ^ buf3 ^ buf1;
+        // col2
+        buf1 = state[4] ^ state[5] ^ state[6] ^ state[7];
+        buf2 = state[4];
+        buf3 = state[4]^state[5]; buf3=galois_mul2(buf3); state[4] = state[4] ^ buf3 ^ buf1;
+        buf3 = state[5]^state[6]; buf3=galois_mul2(buf3); state[5] = state[5] ^ buf3 ^ buf1;
+        buf3 = state[6]^state[7]; buf3=galois_mul2(buf3); state[6] = state[6] ^ buf3 ^ buf1;
+        buf3 = state[7]^buf2;     buf3=galois_mul2(buf3); state[7] = state[7] ^ buf3 ^ buf1;
+        // col3
+        buf1 = state[8] ^ state[9] ^ state[10] ^ state[11];
+        buf2 = state[8];
+        buf3 = state[8]^state[9];   buf3=galois_mul2(buf3); state[8] = state[8] ^ buf3 ^ buf1;
+        buf3 = state[9]^state[10];  buf3=galois_mul2(buf3); state[9] = state[9] ^ buf3 ^ buf1;
+        buf3 = state[10]^state[11]; buf3=galois_mul2(buf3); state[10] = state[10] ^ buf3 ^ buf1;
+        buf3 = state[11]^buf2;      buf3=galois_mul2(buf3); state[11] = state[11] ^ buf3 ^ buf1;
+        // col4
+        buf1 = state[12] ^ state[13] ^ state[14] ^ state[15];
+        buf2 = state[12];
+        buf3 = state[12]^state[13]; buf3=galois_mul2(buf3); state[12] = state[12] ^ buf3 ^ buf1;
+        buf3 = state[13]^state[14]; buf3=galois_mul2(buf3); state[13] = state[13] ^ buf3 ^ buf1;
+        buf3 = state[14]^state[15]; buf3=galois_mul2(buf3); state[14] = state[14] ^ buf3 ^ buf1;
+        buf3 = state[15]^buf2;      buf3=galois_mul2(buf3); state[15] = state[15] ^ buf3 ^ buf1;
+
+        // addroundkey, rsbox and shiftrows
+        // row 0
+        state[ 0]  = rsbox[state[ 0]] ^ expandedKey[(round*16)     ];
+        state[ 4]  = rsbox[state[ 4]] ^ expandedKey[(round*16) +  4];
+        state[ 8]  = rsbox[state[ 8]] ^ expandedKey[(round*16) +  8];
+        state[12]  = rsbox[state[12]] ^ expandedKey[(round*16) + 12];
+        // row 1
+        buf1 =       rsbox[state[13]] ^ expandedKey[(round*16) +  1];
+        state[13]  = rsbox[state[ 9]] ^ expandedKey[(round*16) + 13];
+        state[ 9]  = rsbox[state[ 5]] ^ expandedKey[(round*16) +  9];
+        state[ 5]  = rsbox[state[ 1]] ^ expandedKey[(round*16) +  5];
+        state[ 1]  = buf1;
+        // row 2
+        buf1 =       rsbox[state[ 2]] ^ expandedKey[(round*16) + 10];
+        buf2 =       rsbox[state[ 6]] ^ expandedKey[(round*16) + 14];
+        state[ 2]  = rsbox[state[10]] ^ expandedKey[(round*16) +  2];
+        state[ 6]  = rsbox[state[14]] ^ expandedKey[(round*16) +  6];
+        state[10]  = buf1;
+        state[14]  = buf2;
+        // row 3
+        buf1 =       rsbox[state[ 3]] ^ expandedKey[(round*16) + 15];
+        state[ 3]  = rsbox[state[ 7]] ^ expandedKey[(round*16) +  3];
+        state[ 7]  = rsbox[state[11]] ^ expandedKey[(round*16) +  7];
+        state[11]  = rsbox[state[15]] ^ expandedKey[(round*16) + 11];
+        state[15]  = buf1;
+    }
+}
+
+void aes_encr(unsigned char *state, const unsigned char *expandedKey)
+{
+    aes_encrypt_block<AES_ROUNDS>(state, expandedKey);
+}
+
+void aes_decr(unsigned char *state, const unsigned char *expandedKey)
+{
+    aes_decrypt_block<AES_ROUNDS>(state, expandedKey);
+}
+
+// encrypt
+void wcl_sw_aes_encrypt(unsigned char *state,
+                        unsigned char *key)
+{
+    unsigned char expandedKey[AES_EXPANDED_KEY_SIZE];
+
+    expandKey(expandedKey, key);       // expand the key into 176 bytes
+    aes_encr(state, expandedKey);
+}
+// decrypt
+void wcl_sw_aes_decrypt(unsigned char *state,
+                        unsigned char *key)
+{
+    unsigned char expandedKey[AES_EXPANDED_KEY_SIZE];
+
+    expandKey(expandedKey, key);       // expand the key into 176 bytes
+    aes_decr(state, expandedKey);
+}
+
+template <int Rounds>
+static void reference_encrypt_blocks(const aes_context *ctx, unsigned char *data, size_t blocks)
+{
+    for (size_t i = 0; i < blocks; i++)
+        aes_encrypt_block<Rounds>(data + i * AES_BLOCK_SIZE, ctx->expandedKey);
+}
+
+template <int Rounds>
+static void reference_decrypt_blocks(const aes_context *ctx, unsigned char *data, size_t blocks)
+{
+    for (size_t i = 0; i < blocks; i++)
+        aes_decrypt_block<Rounds>(data + i * AES_BLOCK_SIZE, ctx->expandedKey);
+}
+
+const aes_engine *aes_engine_reference()
+{
+    static const aes_engine engine = {"reference", AES_KERNELS(reference_encrypt_blocks),
+                                      AES_KERNELS(reference_decrypt_blocks)};
+    return &engine;
+}
+
+const aes_engine *aes_engine_select()
+{
+    static const aes_engine *selected = []() {
+        const aes_engine *engine = aes_engine_armce();
+        if (engine == NULL)
+            engine = aes_engine_aesni();
+        if (engine == NULL)
+            engine = aes_engine_ttable();
+        return engine;
+    }();
+    return selected;
+}
+
+// InvMixColumns of one 16 byte round key, used to build the equivalent inverse cipher schedule
+static void inv_mix_columns(unsigned char *column)
+{
+    unsigned char buf1, buf2, buf3;
+    for (int c = 0; c < 16; c += 4) {
+        // barreto, same as aes_decr
+        buf1 = galois_mul2(galois_mul2(column[c]^column[c+2]));
+        buf2 = galois_mul2(galois_mul2(column[c+1]^column[c+3]));
+        column[c] ^= buf1;    column[c+1] ^= buf2;    column[c+2] ^= buf1;    column[c+3] ^= buf2;
+        buf1 = column[c] ^ column[c+1] ^ column[c+2] ^ column[c+3];
+        buf2 = column[c];
+        buf3 = column[c]^column[c+1];   buf3=galois_mul2(buf3); column[c] = column[c] ^ buf3 ^ buf1;
+        buf3 = column[c+1]^column[c+2]; buf3=galois_mul2(buf3); column[c+1] = column[c+1] ^ buf3 ^ buf1;
+        buf3 = column[c+2]^column[c+3]; buf3=galois_mul2(buf3); column[c+2] = column[c+2] ^ buf3 ^ buf1;
+        buf3 = column[c+3]^buf2;        buf3=galois_mul2(buf3); column[c+3] = column[c+3] ^ buf3 ^ buf1;
+    }
+}
+
+template <int KeyBytes>
+static void schedule(aes_context *ctx, const unsigned char *key)
+{
+    const int rounds = aes_key_size<KeyBytes>::rounds;
+    expand_key<KeyBytes>(ctx->expandedKey, key);
+    for (int round = 0; round <= rounds; round++) {
+        memcpy(ctx->decryptKey + round * AES_BLOCK_SIZE,
+               ctx->expandedKey + (rounds - round) * AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+        if (round != 0 && round != rounds)
+            inv_mix_columns(ctx->decryptKey + round * AES_BLOCK_SIZE);
+    }
+    ctx->rounds = rounds;
+}
+
+int aes_context_init_key_engine(aes_context *ctx, const unsigned char *key, size_t keyLength,
+                                const aes_engine *engine)
+{
+    int size;
+    switch (keyLength) {
+        case 16: schedule<16>(ctx, key); size = 0; break;
+        case 24: schedule<24>(ctx, key); size = 1; break;
+        case 32: schedule<32>(ctx, key); size = 2; break;
+        default: return -1;
+    }
+    ctx->engine = engine;
+    ctx->encrypt_blocks = engine->encrypt_blocks[size];
+    ctx->decrypt_blocks = engine->decrypt_blocks[size];
+    return 0;
+}
+
+int aes_context_init_key(aes_context *ctx, const unsigned char *key, size_t keyLength)
+{
+    return aes_context_init_key_engine(ctx, key, keyLength, aes_engine_select());
+}
+
+void aes_context_init_engine(aes_context *ctx, unsigned char *key, const aes_engine *engine)
+{
+    aes_context_init_key_engine(ctx, key, AES_BLOCK_SIZE, engine);
+}
+
+void aes_context_init(aes_context *ctx, unsigned char *key)
+{
+    aes_context_init_engine(ctx, key, aes_engine_select());
+}
+
+// encrypt every whole AES_BLOCK_SIZE block of data in place, returns the bytes processed
+size_t aes_context_encrypt(const aes_context *ctx, unsigned char *data, size_t length)
+{
+    size_t blocks = length / AES_BLOCK_SIZE;
+    ctx->encrypt_blocks(ctx, data, blocks);
+    return blocks * AES_BLOCK_SIZE;
+}
+
+// decrypt every whole AES_BLOCK_SIZE block of data in place, returns the bytes processed
+size_t aes_context_decrypt(const aes_context *ctx, unsigned char *data, size_t length)
+{
+    size_t blocks = length / AES_BLOCK_SIZE;
+    ctx->decrypt_blocks(ctx, data, blocks);
+    return blocks * AES_BLOCK_SIZE;
+}
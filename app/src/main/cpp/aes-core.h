@@ -0,0 +1,81 @@
+#ifndef AES_CORE_H
+#define AES_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AES_BLOCK_SIZE 16
+// AES-128, the shape of the legacy single-block functions
+#define AES_ROUNDS 10
+#define AES_EXPANDED_KEY_SIZE 176
+// room for the longest (AES-256) key and schedule
+#define AES_MAX_KEY_SIZE 32
+#define AES_MAX_ROUNDS 14
+#define AES_MAX_EXPANDED_KEY_SIZE 240
+
+// S-box, inverse S-box and the T-tables (SubBytes with MixColumns, and the inverse, for each
+// byte of a column), generated at compile time from the GF(2^8) arithmetic
+struct aes_tables {
+    unsigned char sbox[256];
+    unsigned char rsbox[256];
+    uint32_t Te[4][256];
+    uint32_t Td[4][256];
+};
+
+extern const aes_tables aesTables;
+
+struct aes_context;
+struct aes_engine;
+
+typedef void (*aes_blocks_fn)(const aes_context *ctx, unsigned char *data, size_t blocks);
+
+// key schedule expanded once and reused for every block encrypted or decrypted with it
+// expandedKey holds the FIPS-197 round keys, decryptKey the round keys of the equivalent
+// inverse cipher (reversed, InvMixColumns applied to all but the outer two) used by the table
+// and hardware engines; the engine's kernels for the key size are picked once at init. A
+// context is never written after aes_context_init so any number of threads may share it
+struct aes_context {
+    alignas(16) unsigned char expandedKey[AES_MAX_EXPANDED_KEY_SIZE];
+    alignas(16) unsigned char decryptKey[AES_MAX_EXPANDED_KEY_SIZE];
+    int rounds;
+    const aes_engine *engine;
+    aes_blocks_fn encrypt_blocks;
+    aes_blocks_fn decrypt_blocks;
+};
+
+// a block cipher backend, every engine is bit-identical to the byte-wise reference
+// kernels are compiled per key size: AES-128, AES-192, AES-256
+struct aes_engine {
+    const char *name;
+    aes_blocks_fn encrypt_blocks[3];
+    aes_blocks_fn decrypt_blocks[3];
+};
+
+// byte-wise reference implementation
+void expandKey(unsigned char *expandedKey, unsigned char *key);
+unsigned char galois_mul2(unsigned char value);
+void aes_encr(unsigned char *state, const unsigned char *expandedKey);
+void aes_decr(unsigned char *state, const unsigned char *expandedKey);
+void wcl_sw_aes_encrypt(unsigned char *state, unsigned char *key);
+void wcl_sw_aes_decrypt(unsigned char *state, unsigned char *key);
+
+// engines, the hardware ones return NULL when not built for or not supported by this CPU
+const aes_engine *aes_engine_reference();
+const aes_engine *aes_engine_ttable();
+const aes_engine *aes_engine_aesni();
+const aes_engine *aes_engine_armce();
+// fastest engine available on this CPU, detected once
+const aes_engine *aes_engine_select();
+
+// AES-128
+void aes_context_init(aes_context *ctx, unsigned char *key);
+// same as aes_context_init but pinned to a given engine
+void aes_context_init_engine(aes_context *ctx, unsigned char *key, const aes_engine *engine);
+// keyLength 16, 24 or 32 bytes; returns -1 for any other length
+int aes_context_init_key(aes_context *ctx, const unsigned char *key, size_t keyLength);
+int aes_context_init_key_engine(aes_context *ctx, const unsigned char *key, size_t keyLength,
+                                const aes_engine *engine);
+size_t aes_context_encrypt(const aes_context *ctx, unsigned char *data, size_t length);
+size_t aes_context_decrypt(const aes_context *ctx, unsigned char *data, size_t length);
+
+#endif //AES_CORE_H
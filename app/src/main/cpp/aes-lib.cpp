@@ -1,397 +1,331 @@
 #include <jni.h>
 #include <string>
+#include <cstring>
+#include <vector>
+#include "aes-core.h"
+#include "aes-modes.h"
+#include "adv-rotator.h"
+#include "probe.h"
 
-void expandKey(unsigned char *expandedKey, unsigned char *key);
-unsigned char galois_mul2(unsigned char value);
-void wcl_sw_aes_encrypt(unsigned char *state, unsigned char *key);
-void wcl_sw_aes_decrypt(unsigned char *state, unsigned char *key);
-void aes_encr(unsigned char *state, unsigned char *expandedKey);
-void aes_decr(unsigned char *state, unsigned char *expandedKey);
-unsigned char *states;
-const unsigned char sbox[256] =   {
-//0     1    2      3     4    5     6     7      8    9     A      B    C     D     E     F
-        0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76, //0
-        0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0, //1
-        0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15, //2
-        0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75, //3
-        0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84, //4
-        0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf, //5
-        0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8, //6
-        0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2, //7
-        0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73, //8
-        0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb, //9
-        0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79, //A
-        0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08, //B
-        0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a, //C
-        0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e, //D
-        0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf, //E
-        0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16 }; //F
-// inverse sbox
-const unsigned char rsbox[256] =
-        { 0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb
-                , 0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb
-                , 0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e
-                , 0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25
-                , 0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92
-                , 0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84
-                , 0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06
-                , 0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b
-                , 0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73
-                , 0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e
-                , 0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b
-                , 0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4
-                , 0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f
-                , 0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef
-                , 0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61
-                , 0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d };
-// round constant
-const unsigned char Rcon[11] = {
-        0x8d, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36};
-
-
-// expand the key
-void expandKey(unsigned char *expandedKey,
-               unsigned char *key)
-{
-    unsigned short ii, buf1;
-    for (ii=0;ii<16;ii++)
-        expandedKey[ii] = key[ii];
-    for (ii=1;ii<11;ii++){
-        buf1 = expandedKey[ii*16 - 4];
-        expandedKey[ii*16 + 0] = sbox[expandedKey[ii*16 - 3]]^expandedKey[(ii-1)*16 + 0]^Rcon[ii];
-        expandedKey[ii*16 + 1] = sbox[expandedKey[ii*16 - 2]]^expandedKey[(ii-1)*16 + 1];
-        expandedKey[ii*16 + 2] = sbox[expandedKey[ii*16 - 1]]^expandedKey[(ii-1)*16 + 2];
-        expandedKey[ii*16 + 3] = sbox[buf1                  ]^expandedKey[(ii-1)*16 + 3];
-        expandedKey[ii*16 + 4] = expandedKey[(ii-1)*16 + 4]^expandedKey[ii*16 + 0];
-        expandedKey[ii*16 + 5] = expandedKey[(ii-1)*16 + 5]^expandedKey[ii*16 + 1];
-        expandedKey[ii*16 + 6] = expandedKey[(ii-1)*16 + 6]^expandedKey[ii*16 + 2];
-        expandedKey[ii*16 + 7] = expandedKey[(ii-1)*16 + 7]^expandedKey[ii*16 + 3];
-        expandedKey[ii*16 + 8] = expandedKey[(ii-1)*16 + 8]^expandedKey[ii*16 + 4];
-        expandedKey[ii*16 + 9] = expandedKey[(ii-1)*16 + 9]^expandedKey[ii*16 + 5];
-        expandedKey[ii*16 +10] = expandedKey[(ii-1)*16 +10]^expandedKey[ii*16 + 6];
-        expandedKey[ii*16 +11] = expandedKey[(ii-1)*16 +11]^expandedKey[ii*16 + 7];
-        expandedKey[ii*16 +12] = expandedKey[(ii-1)*16 +12]^expandedKey[ii*16 + 8];
-        expandedKey[ii*16 +13] = expandedKey[(ii-1)*16 +13]^expandedKey[ii*16 + 9];
-        expandedKey[ii*16 +14] = expandedKey[(ii-1)*16 +14]^expandedKey[ii*16 +10];
-        expandedKey[ii*16 +15] = expandedKey[(ii-1)*16 +15]^expandedKey[ii*16 +11];
-    }
-
-
-}
-
-// multiply by 2 in the galois field
-unsigned char galois_mul2(unsigned char value)
-{
-    value&=0xff; /*rkvmod*/
-    if (value>>7)
-    {
-        value = ((value<<1)&(0xff));
-        return (value^0x1b);
-    } else
-        return ((value<<1)&(0xff));
-}
-
-// straight foreward aes encryption implementation
-//   first the group of operations
-//     - addroundkey
-//     - subbytes
-//     - shiftrows
-//     - mixcolums
-//   is executed 9 times, after this addroundkey to finish the 9th round,
-//   after that the 10th round without mixcolums
-//   no further subfunctions to save cycles for function calls
-//   no structuring with "for (....)" to save cycles
-void aes_encr(unsigned char *state, unsigned char *expandedKey)
+// 24 and 32 byte keys select AES-192 and AES-256, anything else of at least 16 bytes keeps the
+// old behaviour of AES-128 over the first 16; returns the key length used, 0 when too short
+static size_t read_key(JNIEnv *env, jbyteArray key, unsigned char *keyinp)
 {
-    unsigned char buf1, buf2, buf3, round;
-
-
-    for (round = 0; round < 9; round ++){
-        // addroundkey, sbox and shiftrows
-        // row 0
-        state[ 0]  = sbox[(state[ 0] ^ expandedKey[(round*16)     ])];
-        state[ 4]  = sbox[(state[ 4] ^ expandedKey[(round*16) +  4])];
-        state[ 8]  = sbox[(state[ 8] ^ expandedKey[(round*16) +  8])];
-        state[12]  = sbox[(state[12] ^ expandedKey[(round*16) + 12])];
-        // row 1
-        buf1 = state[1] ^ expandedKey[(round*16) + 1];
-        state[ 1]  = sbox[(state[ 5] ^ expandedKey[(round*16) +  5])];
-        state[ 5]  = sbox[(state[ 9] ^ expandedKey[(round*16) +  9])];
-        state[ 9]  = sbox[(state[13] ^ expandedKey[(round*16) + 13])];
-        state[13]  = sbox[buf1];
-        // row 2
-        buf1 = state[2] ^ expandedKey[(round*16) + 2];
-        buf2 = state[6] ^ expandedKey[(round*16) + 6];
-        state[ 2]  = sbox[(state[10] ^ expandedKey[(round*16) + 10])];
-        state[ 6]  = sbox[(state[14] ^ expandedKey[(round*16) + 14])];
-        state[10]  = sbox[buf1];
-        state[14]  = sbox[buf2];
-        // row 3
-        buf1 = state[15] ^ expandedKey[(round*16) + 15];
-        state[15]  = sbox[(state[11] ^ expandedKey[(round*16) + 11])];
-        state[11]  = sbox[(state[ 7] ^ expandedKey[(round*16) +  7])];
-        state[ 7]  = sbox[(state[ 3] ^ expandedKey[(round*16) +  3])];
-        state[ 3]  = sbox[buf1];
-
-        // mixcolums //////////
-        // col1
-        buf1 = state[0] ^ state[1] ^ state[2] ^ state[3];
-        buf2 = state[0];
-        buf3 = state[0]^state[1]; buf3=galois_mul2(buf3); state[0] = state[0] ^ buf3 ^ buf1;
-        buf3 = state[1]^state[2]; buf3=galois_mul2(buf3); state[1] = state[1] ^ buf3 ^ buf1;
-        buf3 = state[2]^state[3]; buf3=galois_mul2(buf3); state[2] = state[2] ^ buf3 ^ buf1;
-        buf3 = state[3]^buf2;     buf3=galois_mul2(buf3); state[3] = state[3] ^ buf3 ^ buf1;
-        // col2
-        buf1 = state[4] ^ state[5] ^ state[6] ^ state[7];
-        buf2 = state[4];
-        buf3 = state[4]^state[5]; buf3=galois_mul2(buf3); state[4] = state[4] ^ buf3 ^ buf1;
-        buf3 = state[5]^state[6]; buf3=galois_mul2(buf3); state[5] = state[5] ^ buf3 ^ buf1;
-        buf3 = state[6]^state[7]; buf3=galois_mul2(buf3); state[6] = state[6] ^ buf3 ^ buf1;
-        buf3 = state[7]^buf2;     buf3=galois_mul2(buf3); state[7] = state[7] ^ buf3 ^ buf1;
-        // col3
-        buf1 = state[8] ^ state[9] ^ state[10] ^ state[11];
-        buf2 = state[8];
-        buf3 = state[8]^state[9];   buf3=galois_mul2(buf3); state[8] = state[8] ^ buf3 ^ buf1;
-        buf3 = state[9]^state[10];  buf3=galois_mul2(buf3); state[9] = state[9] ^ buf3 ^ buf1;
-        buf3 = state[10]^state[11]; buf3=galois_mul2(buf3); state[10] = state[10] ^ buf3 ^ buf1;
-        buf3 = state[11]^buf2;      buf3=galois_mul2(buf3); state[11] = state[11] ^ buf3 ^ buf1;
-        // col4
-        buf1 = state[12] ^ state[13] ^ state[14] ^ state[15];
-        buf2 = state[12];
-        buf3 = state[12]^state[13]; buf3=galois_mul2(buf3); state[12] = state[12] ^ buf3 ^ buf1;
-        buf3 = state[13]^state[14]; buf3=galois_mul2(buf3); state[13] = state[13] ^ buf3 ^ buf1;
-        buf3 = state[14]^state[15]; buf3=galois_mul2(buf3); state[14] = state[14] ^ buf3 ^ buf1;
-        buf3 = state[15]^buf2;      buf3=galois_mul2(buf3); state[15] = state[15] ^ buf3 ^ buf1;
-
-    }
-    // 10th round without mixcols
-    state[ 0]  = sbox[(state[ 0] ^ expandedKey[(round*16)     ])];
-    state[ 4]  = sbox[(state[ 4] ^ expandedKey[(round*16) +  4])];
-    state[ 8]  = sbox[(state[ 8] ^ expandedKey[(round*16) +  8])];
-    state[12]  = sbox[(state[12] ^ expandedKey[(round*16) + 12])];
-    // row 1
-    buf1 = state[1] ^ expandedKey[(round*16) + 1];
-    state[ 1]  = sbox[(state[ 5] ^ expandedKey[(round*16) +  5])];
-    state[ 5]  = sbox[(state[ 9] ^ expandedKey[(round*16) +  9])];
-    state[ 9]  = sbox[(state[13] ^ expandedKey[(round*16) + 13])];
-    state[13]  = sbox[buf1];
-    // row 2
-    buf1 = state[2] ^ expandedKey[(round*16) + 2];
-    buf2 = state[6] ^ expandedKey[(round*16) + 6];
-    state[ 2]  = sbox[(state[10] ^ expandedKey[(round*16) + 10])];
-    state[ 6]  = sbox[(state[14] ^ expandedKey[(round*16) + 14])];
-    state[10]  = sbox[buf1];
-    state[14]  = sbox[buf2];
-    // row 3
-    buf1 = state[15] ^ expandedKey[(round*16) + 15];
-    state[15]  = sbox[(state[11] ^ expandedKey[(round*16) + 11])];
-    state[11]  = sbox[(state[ 7] ^ expandedKey[(round*16) +  7])];
-    state[ 7]  = sbox[(state[ 3] ^ expandedKey[(round*16) +  3])];
-    state[ 3]  = sbox[buf1];
-    // last addroundkey
-    state[ 0]^=expandedKey[160];
-    state[ 1]^=expandedKey[161];
-    state[ 2]^=expandedKey[162];
-    state[ 3]^=expandedKey[163];
-    state[ 4]^=expandedKey[164];
-    state[ 5]^=expandedKey[165];
-    state[ 6]^=expandedKey[166];
-    state[ 7]^=expandedKey[167];
-    state[ 8]^=expandedKey[168];
-    state[ 9]^=expandedKey[169];
-    state[10]^=expandedKey[170];
-    state[11]^=expandedKey[171];
-    state[12]^=expandedKey[172];
-    state[13]^=expandedKey[173];
-    state[14]^=expandedKey[174];
-    state[15]^=expandedKey[175];
-    states=state;
+    jsize length = env->GetArrayLength(key);
+    if (length < 16)
+        return 0;
+    if (length != 24 && length != AES_MAX_KEY_SIZE)
+        length = 16;
+    env->GetByteArrayRegion(key, 0, length, reinterpret_cast<jbyte *>(keyinp));
+    return length;
 }
 
-
-
-// straight foreward aes decryption implementation
-//   the order of substeps is the exact reverse of decryption
-//   inverse functions:
-//       - addRoundKey is its own inverse
-//       - rsbox is inverse of sbox
-//       - rightshift instead of leftshift
-//       - invMixColumns = barreto + mixColumns
-//   no further subfunctions to save cycles for function calls
-//   no structuring with "for (....)" to save cycles
-void aes_decr(unsigned char *state, unsigned char *expandedKey)
+// the first AES_BLOCK_SIZE bytes of array, zero padded when it is shorter
+static void read_block(JNIEnv *env, jbyteArray array, unsigned char *block)
 {
-    unsigned char buf1, buf2, buf3;
-    signed char round;
-    round = 9;
-    // initial addroundkey
-    state[ 0]^=expandedKey[160];
-    state[ 1]^=expandedKey[161];
-    state[ 2]^=expandedKey[162];
-    state[ 3]^=expandedKey[163];
-    state[ 4]^=expandedKey[164];
-    state[ 5]^=expandedKey[165];
-    state[ 6]^=expandedKey[166];
-    state[ 7]^=expandedKey[167];
-    state[ 8]^=expandedKey[168];
-    state[ 9]^=expandedKey[169];
-    state[10]^=expandedKey[170];
-    state[11]^=expandedKey[171];
-    state[12]^=expandedKey[172];
-    state[13]^=expandedKey[173];
-    state[14]^=expandedKey[174];
-    state[15]^=expandedKey[175];
-
-    // 10th round without mixcols
-    state[ 0]  = rsbox[state[ 0]] ^ expandedKey[(round*16)     ];
-    state[ 4]  = rsbox[state[ 4]] ^ expandedKey[(round*16) +  4];
-    state[ 8]  = rsbox[state[ 8]] ^ expandedKey[(round*16) +  8];
-    state[12]  = rsbox[state[12]] ^ expandedKey[(round*16) + 12];
-    // row 1
-    buf1 =       rsbox[state[13]] ^ expandedKey[(round*16) +  1];
-    state[13]  = rsbox[state[ 9]] ^ expandedKey[(round*16) + 13];
-    state[ 9]  = rsbox[state[ 5]] ^ expandedKey[(round*16) +  9];
-    state[ 5]  = rsbox[state[ 1]] ^ expandedKey[(round*16) +  5];
-    state[ 1]  = buf1;
-    // row 2
-    buf1 =       rsbox[state[ 2]] ^ expandedKey[(round*16) + 10];
-    buf2 =       rsbox[state[ 6]] ^ expandedKey[(round*16) + 14];
-    state[ 2]  = rsbox[state[10]] ^ expandedKey[(round*16) +  2];
-    state[ 6]  = rsbox[state[14]] ^ expandedKey[(round*16) +  6];
-    state[10]  = buf1;
-    state[14]  = buf2;
-    // row 3
-    buf1 =       rsbox[state[ 3]] ^ expandedKey[(round*16) + 15];
-    state[ 3]  = rsbox[state[ 7]] ^ expandedKey[(round*16) +  3];
-    state[ 7]  = rsbox[state[11]] ^ expandedKey[(round*16) +  7];
-    state[11]  = rsbox[state[15]] ^ expandedKey[(round*16) + 11];
-    state[15]  = buf1;
-
-    for (round = 8; round >= 0; round--){
-        // barreto
-        //col1
-        buf1 = galois_mul2(galois_mul2(state[0]^state[2]));
-        buf2 = galois_mul2(galois_mul2(state[1]^state[3]));
-        state[0] ^= buf1;     state[1] ^= buf2;    state[2] ^= buf1;    state[3] ^= buf2;
-        //col2
-        buf1 = galois_mul2(galois_mul2(state[4]^state[6]));
-        buf2 = galois_mul2(galois_mul2(state[5]^state[7]));
-        state[4] ^= buf1;    state[5] ^= buf2;    state[6] ^= buf1;    state[7] ^= buf2;
-        //col3
-        buf1 = galois_mul2(galois_mul2(state[8]^state[10]));
-        buf2 = galois_mul2(galois_mul2(state[9]^state[11]));
-        state[8] ^= buf1;    state[9] ^= buf2;    state[10] ^= buf1;    state[11] ^= buf2;
-        //col4
-        buf1 = galois_mul2(galois_mul2(state[12]^state[14]));
-        buf2 = galois_mul2(galois_mul2(state[13]^state[15]));
-        state[12] ^= buf1;    state[13] ^= buf2;    state[14] ^= buf1;    state[15] ^= buf2;
-        // mixcolums //////////
-        // col1
-        buf1 = state[0] ^ state[1] ^ state[2] ^ state[3];
-        buf2 = state[0];
-        buf3 = state[0]^state[1]; buf3=galois_mul2(buf3); state[0] = state[0] ^ buf3 ^ buf1;
-        buf3 = state[1]^state[2]; buf3=galois_mul2(buf3); state[1] = state[1] ^ buf3 ^ buf1;
-        buf3 = state[2]^state[3]; buf3=galois_mul2(buf3); state[2] = state[2] ^ buf3 ^ buf1;
-        buf3 = state[3]^buf2;     buf3=galois_mul2(buf3); state[3] = state[3] ^ buf3 ^ buf1;
-        // col2
-        buf1 = state[4] ^ state[5] ^ state[6] ^ state[7];
-        buf2 = state[4];
-        buf3 = state[4]^state[5]; buf3=galois_mul2(buf3); state[4] = state[4] ^ buf3 ^ buf1;
-        buf3 = state[5]^state[6]; buf3=galois_mul2(buf3); state[5] = state[5] ^ buf3 ^ buf1;
-        buf3 = state[6]^state[7]; buf3=galois_mul2(buf3); state[6] = state[6] ^ buf3 ^ buf1;
-        buf3 = state[7]^buf2;     buf3=galois_mul2(buf3); state[7] = state[7] ^ buf3 ^ buf1;
-        // col3
-        buf1 = state[8] ^ state[9] ^ state[10] ^ state[11];
-        buf2 = state[8];
-        buf3 = state[8]^state[9];   buf3=galois_mul2(buf3); state[8] = state[8] ^ buf3 ^ buf1;
-        buf3 = state[9]^state[10];  buf3=galois_mul2(buf3); state[9] = state[9] ^ buf3 ^ buf1;
-        buf3 = state[10]^state[11]; buf3=galois_mul2(buf3); state[10] = state[10] ^ buf3 ^ buf1;
-        buf3 = state[11]^buf2;      buf3=galois_mul2(buf3); state[11] = state[11] ^ buf3 ^ buf1;
-        // col4
-        buf1 = state[12] ^ state[13] ^ state[14] ^ state[15];
-        buf2 = state[12];
-        buf3 = state[12]^state[13]; buf3=galois_mul2(buf3); state[12] = state[12] ^ buf3 ^ buf1;
-        buf3 = state[13]^state[14]; buf3=galois_mul2(buf3); state[13] = state[13] ^ buf3 ^ buf1;
-        buf3 = state[14]^state[15]; buf3=galois_mul2(buf3); state[14] = state[14] ^ buf3 ^ buf1;
-        buf3 = state[15]^buf2;      buf3=galois_mul2(buf3); state[15] = state[15] ^ buf3 ^ buf1;
-
-        // addroundkey, rsbox and shiftrows
-        // row 0
-        state[ 0]  = rsbox[state[ 0]] ^ expandedKey[(round*16)     ];
-        state[ 4]  = rsbox[state[ 4]] ^ expandedKey[(round*16) +  4];
-        state[ 8]  = rsbox[state[ 8]] ^ expandedKey[(round*16) +  8];
-        state[12]  = rsbox[state[12]] ^ expandedKey[(round*16) + 12];
-        // row 1
-        buf1 =       rsbox[state[13]] ^ expandedKey[(round*16) +  1];
-        state[13]  = rsbox[state[ 9]] ^ expandedKey[(round*16) + 13];
-        state[ 9]  = rsbox[state[ 5]] ^ expandedKey[(round*16) +  9];
-        state[ 5]  = rsbox[state[ 1]] ^ expandedKey[(round*16) +  5];
-        state[ 1]  = buf1;
-        // row 2
-        buf1 =       rsbox[state[ 2]] ^ expandedKey[(round*16) + 10];
-        buf2 =       rsbox[state[ 6]] ^ expandedKey[(round*16) + 14];
-        state[ 2]  = rsbox[state[10]] ^ expandedKey[(round*16) +  2];
-        state[ 6]  = rsbox[state[14]] ^ expandedKey[(round*16) +  6];
-        state[10]  = buf1;
-        state[14]  = buf2;
-        // row 3
-        buf1 =       rsbox[state[ 3]] ^ expandedKey[(round*16) + 15];
-        state[ 3]  = rsbox[state[ 7]] ^ expandedKey[(round*16) +  3];
-        state[ 7]  = rsbox[state[11]] ^ expandedKey[(round*16) +  7];
-        state[11]  = rsbox[state[15]] ^ expandedKey[(round*16) + 11];
-        state[15]  = buf1;
-    }
-
-        states=state;
+    jsize length = env->GetArrayLength(array);
+    if (length > AES_BLOCK_SIZE)
+        length = AES_BLOCK_SIZE;
+    memset(block, 0, AES_BLOCK_SIZE);
+    env->GetByteArrayRegion(array, 0, length, reinterpret_cast<jbyte *>(block));
 }
 
-
-unsigned char expandedKey[176];
-
-// encrypt
-void wcl_sw_aes_encrypt(unsigned char *state,
-                        unsigned char *key)
-{
-//    unsigned char expandedKey[176];
-
-    expandKey(expandedKey, key);       // expand the key into 176 bytes
-    aes_encr(state, expandedKey);
-}
-// decrypt
-void wcl_sw_aes_decrypt(unsigned char *state,
-                        unsigned char *key)
+// in place over whole blocks of [offset, offset + length) in memory of the given size; returns
+// the bytes processed, or -1 when the range does not lie inside it
+static jint crypt_range(const aes_context *ctx, jboolean encrypt, unsigned char *base, jlong size, jint offset,
+                        jint length)
 {
-//    unsigned char expandedKey[176];
-
-    expandKey(expandedKey, key);       // expand the key into 176 bytes
-    aes_decr(state, expandedKey);
+    if (ctx == NULL || base == NULL || offset < 0 || length < 0 || (jlong)offset + length > size)
+        return -1;
+    probe_scope probe(encrypt ? PROBE_AES_ENCRYPT : PROBE_AES_DECRYPT, length);
+    size_t processed = encrypt ? aes_context_encrypt(ctx, base + offset, length)
+                               : aes_context_decrypt(ctx, base + offset, length);
+    return (jint)processed;
 }
 
 extern "C" JNIEXPORT jbyteArray JNICALL
 Java_com_trial_bluetoothtrials_AdvertisementActivityKt_aesDecrypt(JNIEnv *env, jclass clazz,
                                                                   jbyteArray entry,jbyteArray key) {
-    unsigned char decryptedValue[16];
-    unsigned char * input= reinterpret_cast<unsigned char *>(env->GetByteArrayElements(entry,
-                                                                                       NULL));
-    unsigned char * keyinp= reinterpret_cast<unsigned char *>(env->GetByteArrayElements(key,
-                                                                                       NULL));
+    probe_scope jni(PROBE_JNI);
+    unsigned char block[AES_BLOCK_SIZE];
+    unsigned char keyinp[AES_BLOCK_SIZE];
+    read_block(env, entry, block);
+    read_block(env, key, keyinp);
 
-    wcl_sw_aes_decrypt(input,keyinp);
-    jbyteArray ret = env->NewByteArray(16);
-    env->SetByteArrayRegion(ret, 0, 16, reinterpret_cast<const jbyte *>(states));
+    {
+        probe_scope probe(PROBE_AES_DECRYPT, AES_BLOCK_SIZE);
+        wcl_sw_aes_decrypt(block, keyinp);
+    }
+    memset(keyinp, 0, sizeof(keyinp));
+    jbyteArray ret = env->NewByteArray(AES_BLOCK_SIZE);
+    env->SetByteArrayRegion(ret, 0, AES_BLOCK_SIZE, reinterpret_cast<const jbyte *>(block));
     return ret;
 }extern "C"
 JNIEXPORT jbyteArray JNICALL
 Java_com_trial_bluetoothtrials_AdvertisementActivityKt_aesEncrypt(JNIEnv *env, jclass clazz,
                                                                   jbyteArray entry,jbyteArray key) {
-    unsigned char encryptedValue[16];
-    unsigned char * input= reinterpret_cast<unsigned char *>(env->GetByteArrayElements(entry,
-                                                                                       NULL));
-    unsigned char * keyinp= reinterpret_cast<unsigned char *>(env->GetByteArrayElements(key,
-                                                                                        NULL));
+    probe_scope jni(PROBE_JNI);
+    unsigned char block[AES_BLOCK_SIZE];
+    unsigned char keyinp[AES_BLOCK_SIZE];
+    read_block(env, entry, block);
+    read_block(env, key, keyinp);
 
-    wcl_sw_aes_encrypt(input,keyinp);
-    jbyteArray ret = env->NewByteArray(16);
-    env->SetByteArrayRegion(ret, 0, 16, reinterpret_cast<const jbyte *>(states));
+    {
+        probe_scope probe(PROBE_AES_ENCRYPT, AES_BLOCK_SIZE);
+        wcl_sw_aes_encrypt(block, keyinp);
+    }
+    memset(keyinp, 0, sizeof(keyinp));
+    jbyteArray ret = env->NewByteArray(AES_BLOCK_SIZE);
+    env->SetByteArrayRegion(ret, 0, AES_BLOCK_SIZE, reinterpret_cast<const jbyte *>(block));
+    return ret;
+}extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_trial_bluetoothtrials_AdvertisementActivityKt_aesCreateContext(JNIEnv *env, jclass clazz,
+                                                                        jbyteArray key) {
+    unsigned char keyinp[AES_MAX_KEY_SIZE];
+    size_t keyLength = read_key(env, key, keyinp);
+    if (keyLength == 0)
+        return 0;
+    aes_context *ctx = new aes_context;
+    aes_context_init_key(ctx, keyinp, keyLength);
+    memset(keyinp, 0, sizeof(keyinp));
+    return reinterpret_cast<jlong>(ctx);
+}extern "C"
+JNIEXPORT void JNICALL
+Java_com_trial_bluetoothtrials_AdvertisementActivityKt_aesDestroyContext(JNIEnv *env, jclass clazz,
+                                                                         jlong context) {
+    aes_context *ctx = reinterpret_cast<aes_context *>(context);
+    if (ctx != NULL) {
+        memset(ctx, 0, sizeof(aes_context));
+        delete ctx;
+    }
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_AdvertisementActivityKt_aesContextEncrypt(JNIEnv *env, jclass clazz,
+                                                                         jlong context, jbyteArray entry) {
+    probe_scope jni(PROBE_JNI);
+    const aes_context *ctx = reinterpret_cast<const aes_context *>(context);
+    if (ctx == NULL)
+        return NULL;
+    jsize length = env->GetArrayLength(entry);
+    std::vector<unsigned char> buffer(length);
+    env->GetByteArrayRegion(entry, 0, length, reinterpret_cast<jbyte *>(buffer.data()));
+    jni.bytes = length;
+    size_t outLength;
+    {
+        probe_scope probe(PROBE_AES_ENCRYPT, length);
+        outLength = aes_context_encrypt(ctx, buffer.data(), buffer.size());
+    }
+    jbyteArray ret = env->NewByteArray(outLength);
+    env->SetByteArrayRegion(ret, 0, outLength, reinterpret_cast<const jbyte *>(buffer.data()));
+    return ret;
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_AdvertisementActivityKt_aesContextDecrypt(JNIEnv *env, jclass clazz,
+                                                                         jlong context, jbyteArray entry) {
+    probe_scope jni(PROBE_JNI);
+    const aes_context *ctx = reinterpret_cast<const aes_context *>(context);
+    if (ctx == NULL)
+        return NULL;
+    jsize length = env->GetArrayLength(entry);
+    std::vector<unsigned char> buffer(length);
+    env->GetByteArrayRegion(entry, 0, length, reinterpret_cast<jbyte *>(buffer.data()));
+    jni.bytes = length;
+    size_t outLength;
+    {
+        probe_scope probe(PROBE_AES_DECRYPT, length);
+        outLength = aes_context_decrypt(ctx, buffer.data(), buffer.size());
+    }
+    jbyteArray ret = env->NewByteArray(outLength);
+    env->SetByteArrayRegion(ret, 0, outLength, reinterpret_cast<const jbyte *>(buffer.data()));
+    return ret;
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_AdvertisementActivityKt_aesContextCryptDirect(JNIEnv *env, jclass clazz,
+                                                                             jlong context, jboolean encrypt,
+                                                                             jobject buffer, jint offset,
+                                                                             jint length) {
+    probe_scope jni(PROBE_JNI);
+    if (context == 0)
+        return -1;
+    // the buffer is direct, so the blocks are encrypted where they are and nothing is allocated
+    unsigned char *base = static_cast<unsigned char *>(env->GetDirectBufferAddress(buffer));
+    return crypt_range(reinterpret_cast<const aes_context *>(context), encrypt, base,
+                       env->GetDirectBufferCapacity(buffer), offset, length);
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_AdvertisementActivityKt_aesContextCryptArray(JNIEnv *env, jclass clazz,
+                                                                            jlong context, jboolean encrypt,
+                                                                            jbyteArray array, jint offset,
+                                                                            jint length) {
+    probe_scope jni(PROBE_JNI);
+    if (context == 0)
+        return -1;
+    // pinned rather than copied; the critical section is only the cipher, which never calls back into the VM
+    jsize size = env->GetArrayLength(array);
+    unsigned char *base = static_cast<unsigned char *>(env->GetPrimitiveArrayCritical(array, NULL));
+    if (base == NULL)
+        return -1;
+    jint processed = crypt_range(reinterpret_cast<const aes_context *>(context), encrypt, base, size, offset,
+                                 length);
+    env->ReleasePrimitiveArrayCritical(array, base, processed > 0 ? 0 : JNI_ABORT);
+    return processed;
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_AdvertisementActivityKt_aesCipher(JNIEnv *env, jclass clazz, jint mode,
+                                                                 jboolean encrypt, jbyteArray key,
+                                                                 jbyteArray iv, jbyteArray entry) {
+    probe_scope jni(PROBE_JNI);
+    aes_stream stream;
+    unsigned char keyinp[AES_MAX_KEY_SIZE];
+    unsigned char ivinp[AES_BLOCK_SIZE] = {0};
+    size_t keyLength = read_key(env, key, keyinp);
+    if (keyLength == 0)
+        return NULL;
+    if (iv != NULL && env->GetArrayLength(iv) >= AES_BLOCK_SIZE)
+        env->GetByteArrayRegion(iv, 0, AES_BLOCK_SIZE, reinterpret_cast<jbyte *>(ivinp));
+    if (aes_stream_init(&stream, mode, encrypt, keyinp, keyLength, ivinp) != 0)
+        return NULL;
+    jsize length = env->GetArrayLength(entry);
+    std::vector<unsigned char> buffer(length);
+    env->GetByteArrayRegion(entry, 0, length, reinterpret_cast<jbyte *>(buffer.data()));
+    size_t outLength;
+    jni.bytes = length;
+    {
+        probe_scope probe(PROBE_AES_MODE, length);
+        if (mode == AES_MODE_CTR)
+            outLength = aes_ctr_crypt(&stream.ctx, stream.iv, buffer.data(), buffer.data(), buffer.size());
+        else if (mode == AES_MODE_CBC)
+            outLength = encrypt ? aes_cbc_encrypt(&stream.ctx, stream.iv, buffer.data(), buffer.data(), buffer.size())
+                                : aes_cbc_decrypt(&stream.ctx, stream.iv, buffer.data(), buffer.data(), buffer.size());
+        else
+            outLength = encrypt ? aes_ecb_encrypt(&stream.ctx, buffer.data(), buffer.data(), buffer.size())
+                                : aes_ecb_decrypt(&stream.ctx, buffer.data(), buffer.data(), buffer.size());
+    }
+    aes_stream_final(&stream);
+    memset(keyinp, 0, sizeof(keyinp));
+    if (outLength != buffer.size())
+        return NULL;
+    jbyteArray ret = env->NewByteArray(outLength);
+    env->SetByteArrayRegion(ret, 0, outLength, reinterpret_cast<const jbyte *>(buffer.data()));
     return ret;
-}
\ No newline at end of file
+}extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_trial_bluetoothtrials_AdvertisementActivityKt_aesStreamCreate(JNIEnv *env, jclass clazz, jint mode,
+                                                                       jboolean encrypt, jbyteArray key,
+                                                                       jbyteArray iv) {
+    unsigned char keyinp[AES_MAX_KEY_SIZE];
+    unsigned char ivinp[AES_BLOCK_SIZE] = {0};
+    size_t keyLength = read_key(env, key, keyinp);
+    if (keyLength == 0)
+        return 0;
+    if (iv != NULL && env->GetArrayLength(iv) >= AES_BLOCK_SIZE)
+        env->GetByteArrayRegion(iv, 0, AES_BLOCK_SIZE, reinterpret_cast<jbyte *>(ivinp));
+    aes_stream *stream = new aes_stream;
+    int result = aes_stream_init(stream, mode, encrypt, keyinp, keyLength, ivinp);
+    memset(keyinp, 0, sizeof(keyinp));
+    if (result != 0) {
+        delete stream;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(stream);
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_AdvertisementActivityKt_aesStreamUpdate(JNIEnv *env, jclass clazz, jlong handle,
+                                                                       jbyteArray entry) {
+    probe_scope jni(PROBE_JNI);
+    aes_stream *stream = reinterpret_cast<aes_stream *>(handle);
+    if (stream == NULL)
+        return NULL;
+    jsize length = env->GetArrayLength(entry);
+    std::vector<unsigned char> input(length);
+    std::vector<unsigned char> output(length + AES_BLOCK_SIZE);
+    env->GetByteArrayRegion(entry, 0, length, reinterpret_cast<jbyte *>(input.data()));
+    jni.bytes = length;
+    size_t outLength;
+    {
+        probe_scope probe(PROBE_AES_MODE, length);
+        outLength = aes_stream_update(stream, input.data(), input.size(), output.data());
+    }
+    jbyteArray ret = env->NewByteArray(outLength);
+    env->SetByteArrayRegion(ret, 0, outLength, reinterpret_cast<const jbyte *>(output.data()));
+    return ret;
+}extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_trial_bluetoothtrials_AdvertisementActivityKt_aesStreamFinal(JNIEnv *env, jclass clazz, jlong handle) {
+    aes_stream *stream = reinterpret_cast<aes_stream *>(handle);
+    if (stream == NULL)
+        return false;
+    int result = aes_stream_final(stream);
+    delete stream;
+    return result == 0;
+}extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_trial_bluetoothtrials_Utility_AdvertisementRotatorKt_advRotatorCreate(JNIEnv *env, jclass clazz,
+                                                                               jbyteArray key, jbyteArray identity,
+                                                                               jint intervalMs, jint capacity) {
+    unsigned char keyinp[AES_MAX_KEY_SIZE];
+    unsigned char id[ADV_IDENTITY_SIZE] = {0};
+    size_t keyLength = read_key(env, key, keyinp);
+    if (keyLength == 0 || capacity <= 0)
+        return 0;
+    jsize idLength = env->GetArrayLength(identity);
+    env->GetByteArrayRegion(identity, 0, idLength < ADV_IDENTITY_SIZE ? idLength : ADV_IDENTITY_SIZE,
+                            reinterpret_cast<jbyte *>(id));
+    // slots count from the unix epoch so every receiver derives the same slot from its own clock
+    adv_rotator *rotator = new adv_rotator;
+    int result = adv_rotator_init(rotator, keyinp, keyLength, id, 0, (int64_t)intervalMs * 1000000, capacity);
+    memset(keyinp, 0, sizeof(keyinp));
+    if (result != 0) {
+        delete rotator;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(rotator);
+}extern "C"
+JNIEXPORT void JNICALL
+Java_com_trial_bluetoothtrials_Utility_AdvertisementRotatorKt_advRotatorDestroy(JNIEnv *env, jclass clazz,
+                                                                                jlong handle) {
+    adv_rotator *rotator = reinterpret_cast<adv_rotator *>(handle);
+    if (rotator != NULL) {
+        memset(&rotator->ctx, 0, sizeof(rotator->ctx));
+        delete rotator;
+    }
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_AdvertisementRotatorKt_advRotatorRefill(JNIEnv *env, jclass clazz,
+                                                                               jlong handle, jlong timeMs) {
+    if (handle == 0)
+        return -1;
+    return adv_rotator_refill(reinterpret_cast<adv_rotator *>(handle), timeMs * 1000000);
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_AdvertisementRotatorKt_advRotatorPayload(JNIEnv *env, jclass clazz,
+                                                                                jlong handle, jlong timeMs,
+                                                                                jbyteArray out) {
+    adv_rotator *rotator = reinterpret_cast<adv_rotator *>(handle);
+    if (rotator == NULL || env->GetArrayLength(out) < ADV_PAYLOAD_SIZE)
+        return -1;
+    unsigned char payload[ADV_PAYLOAD_SIZE];
+    int cached = adv_rotator_payload(rotator, adv_rotator_slot(rotator, timeMs * 1000000), payload);
+    env->SetByteArrayRegion(out, 0, ADV_PAYLOAD_SIZE, reinterpret_cast<const jbyte *>(payload));
+    return cached;
+}extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_com_trial_bluetoothtrials_Utility_AdvertisementRotatorKt_advRotatorStats(JNIEnv *env, jclass clazz,
+                                                                              jlong handle, jlong timeMs) {
+    if (handle == 0)
+        return NULL;
+    adv_rotator_stats stats;
+    adv_rotator_get_stats(reinterpret_cast<adv_rotator *>(handle), timeMs * 1000000, &stats);
+    jlong values[] = {(jlong)stats.generated, (jlong)stats.generateNs, (jlong)stats.refills, (jlong)stats.hits,
+                      (jlong)stats.misses, (jlong)stats.cached, (jlong)stats.payloadsPerSecond};
+    jlongArray ret = env->NewLongArray(sizeof(values) / sizeof(values[0]));
+    env->SetLongArrayRegion(ret, 0, sizeof(values) / sizeof(values[0]), values);
+    return ret;
+}
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_trial_bluetoothtrials_Utility_ProbesKt_aesProbeRegistry(JNIEnv *env, jclass clazz) {
+    // handed to probeSnapshot in native-lib, which merges it with its own
+    return reinterpret_cast<jlong>(probe_local_registry());
+}
@@ -0,0 +1,252 @@
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "aes-modes.h"
+
+// blocks handed to the engine in one call, large enough for the hardware engines to interleave
+#define AES_BATCH_BLOCKS 64
+
+static void xor_block(unsigned char *out, const unsigned char *a, const unsigned char *b, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+        out[i] = a[i] ^ b[i];
+}
+
+// add value to a 128-bit big-endian counter
+static void counter_add(unsigned char *counter, uint64_t value)
+{
+    for (int i = AES_BLOCK_SIZE - 1; i >= 0 && value != 0; i--) {
+        value += counter[i];
+        counter[i] = (unsigned char)value;
+        value >>= 8;
+    }
+}
+
+size_t aes_ecb_encrypt(const aes_context *ctx, const unsigned char *in, unsigned char *out, size_t length)
+{
+    length -= length % AES_BLOCK_SIZE;
+    if (in != out)
+        memmove(out, in, length);
+    return aes_context_encrypt(ctx, out, length);
+}
+
+size_t aes_ecb_decrypt(const aes_context *ctx, const unsigned char *in, unsigned char *out, size_t length)
+{
+    length -= length % AES_BLOCK_SIZE;
+    if (in != out)
+        memmove(out, in, length);
+    return aes_context_decrypt(ctx, out, length);
+}
+
+size_t aes_cbc_encrypt(const aes_context *ctx, unsigned char *iv, const unsigned char *in, unsigned char *out, size_t length)
+{
+    size_t blocks = length / AES_BLOCK_SIZE;
+    // each block depends on the previous ciphertext so this stays serial
+    for (size_t b = 0; b < blocks; b++) {
+        xor_block(out, in, iv, AES_BLOCK_SIZE);
+        ctx->encrypt_blocks(ctx, out, 1);
+        memcpy(iv, out, AES_BLOCK_SIZE);
+        in += AES_BLOCK_SIZE;
+        out += AES_BLOCK_SIZE;
+    }
+    return blocks * AES_BLOCK_SIZE;
+}
+
+size_t aes_cbc_decrypt(const aes_context *ctx, unsigned char *iv, const unsigned char *in, unsigned char *out, size_t length)
+{
+    size_t blocks = length / AES_BLOCK_SIZE;
+    unsigned char saved[AES_BATCH_BLOCKS * AES_BLOCK_SIZE];
+    // decryption has no chaining dependency, so decrypt a batch at once and xor afterwards
+    for (size_t b = 0; b < blocks; b += AES_BATCH_BLOCKS) {
+        size_t n = blocks - b < AES_BATCH_BLOCKS ? blocks - b : AES_BATCH_BLOCKS;
+        size_t bytes = n * AES_BLOCK_SIZE;
+        memcpy(saved, in, bytes);
+        memcpy(out, saved, bytes);
+        ctx->decrypt_blocks(ctx, out, n);
+        xor_block(out, out, iv, AES_BLOCK_SIZE);
+        xor_block(out + AES_BLOCK_SIZE, out + AES_BLOCK_SIZE, saved, bytes - AES_BLOCK_SIZE);
+        memcpy(iv, saved + bytes - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+        in += bytes;
+        out += bytes;
+    }
+    return blocks * AES_BLOCK_SIZE;
+}
+
+// CTR over one contiguous range, counter already positioned at its first block
+static void ctr_segment(const aes_context *ctx, const unsigned char *counter, const unsigned char *in,
+                        unsigned char *out, size_t length)
+{
+    unsigned char ctr[AES_BLOCK_SIZE];
+    unsigned char keystream[AES_BATCH_BLOCKS * AES_BLOCK_SIZE];
+    memcpy(ctr, counter, AES_BLOCK_SIZE);
+    while (length > 0) {
+        size_t bytes = length < sizeof(keystream) ? length : sizeof(keystream);
+        size_t n = (bytes + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+        for (size_t i = 0; i < n; i++) {
+            memcpy(keystream + i * AES_BLOCK_SIZE, ctr, AES_BLOCK_SIZE);
+            counter_add(ctr, 1);
+        }
+        ctx->encrypt_blocks(ctx, keystream, n);
+        xor_block(out, in, keystream, bytes);
+        in += bytes;
+        out += bytes;
+        length -= bytes;
+    }
+}
+
+size_t aes_ctr_crypt(const aes_context *ctx, unsigned char *counter, const unsigned char *in, unsigned char *out, size_t length)
+{
+    size_t blocks = (length + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+    unsigned int workers = std::thread::hardware_concurrency();
+    if (length < AES_CTR_PARALLEL_THRESHOLD || workers < 2) {
+        ctr_segment(ctx, counter, in, out, length);
+    } else {
+        // every block's keystream only depends on its counter, so each worker seeks to its own
+        size_t perWorker = (blocks + workers - 1) / workers * AES_BLOCK_SIZE;
+        std::vector<std::thread> threads;
+        for (size_t offset = perWorker; offset < length; offset += perWorker) {
+            size_t segment = length - offset < perWorker ? length - offset : perWorker;
+            threads.emplace_back([ctx, counter, in, out, offset, segment]() {
+                unsigned char ctr[AES_BLOCK_SIZE];
+                memcpy(ctr, counter, AES_BLOCK_SIZE);
+                counter_add(ctr, offset / AES_BLOCK_SIZE);
+                ctr_segment(ctx, ctr, in + offset, out + offset, segment);
+            });
+        }
+        ctr_segment(ctx, counter, in, out, perWorker);
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+    counter_add(counter, blocks);
+    return length;
+}
+
+int aes_stream_init(aes_stream *stream, int mode, int encrypt, const unsigned char *key, size_t keyLength,
+                    const unsigned char *iv)
+{
+    if (mode != AES_MODE_ECB && mode != AES_MODE_CBC && mode != AES_MODE_CTR)
+        return -1;
+    if (aes_context_init_key(&stream->ctx, key, keyLength) != 0)
+        return -1;
+    stream->mode = mode;
+    stream->encrypt = encrypt;
+    if (iv != NULL)
+        memcpy(stream->iv, iv, AES_BLOCK_SIZE);
+    else
+        memset(stream->iv, 0, AES_BLOCK_SIZE);
+    stream->buffered = 0;
+    return 0;
+}
+
+static size_t stream_blocks(aes_stream *stream, const unsigned char *in, unsigned char *out, size_t length)
+{
+    if (stream->mode == AES_MODE_ECB)
+        return stream->encrypt ? aes_ecb_encrypt(&stream->ctx, in, out, length)
+                               : aes_ecb_decrypt(&stream->ctx, in, out, length);
+    return stream->encrypt ? aes_cbc_encrypt(&stream->ctx, stream->iv, in, out, length)
+                           : aes_cbc_decrypt(&stream->ctx, stream->iv, in, out, length);
+}
+
+size_t aes_stream_update(aes_stream *stream, const unsigned char *in, size_t length, unsigned char *out)
+{
+    size_t written = 0;
+    if (stream->mode == AES_MODE_CTR) {
+        // use up keystream left over from the previous partial block first
+        while (stream->buffered != 0 && length > 0) {
+            *out++ = *in++ ^ stream->buffer[stream->buffered];
+            stream->buffered = (stream->buffered + 1) % AES_BLOCK_SIZE;
+            length--;
+            written++;
+        }
+        size_t whole = length - length % AES_BLOCK_SIZE;
+        written += aes_ctr_crypt(&stream->ctx, stream->iv, in, out, whole);
+        size_t tail = length - whole;
+        if (tail != 0) {
+            memcpy(stream->buffer, stream->iv, AES_BLOCK_SIZE);
+            stream->ctx.encrypt_blocks(&stream->ctx, stream->buffer, 1);
+            counter_add(stream->iv, 1);
+            xor_block(out + whole, in + whole, stream->buffer, tail);
+            stream->buffered = tail;
+            written += tail;
+        }
+        return written;
+    }
+    // ECB/CBC: complete the pending block, then run whole blocks straight from the input
+    if (stream->buffered != 0) {
+        size_t take = AES_BLOCK_SIZE - stream->buffered < length ? AES_BLOCK_SIZE - stream->buffered : length;
+        memcpy(stream->buffer + stream->buffered, in, take);
+        stream->buffered += take;
+        in += take;
+        length -= take;
+        if (stream->buffered < AES_BLOCK_SIZE)
+            return 0;
+        written += stream_blocks(stream, stream->buffer, out, AES_BLOCK_SIZE);
+        stream->buffered = 0;
+    }
+    written += stream_blocks(stream, in, out + written, length);
+    size_t tail = length % AES_BLOCK_SIZE;
+    memcpy(stream->buffer, in + length - tail, tail);
+    stream->buffered = tail;
+    return written;
+}
+
+int aes_stream_final(aes_stream *stream)
+{
+    int result = (stream->mode != AES_MODE_CTR && stream->buffered != 0) ? -1 : 0;
+    memset(stream, 0, sizeof(aes_stream));
+    return result;
+}
+
+// doubling in GF(2^128), the subkey derivation of RFC 4493
+static void cmac_double(unsigned char *out, const unsigned char *in)
+{
+    unsigned char carry = in[0] & 0x80;
+    for (int i = 0; i < AES_BLOCK_SIZE - 1; i++)
+        out[i] = (unsigned char)((in[i] << 1) | (in[i + 1] >> 7));
+    out[AES_BLOCK_SIZE - 1] = (unsigned char)(in[AES_BLOCK_SIZE - 1] << 1);
+    if (carry)
+        out[AES_BLOCK_SIZE - 1] ^= 0x87;
+}
+
+void aes_cmac_init(aes_cmac *cmac, unsigned char *key)
+{
+    aes_context_init(&cmac->ctx, key);
+    unsigned char L[AES_BLOCK_SIZE] = {0};
+    aes_context_encrypt(&cmac->ctx, L, AES_BLOCK_SIZE);
+    cmac_double(cmac->k1, L);
+    cmac_double(cmac->k2, cmac->k1);
+    memset(cmac->mac, 0, AES_BLOCK_SIZE);
+    cmac->buffered = 0;
+}
+
+void aes_cmac_update(aes_cmac *cmac, const unsigned char *in, size_t length)
+{
+    while (length > 0) {
+        if (cmac->buffered == AES_BLOCK_SIZE) {
+            xor_block(cmac->mac, cmac->mac, cmac->buffer, AES_BLOCK_SIZE);
+            aes_context_encrypt(&cmac->ctx, cmac->mac, AES_BLOCK_SIZE);
+            cmac->buffered = 0;
+        }
+        size_t take = AES_BLOCK_SIZE - cmac->buffered;
+        if (take > length)
+            take = length;
+        memcpy(cmac->buffer + cmac->buffered, in, take);
+        cmac->buffered += take;
+        in += take;
+        length -= take;
+    }
+}
+
+void aes_cmac_final(const aes_cmac *cmac, unsigned char *tag)
+{
+    unsigned char last[AES_BLOCK_SIZE] = {0};
+    memcpy(last, cmac->buffer, cmac->buffered);
+    if (cmac->buffered == AES_BLOCK_SIZE) {
+        xor_block(last, last, cmac->k1, AES_BLOCK_SIZE);
+    } else {
+        last[cmac->buffered] = 0x80;
+        xor_block(last, last, cmac->k2, AES_BLOCK_SIZE);
+    }
+    xor_block(tag, cmac->mac, last, AES_BLOCK_SIZE);
+    aes_context_encrypt(&cmac->ctx, tag, AES_BLOCK_SIZE);
+}
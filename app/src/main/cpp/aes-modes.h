@@ -0,0 +1,57 @@
+#ifndef AES_MODES_H
+#define AES_MODES_H
+
+#include "aes-core.h"
+
+// values shared with the Kotlin AES_MODE_* constants
+#define AES_MODE_ECB 0
+#define AES_MODE_CBC 1
+#define AES_MODE_CTR 2
+
+// CTR buffers at least this large are split across worker threads
+#define AES_CTR_PARALLEL_THRESHOLD (64 * 1024)
+
+// one-shot modes over whole buffers, in and out may be the same buffer
+// ECB and CBC take whole AES_BLOCK_SIZE blocks only (no padding, like AES/ECB/NoPadding)
+// and return the number of bytes processed; CTR takes any length and returns length
+size_t aes_ecb_encrypt(const aes_context *ctx, const unsigned char *in, unsigned char *out, size_t length);
+size_t aes_ecb_decrypt(const aes_context *ctx, const unsigned char *in, unsigned char *out, size_t length);
+size_t aes_cbc_encrypt(const aes_context *ctx, unsigned char *iv, const unsigned char *in, unsigned char *out, size_t length);
+size_t aes_cbc_decrypt(const aes_context *ctx, unsigned char *iv, const unsigned char *in, unsigned char *out, size_t length);
+// counter is the 128-bit big-endian initial counter block, left pointing at the next unused block
+size_t aes_ctr_crypt(const aes_context *ctx, unsigned char *counter, const unsigned char *in, unsigned char *out, size_t length);
+
+// incremental cipher for streamed input
+struct aes_stream {
+    aes_context ctx;
+    int mode;
+    int encrypt;
+    unsigned char iv[AES_BLOCK_SIZE];       // CBC chaining value or next CTR counter block
+    unsigned char buffer[AES_BLOCK_SIZE];   // pending input (ECB/CBC) or unused keystream (CTR)
+    size_t buffered;
+};
+
+// keyLength 16, 24 or 32 bytes; returns 0 on success, -1 for an unknown mode or key length
+int aes_stream_init(aes_stream *stream, int mode, int encrypt, const unsigned char *key, size_t keyLength,
+                    const unsigned char *iv);
+// out must hold length + AES_BLOCK_SIZE bytes and not overlap in, returns the bytes written
+size_t aes_stream_update(aes_stream *stream, const unsigned char *in, size_t length, unsigned char *out);
+// returns 0 when every byte was consumed, -1 when ECB/CBC input ended inside a block
+int aes_stream_final(aes_stream *stream);
+
+// AES-CMAC (RFC 4493) over streamed input
+struct aes_cmac {
+    aes_context ctx;
+    unsigned char k1[AES_BLOCK_SIZE];
+    unsigned char k2[AES_BLOCK_SIZE];
+    unsigned char mac[AES_BLOCK_SIZE];      // chaining value over the blocks absorbed so far
+    unsigned char buffer[AES_BLOCK_SIZE];   // last block, held back until more input or final
+    size_t buffered;
+};
+
+void aes_cmac_init(aes_cmac *cmac, unsigned char *key);
+void aes_cmac_update(aes_cmac *cmac, const unsigned char *in, size_t length);
+// tag of everything absorbed so far; leaves the state as it was so updates may continue
+void aes_cmac_final(const aes_cmac *cmac, unsigned char *tag);
+
+#endif //AES_MODES_H
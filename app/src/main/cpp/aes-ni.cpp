@@ -0,0 +1,94 @@
+#include "aes-core.h"
+#include "aes-rounds.h"
+
+// AES-NI engine for x86 devices, emulators and the host build
+// compiled with -maes -msse4.1, only entered after the CPU reported support at runtime
+
+#if defined(__AES__) && defined(__SSE4_1__)
+#include <wmmintrin.h>
+#include <cpuid.h>
+
+template <int Rounds>
+static void aesni_encrypt_blocks(const aes_context *ctx, unsigned char *data, size_t blocks)
+{
+    __m128i rk[Rounds + 1];
+    for (int i = 0; i <= Rounds; i++)
+        rk[i] = _mm_load_si128(reinterpret_cast<const __m128i *>(ctx->expandedKey) + i);
+    size_t b = 0;
+    // four independent blocks keep the aesenc pipeline busy
+    for (; b + 4 <= blocks; b += 4, data += 4 * AES_BLOCK_SIZE) {
+        __m128i *p = reinterpret_cast<__m128i *>(data);
+        __m128i s0 = _mm_xor_si128(_mm_loadu_si128(p), rk[0]);
+        __m128i s1 = _mm_xor_si128(_mm_loadu_si128(p + 1), rk[0]);
+        __m128i s2 = _mm_xor_si128(_mm_loadu_si128(p + 2), rk[0]);
+        __m128i s3 = _mm_xor_si128(_mm_loadu_si128(p + 3), rk[0]);
+        aes_unroll<Rounds - 1>([&](auto round) {
+            s0 = _mm_aesenc_si128(s0, rk[round + 1]);
+            s1 = _mm_aesenc_si128(s1, rk[round + 1]);
+            s2 = _mm_aesenc_si128(s2, rk[round + 1]);
+            s3 = _mm_aesenc_si128(s3, rk[round + 1]);
+        });
+        _mm_storeu_si128(p, _mm_aesenclast_si128(s0, rk[Rounds]));
+        _mm_storeu_si128(p + 1, _mm_aesenclast_si128(s1, rk[Rounds]));
+        _mm_storeu_si128(p + 2, _mm_aesenclast_si128(s2, rk[Rounds]));
+        _mm_storeu_si128(p + 3, _mm_aesenclast_si128(s3, rk[Rounds]));
+    }
+    for (; b < blocks; b++, data += AES_BLOCK_SIZE) {
+        __m128i *p = reinterpret_cast<__m128i *>(data);
+        __m128i s = _mm_xor_si128(_mm_loadu_si128(p), rk[0]);
+        aes_unroll<Rounds - 1>([&](auto round) { s = _mm_aesenc_si128(s, rk[round + 1]); });
+        _mm_storeu_si128(p, _mm_aesenclast_si128(s, rk[Rounds]));
+    }
+}
+
+template <int Rounds>
+static void aesni_decrypt_blocks(const aes_context *ctx, unsigned char *data, size_t blocks)
+{
+    __m128i rk[Rounds + 1];
+    for (int i = 0; i <= Rounds; i++)
+        rk[i] = _mm_load_si128(reinterpret_cast<const __m128i *>(ctx->decryptKey) + i);
+    size_t b = 0;
+    for (; b + 4 <= blocks; b += 4, data += 4 * AES_BLOCK_SIZE) {
+        __m128i *p = reinterpret_cast<__m128i *>(data);
+        __m128i s0 = _mm_xor_si128(_mm_loadu_si128(p), rk[0]);
+        __m128i s1 = _mm_xor_si128(_mm_loadu_si128(p + 1), rk[0]);
+        __m128i s2 = _mm_xor_si128(_mm_loadu_si128(p + 2), rk[0]);
+        __m128i s3 = _mm_xor_si128(_mm_loadu_si128(p + 3), rk[0]);
+        aes_unroll<Rounds - 1>([&](auto round) {
+            s0 = _mm_aesdec_si128(s0, rk[round + 1]);
+            s1 = _mm_aesdec_si128(s1, rk[round + 1]);
+            s2 = _mm_aesdec_si128(s2, rk[round + 1]);
+            s3 = _mm_aesdec_si128(s3, rk[round + 1]);
+        });
+        _mm_storeu_si128(p, _mm_aesdeclast_si128(s0, rk[Rounds]));
+        _mm_storeu_si128(p + 1, _mm_aesdeclast_si128(s1, rk[Rounds]));
+        _mm_storeu_si128(p + 2, _mm_aesdeclast_si128(s2, rk[Rounds]));
+        _mm_storeu_si128(p + 3, _mm_aesdeclast_si128(s3, rk[Rounds]));
+    }
+    for (; b < blocks; b++, data += AES_BLOCK_SIZE) {
+        __m128i *p = reinterpret_cast<__m128i *>(data);
+        __m128i s = _mm_xor_si128(_mm_loadu_si128(p), rk[0]);
+        aes_unroll<Rounds - 1>([&](auto round) { s = _mm_aesdec_si128(s, rk[round + 1]); });
+        _mm_storeu_si128(p, _mm_aesdeclast_si128(s, rk[Rounds]));
+    }
+}
+
+const aes_engine *aes_engine_aesni()
+{
+    static const aes_engine engine = {"aesni", AES_KERNELS(aesni_encrypt_blocks),
+                                      AES_KERNELS(aesni_decrypt_blocks)};
+    static const bool supported = []() {
+        unsigned int eax, ebx, ecx, edx;
+        return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES) && (ecx & bit_SSE4_1);
+    }();
+    return supported ? &engine : NULL;
+}
+
+#else
+
+const aes_engine *aes_engine_aesni()
+{
+    return NULL;
+}
+
+#endif
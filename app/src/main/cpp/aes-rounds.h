@@ -0,0 +1,33 @@
+#ifndef AES_ROUNDS_H
+#define AES_ROUNDS_H
+
+#include <utility>
+
+// compile-time shape of the cipher for one key size. Engines instantiate their block functions
+// per round count, so every round loop has a constant bound and is unrolled; the 128-bit path
+// is exactly what it was before the larger keys existed
+template <int KeyBytes>
+struct aes_key_size {
+    static_assert(KeyBytes == 16 || KeyBytes == 24 || KeyBytes == 32, "AES keys are 128, 192 or 256 bits");
+    static constexpr int keyWords = KeyBytes / 4;
+    static constexpr int rounds = keyWords + 6;
+    static constexpr int expandedSize = 16 * (rounds + 1);
+};
+
+template <typename F, int... I>
+__attribute__((always_inline)) inline void aes_unroll_impl(F &f, std::integer_sequence<int, I...>)
+{
+    (f(std::integral_constant<int, I>()), ...);
+}
+
+// calls f(std::integral_constant<int, 0>()) ... f(std::integral_constant<int, N - 1>()), unrolled
+template <int N, typename F>
+__attribute__((always_inline)) inline void aes_unroll(F &&f)
+{
+    aes_unroll_impl(f, std::make_integer_sequence<int, N>());
+}
+
+// an engine's kernel instantiated for 128, 192 and 256-bit keys, in aes_engine order
+#define AES_KERNELS(kernel) {kernel<10>, kernel<12>, kernel<14>}
+
+#endif //AES_ROUNDS_H
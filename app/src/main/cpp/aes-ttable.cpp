@@ -0,0 +1,85 @@
+#include "aes-core.h"
+#include "aes-rounds.h"
+
+// 32-bit T-table AES, SubBytes+ShiftRows+MixColumns folded into four table lookups per column
+// the tables are the constexpr aesTables, generated with the S-box so they cannot drift from it
+
+#define GETU32(p) (((uint32_t)(p)[0] << 24) ^ ((uint32_t)(p)[1] << 16) ^ ((uint32_t)(p)[2] << 8) ^ ((uint32_t)(p)[3]))
+#define PUTU32(p, v) { (p)[0] = (unsigned char)((v) >> 24); (p)[1] = (unsigned char)((v) >> 16); \
+                       (p)[2] = (unsigned char)((v) >> 8); (p)[3] = (unsigned char)(v); }
+
+static const uint32_t (&Te)[4][256] = aesTables.Te;
+static const uint32_t (&Td)[4][256] = aesTables.Td;
+static const unsigned char *const sbox = aesTables.sbox;
+static const unsigned char *const rsbox = aesTables.rsbox;
+
+template <int Rounds>
+static void ttable_encrypt_blocks(const aes_context *ctx, unsigned char *data, size_t blocks)
+{
+    uint32_t rk[4 * (Rounds + 1)];
+    for (int i = 0; i < 4 * (Rounds + 1); i++)
+        rk[i] = GETU32(ctx->expandedKey + 4 * i);
+    for (size_t b = 0; b < blocks; b++, data += AES_BLOCK_SIZE) {
+        uint32_t s0 = GETU32(data) ^ rk[0], s1 = GETU32(data + 4) ^ rk[1];
+        uint32_t s2 = GETU32(data + 8) ^ rk[2], s3 = GETU32(data + 12) ^ rk[3];
+        uint32_t t0, t1, t2, t3;
+        aes_unroll<Rounds - 1>([&](auto round) {
+            const uint32_t *k = rk + 4 * (round + 1);
+            t0 = Te[0][s0 >> 24] ^ Te[1][(s1 >> 16) & 0xff] ^ Te[2][(s2 >> 8) & 0xff] ^ Te[3][s3 & 0xff] ^ k[0];
+            t1 = Te[0][s1 >> 24] ^ Te[1][(s2 >> 16) & 0xff] ^ Te[2][(s3 >> 8) & 0xff] ^ Te[3][s0 & 0xff] ^ k[1];
+            t2 = Te[0][s2 >> 24] ^ Te[1][(s3 >> 16) & 0xff] ^ Te[2][(s0 >> 8) & 0xff] ^ Te[3][s1 & 0xff] ^ k[2];
+            t3 = Te[0][s3 >> 24] ^ Te[1][(s0 >> 16) & 0xff] ^ Te[2][(s1 >> 8) & 0xff] ^ Te[3][s2 & 0xff] ^ k[3];
+            s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+        });
+        // last round without mixcolumns
+        const uint32_t *k = rk + 4 * Rounds;
+        t0 = ((uint32_t)sbox[s0 >> 24] << 24) ^ ((uint32_t)sbox[(s1 >> 16) & 0xff] << 16)
+             ^ ((uint32_t)sbox[(s2 >> 8) & 0xff] << 8) ^ sbox[s3 & 0xff] ^ k[0];
+        t1 = ((uint32_t)sbox[s1 >> 24] << 24) ^ ((uint32_t)sbox[(s2 >> 16) & 0xff] << 16)
+             ^ ((uint32_t)sbox[(s3 >> 8) & 0xff] << 8) ^ sbox[s0 & 0xff] ^ k[1];
+        t2 = ((uint32_t)sbox[s2 >> 24] << 24) ^ ((uint32_t)sbox[(s3 >> 16) & 0xff] << 16)
+             ^ ((uint32_t)sbox[(s0 >> 8) & 0xff] << 8) ^ sbox[s1 & 0xff] ^ k[2];
+        t3 = ((uint32_t)sbox[s3 >> 24] << 24) ^ ((uint32_t)sbox[(s0 >> 16) & 0xff] << 16)
+             ^ ((uint32_t)sbox[(s1 >> 8) & 0xff] << 8) ^ sbox[s2 & 0xff] ^ k[3];
+        PUTU32(data, t0); PUTU32(data + 4, t1); PUTU32(data + 8, t2); PUTU32(data + 12, t3);
+    }
+}
+
+template <int Rounds>
+static void ttable_decrypt_blocks(const aes_context *ctx, unsigned char *data, size_t blocks)
+{
+    uint32_t rk[4 * (Rounds + 1)];
+    for (int i = 0; i < 4 * (Rounds + 1); i++)
+        rk[i] = GETU32(ctx->decryptKey + 4 * i);
+    for (size_t b = 0; b < blocks; b++, data += AES_BLOCK_SIZE) {
+        uint32_t s0 = GETU32(data) ^ rk[0], s1 = GETU32(data + 4) ^ rk[1];
+        uint32_t s2 = GETU32(data + 8) ^ rk[2], s3 = GETU32(data + 12) ^ rk[3];
+        uint32_t t0, t1, t2, t3;
+        aes_unroll<Rounds - 1>([&](auto round) {
+            const uint32_t *k = rk + 4 * (round + 1);
+            t0 = Td[0][s0 >> 24] ^ Td[1][(s3 >> 16) & 0xff] ^ Td[2][(s2 >> 8) & 0xff] ^ Td[3][s1 & 0xff] ^ k[0];
+            t1 = Td[0][s1 >> 24] ^ Td[1][(s0 >> 16) & 0xff] ^ Td[2][(s3 >> 8) & 0xff] ^ Td[3][s2 & 0xff] ^ k[1];
+            t2 = Td[0][s2 >> 24] ^ Td[1][(s1 >> 16) & 0xff] ^ Td[2][(s0 >> 8) & 0xff] ^ Td[3][s3 & 0xff] ^ k[2];
+            t3 = Td[0][s3 >> 24] ^ Td[1][(s2 >> 16) & 0xff] ^ Td[2][(s1 >> 8) & 0xff] ^ Td[3][s0 & 0xff] ^ k[3];
+            s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+        });
+        // last round without invmixcolumns
+        const uint32_t *k = rk + 4 * Rounds;
+        t0 = ((uint32_t)rsbox[s0 >> 24] << 24) ^ ((uint32_t)rsbox[(s3 >> 16) & 0xff] << 16)
+             ^ ((uint32_t)rsbox[(s2 >> 8) & 0xff] << 8) ^ rsbox[s1 & 0xff] ^ k[0];
+        t1 = ((uint32_t)rsbox[s1 >> 24] << 24) ^ ((uint32_t)rsbox[(s0 >> 16) & 0xff] << 16)
+             ^ ((uint32_t)rsbox[(s3 >> 8) & 0xff] << 8) ^ rsbox[s2 & 0xff] ^ k[1];
+        t2 = ((uint32_t)rsbox[s2 >> 24] << 24) ^ ((uint32_t)rsbox[(s1 >> 16) & 0xff] << 16)
+             ^ ((uint32_t)rsbox[(s0 >> 8) & 0xff] << 8) ^ rsbox[s3 & 0xff] ^ k[2];
+        t3 = ((uint32_t)rsbox[s3 >> 24] << 24) ^ ((uint32_t)rsbox[(s2 >> 16) & 0xff] << 16)
+             ^ ((uint32_t)rsbox[(s1 >> 8) & 0xff] << 8) ^ rsbox[s0 & 0xff] ^ k[3];
+        PUTU32(data, t0); PUTU32(data + 4, t1); PUTU32(data + 8, t2); PUTU32(data + 12, t3);
+    }
+}
+
+const aes_engine *aes_engine_ttable()
+{
+    static const aes_engine engine = {"ttable", AES_KERNELS(ttable_encrypt_blocks),
+                                      AES_KERNELS(ttable_decrypt_blocks)};
+    return &engine;
+}
@@ -0,0 +1,75 @@
+#include <string.h>
+#include "beacon-parser.h"
+
+static_assert(sizeof(beacon_report) == BEACON_REPORT_SIZE, "beacon_report layout is shared with Kotlin");
+
+static inline uint32_t read_be32(const unsigned char *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static int parse_payload(const unsigned char *payload, size_t length, beacon_report *report)
+{
+    if (length < 5)
+        return -1;
+    memset(report, 0, sizeof(*report));
+    report->status = payload[0];
+    report->tagId = read_be32(payload + 1);
+    payload += 5;
+    length -= 5;
+    switch (report->status) {
+        case BEACON_STATUS_INSIDE:
+        case BEACON_STATUS_OUTSIDE: {
+            size_t count = length / 6 < BEACON_LOCATORS ? length / 6 : BEACON_LOCATORS;
+            for (size_t i = 0; i < count; i++, payload += 6) {
+                report->locatorId[i] = read_be32(payload);
+                report->distanceCm[i] = (uint16_t)(payload[4] | payload[5] << 8);
+            }
+            report->locatorCount = (uint8_t)count;
+            return 0;
+        }
+        case BEACON_STATUS_FAILURE:
+            if (length < 2)
+                return -1;
+            report->errorCode = payload[0];
+            report->failureCount = payload[1];
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+int beacon_parse(const unsigned char *record, size_t length, beacon_report *report)
+{
+    size_t offset = 0;
+    // walk the AD structures: length(1) type(1) data(length - 1)
+    while (offset + 1 < length) {
+        size_t fieldLength = record[offset];
+        if (fieldLength == 0 || offset + 1 + fieldLength > length)
+            break;
+        const unsigned char *field = record + offset + 1;
+        if (field[0] == 0xff && fieldLength >= 4 && field[1] == (BEACON_COMPANY_ID & 0xff) &&
+            field[2] == (BEACON_COMPANY_ID >> 8) && field[3] == BEACON_PRODUCT)
+            return parse_payload(field + 4, fieldLength - 4, report);
+        offset += 1 + fieldLength;
+    }
+    return -1;
+}
+
+size_t beacon_parse_batch(const unsigned char *records, size_t length, beacon_report *reports, size_t maxReports)
+{
+    size_t count = 0;
+    size_t offset = 0;
+    for (uint16_t index = 0; offset + 2 <= length && count < maxReports; index++) {
+        size_t recordLength = records[offset] | records[offset + 1] << 8;
+        offset += 2;
+        if (offset + recordLength > length)
+            break;
+        if (beacon_parse(records + offset, recordLength, &reports[count]) == 0) {
+            reports[count].index = index;
+            count++;
+        }
+        offset += recordLength;
+    }
+    return count;
+}
@@ -0,0 +1,41 @@
+#ifndef BEACON_PARSER_H
+#define BEACON_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// locator beacons advertise manufacturer specific data for company 0x0197 (on air 97 01),
+// product byte 0x52, then:
+//   status(1) tag id(4)
+//   status 04/05: up to 3 x { locator id(4) distance in cm(2, little endian) }
+//   status 06:    error code(1) failure count(1)
+// ids are kept as they read on air (big endian) since that is how the lists show them
+#define BEACON_COMPANY_ID 0x0197
+#define BEACON_PRODUCT 0x52
+#define BEACON_STATUS_INSIDE 0x04
+#define BEACON_STATUS_OUTSIDE 0x05
+#define BEACON_STATUS_FAILURE 0x06
+#define BEACON_LOCATORS 3
+
+// decoded report, written as-is into the caller's direct ByteBuffer (native byte order)
+struct beacon_report {
+    uint32_t tagId;
+    uint32_t locatorId[BEACON_LOCATORS];
+    uint16_t distanceCm[BEACON_LOCATORS];
+    uint16_t index;        // position of the scan record in the batch
+    uint8_t status;
+    uint8_t errorCode;     // status 06 only
+    uint8_t failureCount;  // status 06 only
+    uint8_t locatorCount;  // status 04/05 only, entries present in the payload
+};
+#define BEACON_REPORT_SIZE 28
+
+// decodes one raw scan record (the AD structures, trailing zero padding allowed)
+// returns -1 when it is not a locator beacon with a known status
+int beacon_parse(const unsigned char *record, size_t length, beacon_report *report);
+// records holds scan records back to back, each prefixed by its length (2 bytes, little
+// endian); reports for the beacons among them are written in order, up to maxReports
+// returns the number of reports written
+size_t beacon_parse_batch(const unsigned char *records, size_t length, beacon_report *reports, size_t maxReports);
+
+#endif //BEACON_PARSER_H
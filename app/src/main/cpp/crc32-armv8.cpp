@@ -0,0 +1,47 @@
+#include <string.h>
+#include "crc32.h"
+
+// CRC-32 with the ARMv8 CRC32 instructions, eight bytes per instruction
+// compiled with -march=armv8-a+crc, only entered after HWCAP_CRC32 was reported at runtime
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+
+static uint32_t armv8_update(uint32_t crc, const unsigned char *data, size_t length)
+{
+    crc = ~crc;
+    for (; length >= 32; length -= 32, data += 32) {
+        uint64_t v[4];
+        memcpy(v, data, sizeof(v));
+        crc = __crc32d(crc, v[0]);
+        crc = __crc32d(crc, v[1]);
+        crc = __crc32d(crc, v[2]);
+        crc = __crc32d(crc, v[3]);
+    }
+    for (; length >= 8; length -= 8, data += 8) {
+        uint64_t v;
+        memcpy(&v, data, sizeof(v));
+        crc = __crc32d(crc, v);
+    }
+    for (; length > 0; length--, data++)
+        crc = __crc32b(crc, *data);
+    return ~crc;
+}
+
+const crc32_kernel *crc32_kernel_armv8()
+{
+    static const crc32_kernel kernel = {"armv8", armv8_update};
+    static const bool supported = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+    return supported ? &kernel : NULL;
+}
+
+#else
+
+const crc32_kernel *crc32_kernel_armv8()
+{
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,69 @@
+#include <string.h>
+#include "crc32.h"
+
+struct crc32_tables {
+    uint32_t t[8][256];
+};
+
+// t[0] is the byte-wise table, t[k] advances a byte that is k positions further back
+static const crc32_tables &slice8_tables()
+{
+    static const crc32_tables tables = []() {
+        crc32_tables built;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; bit++)
+                c = c & 1 ? (c >> 1) ^ 0xedb88320u : c >> 1;
+            built.t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++)
+            for (int k = 1; k < 8; k++)
+                built.t[k][i] = (built.t[k - 1][i] >> 8) ^ built.t[0][built.t[k - 1][i] & 0xff];
+        return built;
+    }();
+    return tables;
+}
+
+static uint32_t slice8_update(uint32_t crc, const unsigned char *data, size_t length)
+{
+    const crc32_tables &tables = slice8_tables();
+    const uint32_t (*t)[256] = tables.t;
+    crc = ~crc;
+    for (; length >= 8; length -= 8, data += 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, data, 4);
+        memcpy(&hi, data + 4, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        lo = __builtin_bswap32(lo);
+        hi = __builtin_bswap32(hi);
+#endif
+        lo ^= crc;
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    }
+    for (; length > 0; length--, data++)
+        crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xff];
+    return ~crc;
+}
+
+const crc32_kernel *crc32_kernel_slice8()
+{
+    static const crc32_kernel kernel = {"slice8", slice8_update};
+    return &kernel;
+}
+
+const crc32_kernel *crc32_kernel_select()
+{
+    static const crc32_kernel *selected = []() {
+        const crc32_kernel *kernel = crc32_kernel_armv8();
+        if (kernel == NULL)
+            kernel = crc32_kernel_pclmul();
+        return kernel != NULL ? kernel : crc32_kernel_slice8();
+    }();
+    return selected;
+}
+
+uint32_t crc32_update(uint32_t crc, const unsigned char *data, size_t length)
+{
+    return crc32_kernel_select()->update(crc, data, length);
+}
@@ -0,0 +1,27 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3, reflected 0xEDB88320), chained like zlib's crc32(): start from 0 and
+// pass the previous result back in, crc32_update(crc32_update(0, a), b) == crc of a then b
+
+// a CRC backend, every kernel returns the same values as the slicing-by-8 one
+struct crc32_kernel {
+    const char *name;
+    uint32_t (*update)(uint32_t crc, const unsigned char *data, size_t length);
+};
+
+// slicing-by-8 tables, portable
+const crc32_kernel *crc32_kernel_slice8();
+// carry-less multiply folding, NULL when not built for or not supported by this CPU
+const crc32_kernel *crc32_kernel_pclmul();
+// ARMv8 CRC32 instructions, NULL when not built for or not supported by this CPU
+const crc32_kernel *crc32_kernel_armv8();
+// fastest kernel available on this CPU, detected once
+const crc32_kernel *crc32_kernel_select();
+
+uint32_t crc32_update(uint32_t crc, const unsigned char *data, size_t length);
+
+#endif //CRC32_H
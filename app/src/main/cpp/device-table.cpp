@@ -0,0 +1,106 @@
+#include <algorithm>
+#include "device-table.h"
+
+// fibonacci hashing: the top bits of key * 2^64/phi spread MAC and tag ids that differ only in
+// their low bytes
+static inline size_t slot_of(uint64_t key, size_t mask)
+{
+    return (size_t)((key * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+}
+
+static void rehash(device_table *table, size_t slotCount)
+{
+    table->slots.assign(slotCount, -1);
+    size_t mask = slotCount - 1;
+    for (size_t row = 0; row < table->keys.size(); row++) {
+        size_t slot = slot_of(table->keys[row], mask);
+        while (table->slots[slot] != -1)
+            slot = (slot + 1) & mask;
+        table->slots[slot] = (int32_t)row;
+    }
+}
+
+void device_table_init(device_table *table, size_t expectedRows)
+{
+    size_t slotCount = 16;
+    while (slotCount < 2 * expectedRows)
+        slotCount *= 2;
+    table->keys.clear();
+    table->keys.reserve(expectedRows);
+    table->dirty.clear();
+    table->changed.clear();
+    table->reportedRows = 0;
+    table->slots.assign(slotCount, -1);
+}
+
+void device_table_clear(device_table *table)
+{
+    table->keys.clear();
+    table->dirty.clear();
+    table->changed.clear();
+    table->reportedRows = 0;
+    std::fill(table->slots.begin(), table->slots.end(), -1);
+}
+
+int32_t device_table_find(const device_table *table, uint64_t key)
+{
+    size_t mask = table->slots.size() - 1;
+    for (size_t slot = slot_of(key, mask);; slot = (slot + 1) & mask) {
+        int32_t row = table->slots[slot];
+        if (row == -1 || table->keys[row] == key)
+            return row;
+    }
+}
+
+int32_t device_table_upsert(device_table *table, uint64_t key)
+{
+    size_t mask = table->slots.size() - 1;
+    size_t slot = slot_of(key, mask);
+    int32_t row;
+    while ((row = table->slots[slot]) != -1 && table->keys[row] != key)
+        slot = (slot + 1) & mask;
+    if (row == -1) {
+        row = (int32_t)table->keys.size();
+        table->keys.push_back(key);
+        table->dirty.push_back(0);
+        table->slots[slot] = row;
+        // keep the load at or under one half so probes stay short
+        if (2 * table->keys.size() > table->slots.size())
+            rehash(table, 2 * table->slots.size());
+    }
+    if (!table->dirty[row]) {
+        table->dirty[row] = 1;
+        table->changed.push_back(row);
+    }
+    return row;
+}
+
+size_t device_table_rows(const device_table *table)
+{
+    return table->keys.size();
+}
+
+size_t device_table_take_changes(device_table *table, int32_t *insertedStart, int32_t *insertedCount,
+                                 int32_t *ranges, size_t maxRanges)
+{
+    int32_t reported = (int32_t)table->reportedRows;
+    *insertedStart = reported;
+    *insertedCount = (int32_t)table->keys.size() - reported;
+    std::sort(table->changed.begin(), table->changed.end());
+    size_t count = 0;
+    for (int32_t row : table->changed) {
+        table->dirty[row] = 0;
+        if (row >= reported || maxRanges == 0)
+            continue;
+        if (count > 0 && (ranges[2 * count - 2] + ranges[2 * count - 1] == row || count == maxRanges)) {
+            ranges[2 * count - 1] = row + 1 - ranges[2 * count - 2];
+            continue;
+        }
+        ranges[2 * count] = row;
+        ranges[2 * count + 1] = 1;
+        count++;
+    }
+    table->changed.clear();
+    table->reportedRows = table->keys.size();
+    return count;
+}
@@ -0,0 +1,34 @@
+#ifndef DEVICE_TABLE_H
+#define DEVICE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// scanner rows keyed by device: the 6-byte MAC or the 4-byte tag id packed into 64 bits
+// rows are dense and stable (a key keeps its row until the table is cleared), which is what
+// the list adapters index by; lookup is open addressing with linear probing over row numbers
+struct device_table {
+    std::vector<uint64_t> keys;      // row -> key
+    std::vector<int32_t> slots;      // hash slot -> row, -1 when empty; power of two size
+    std::vector<uint8_t> dirty;      // row -> changed since the last device_table_take_changes
+    std::vector<int32_t> changed;    // rows set in dirty, unsorted
+    size_t reportedRows;             // row count at the last device_table_take_changes
+};
+
+void device_table_init(device_table *table, size_t expectedRows);
+void device_table_clear(device_table *table);
+// returns the row of key, adding it as the next row when new; the row is marked changed
+int32_t device_table_upsert(device_table *table, uint64_t key);
+// returns the row of key or -1
+int32_t device_table_find(const device_table *table, uint64_t key);
+size_t device_table_rows(const device_table *table);
+
+// rows added since the last call are [*insertedStart, *insertedStart + *insertedCount);
+// rows changed before that are written as (start, count) pairs to ranges, merged where they
+// touch; when more than maxRanges are needed the last one is stretched over the rest
+// returns the number of ranges written and clears the changes
+size_t device_table_take_changes(device_table *table, int32_t *insertedStart, int32_t *insertedCount,
+                                 int32_t *ranges, size_t maxRanges);
+
+#endif //DEVICE_TABLE_H
@@ -0,0 +1,139 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "firmware-image.h"
+#include "lz-block.h"
+
+int firmware_image_open(firmware_image *image, const char *path)
+{
+    struct stat st;
+    image->fd = open(path, O_RDONLY | O_CLOEXEC);
+    image->mapping = NULL;
+    image->rawSize = 0;
+    image->packed = NULL;
+    image->data = NULL;
+    image->size = 0;
+    image->chunkSize = 0;
+    image->chunkCount = 0;
+    if (image->fd < 0)
+        return -1;
+    if (fstat(image->fd, &st) != 0) {
+        close(image->fd);
+        image->fd = -1;
+        return -1;
+    }
+    image->size = st.st_size;
+    image->rawSize = image->size;
+    if (image->size == 0)
+        return 0;
+    void *mapping = mmap(NULL, image->size, PROT_READ, MAP_PRIVATE, image->fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(image->fd);
+        image->fd = -1;
+        image->size = 0;
+        image->rawSize = 0;
+        return -1;
+    }
+    // OTA walks the image front to back exactly once
+    madvise(mapping, image->size, MADV_SEQUENTIAL);
+    image->mapping = static_cast<const unsigned char *>(mapping);
+    image->data = image->mapping;
+    return 0;
+}
+
+void firmware_image_close(firmware_image *image)
+{
+    if (image->mapping != NULL)
+        munmap(const_cast<unsigned char *>(image->mapping), image->rawSize);
+    free(image->packed);
+    if (image->fd >= 0)
+        close(image->fd);
+    image->fd = -1;
+    image->mapping = NULL;
+    image->packed = NULL;
+    image->data = NULL;
+    image->size = 0;
+    image->rawSize = 0;
+    image->chunkCount = 0;
+}
+
+long firmware_image_compress(firmware_image *image, size_t blockSize)
+{
+    lz_encoder encoder;
+    if (image->mapping == NULL || image->packed != NULL ||
+        lz_encoder_init(&encoder, image->mapping, image->rawSize, blockSize) != 0)
+        return -1;
+    // only the output is ever allocated; it grows as blocks come out and gives up as soon as
+    // it is no smaller than the image
+    size_t bound = lz_encoder_bound(&encoder);
+    size_t capacity = image->rawSize / 2 + bound;
+    unsigned char *packed = static_cast<unsigned char *>(malloc(capacity));
+    if (packed == NULL)
+        return -1;
+    size_t written;
+    while ((written = lz_encoder_next(&encoder, packed + encoder.produced)) > 0) {
+        if (encoder.produced >= image->rawSize) {
+            free(packed);
+            return -1;
+        }
+        if (capacity - encoder.produced < bound) {
+            capacity = capacity * 2 < image->rawSize + bound ? capacity * 2 : image->rawSize + bound;
+            unsigned char *grown = static_cast<unsigned char *>(realloc(packed, capacity));
+            if (grown == NULL) {
+                free(packed);
+                return -1;
+            }
+            packed = grown;
+        }
+    }
+    // frames only carry whole RC5 blocks, pad so the last one does not lose the stream's tail
+    size_t size = encoder.produced;
+    while (size % RC5_ENC_BLOCK_SIZE != 0)
+        packed[size++] = 0;
+    if (size >= image->rawSize) {
+        free(packed);
+        return -1;
+    }
+    unsigned char *shrunk = static_cast<unsigned char *>(realloc(packed, size));
+    image->packed = shrunk != NULL ? shrunk : packed;
+    image->data = image->packed;
+    image->size = size;
+    // chunks come from the stream now, the mapped pages can go back to the page cache
+    madvise(const_cast<unsigned char *>(image->mapping), image->rawSize, MADV_DONTNEED);
+    if (image->chunkSize != 0)
+        firmware_image_set_chunk_size(image, image->chunkSize);
+    return (long)image->size;
+}
+
+void firmware_image_set_chunk_size(firmware_image *image, size_t chunkSize)
+{
+    if (chunkSize == 0 || chunkSize > image->size)
+        chunkSize = image->size;
+    // frames only carry whole RC5 blocks, a partial one in the middle of the image would be lost
+    else if (chunkSize < image->size)
+        chunkSize = chunkSize < RC5_ENC_BLOCK_SIZE ? RC5_ENC_BLOCK_SIZE : chunkSize - chunkSize % RC5_ENC_BLOCK_SIZE;
+    image->chunkSize = chunkSize;
+    image->chunkCount = chunkSize == 0 ? 0 : image->size / chunkSize + (image->size % chunkSize != 0 ? 1 : 0);
+}
+
+firmware_chunk firmware_image_chunk(const firmware_image *image, size_t index)
+{
+    firmware_chunk chunk = {NULL, 0};
+    if (index >= image->chunkCount)
+        return chunk;
+    size_t offset = index * image->chunkSize;
+    chunk.data = image->data + offset;
+    chunk.size = image->size - offset < image->chunkSize ? image->size - offset : image->chunkSize;
+    return chunk;
+}
+
+size_t firmware_image_encrypt_frame(const firmware_image *image, const rc5_session *session, size_t index,
+                                    unsigned char *frame)
+{
+    firmware_chunk chunk = firmware_image_chunk(image, index);
+    if (chunk.data == NULL)
+        return 0;
+    return rc5_session_encrypt_frame(session, chunk.data, chunk.size, frame);
+}
@@ -0,0 +1,44 @@
+#ifndef FIRMWARE_IMAGE_H
+#define FIRMWARE_IMAGE_H
+
+#include <stddef.h>
+#include "rc5-core.h"
+
+// firmware file mapped read-only and described as blocks of chunks without copying it
+// the block/chunk layout follows File.setFileBlockSize in SPOTA mode: one block holding
+// every chunk of the image
+// data/size are what goes over the air: the mapping itself, or its compressed stream
+struct firmware_image {
+    int fd;
+    const unsigned char *mapping;
+    size_t rawSize;
+    unsigned char *packed;
+    const unsigned char *data;
+    size_t size;
+    size_t chunkSize;
+    size_t chunkCount;
+};
+
+// zero-copy view of one chunk inside the mapping
+struct firmware_chunk {
+    const unsigned char *data;
+    size_t size;
+};
+
+// returns 0 on success, -1 when the file cannot be opened or mapped
+int firmware_image_open(firmware_image *image, const char *path);
+void firmware_image_close(firmware_image *image);
+// switches the chunks over to the LZ-block stream of the image (see lz-block.h), encoded block by
+// block straight from the mapping; returns the compressed size, or -1 when it would not shrink
+// the image, which then stays as it was
+long firmware_image_compress(firmware_image *image, size_t blockSize);
+// chunkSize is rounded down to whole RC5 blocks, 0 makes the whole image one chunk
+void firmware_image_set_chunk_size(firmware_image *image, size_t chunkSize);
+// returns a chunk with data NULL when index is out of range
+firmware_chunk firmware_image_chunk(const firmware_image *image, size_t index);
+// encrypts chunk index with the session key into its OTA frame, frame must hold
+// cipher_rc5_frame_size(chunkSize) bytes; returns the frame length or 0 when index is out of range
+size_t firmware_image_encrypt_frame(const firmware_image *image, const rc5_session *session, size_t index,
+                                    unsigned char *frame);
+
+#endif //FIRMWARE_IMAGE_H
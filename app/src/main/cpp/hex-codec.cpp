@@ -0,0 +1,122 @@
+#include "hex-codec.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+static inline int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+#if defined(__SSE2__)
+
+// nibble -> '0'..'9' / 'A'..'F' without a table: add '0', and 7 more above 9
+static inline __m128i nibble_ascii_sse2(__m128i n)
+{
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8(7));
+    return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), letters);
+}
+
+// 16 characters -> their nibble values; valid gets 0xff in every lane that was a hex digit
+static inline __m128i ascii_nibble_sse2(__m128i c, __m128i &valid)
+{
+    const __m128i minusOne = _mm_set1_epi8(-1);
+    __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(digit, minusOne), _mm_cmplt_epi8(digit, _mm_set1_epi8(10)));
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(letter, minusOne), _mm_cmplt_epi8(letter, _mm_set1_epi8(6)));
+    valid = _mm_or_si128(isDigit, isLetter);
+    return _mm_or_si128(_mm_and_si128(isDigit, digit),
+                        _mm_and_si128(isLetter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+// nibble pairs (high first) in 16-bit lanes -> one byte per lane
+static inline __m128i join_nibbles_sse2(__m128i v)
+{
+    return _mm_or_si128(_mm_and_si128(_mm_slli_epi16(v, 4), _mm_set1_epi16(0x00f0)), _mm_srli_epi16(v, 8));
+}
+
+#endif
+
+void hex_encode(const unsigned char *in, size_t length, char *out)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    for (; i + 16 <= length; i += 16, out += 32) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        __m128i hi = nibble_ascii_sse2(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        __m128i lo = nibble_ascii_sse2(_mm_and_si128(v, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out) + 1, _mm_unpackhi_epi8(hi, lo));
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t mask = vdupq_n_u8(0x0f);
+    for (; i + 16 <= length; i += 16, out += 32) {
+        uint8x16_t v = vld1q_u8(in + i);
+        uint8x16x2_t pair;
+        pair.val[0] = vshrq_n_u8(v, 4);
+        pair.val[1] = vandq_u8(v, mask);
+        for (int k = 0; k < 2; k++)
+            pair.val[k] = vaddq_u8(vaddq_u8(pair.val[k], vdupq_n_u8('0')),
+                                   vandq_u8(vcgtq_u8(pair.val[k], vdupq_n_u8(9)), vdupq_n_u8(7)));
+        vst2q_u8(reinterpret_cast<uint8_t *>(out), pair);
+    }
+#endif
+    for (; i < length; i++) {
+        *out++ = hexDigits[in[i] >> 4];
+        *out++ = hexDigits[in[i] & 0x0f];
+    }
+}
+
+int hex_decode(const char *in, size_t length, unsigned char *out)
+{
+    if (length % 2 != 0)
+        return -1;
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 32 <= length; i += 32, out += 16) {
+        __m128i valid0, valid1;
+        __m128i v0 = ascii_nibble_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)), valid0);
+        __m128i v1 = ascii_nibble_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i) + 1), valid1);
+        if (_mm_movemask_epi8(_mm_and_si128(valid0, valid1)) != 0xffff)
+            return -1;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_packus_epi16(join_nibbles_sse2(v0), join_nibbles_sse2(v1)));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 32 <= length; i += 32, out += 16) {
+        uint8x16x2_t pair = vld2q_u8(reinterpret_cast<const uint8_t *>(in + i));
+        uint8x16_t valid = vdupq_n_u8(0xff);
+        uint8x16_t nibble[2];
+        for (int k = 0; k < 2; k++) {
+            uint8x16_t digit = vsubq_u8(pair.val[k], vdupq_n_u8('0'));
+            uint8x16_t letter = vsubq_u8(vorrq_u8(pair.val[k], vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+            uint8x16_t isDigit = vcltq_u8(digit, vdupq_n_u8(10));
+            uint8x16_t isLetter = vcltq_u8(letter, vdupq_n_u8(6));
+            valid = vandq_u8(valid, vorrq_u8(isDigit, isLetter));
+            nibble[k] = vorrq_u8(vandq_u8(isDigit, digit), vandq_u8(isLetter, vaddq_u8(letter, vdupq_n_u8(10))));
+        }
+        uint64x2_t lanes = vreinterpretq_u64_u8(valid);
+        if ((vgetq_lane_u64(lanes, 0) & vgetq_lane_u64(lanes, 1)) != ~0ull)
+            return -1;
+        vst1q_u8(out, vorrq_u8(vshlq_n_u8(nibble[0], 4), nibble[1]));
+    }
+#endif
+    for (; i < length; i += 2) {
+        int hi = hex_value(in[i]), lo = hex_value(in[i + 1]);
+        if (hi < 0 || lo < 0)
+            return -1;
+        *out++ = (unsigned char)(hi << 4 | lo);
+    }
+    return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef HEX_CODEC_H
+#define HEX_CODEC_H
+
+#include <stddef.h>
+
+// upper-case hex text for the cases that still need it (logs, list rows, parcels)
+// SSE2 on x86 and NEON on ARM handle 16 bytes per step, the tail is done a byte at a time
+
+// writes 2 * length characters to out, no terminator
+void hex_encode(const unsigned char *in, size_t length, char *out);
+// reads length characters (either case) into length / 2 bytes; returns -1 on an odd
+// length or a non-hex character, in which case out is partly written
+int hex_decode(const char *in, size_t length, unsigned char *out);
+
+#endif //HEX_CODEC_H
@@ -0,0 +1,114 @@
+// Rolling advertisement payloads: every payload decrypts to identity and slot, cached and
+// on-the-spot payloads agree, refills only encrypt what is missing, and readers racing a
+// refill always see a correct payload.
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include "adv-rotator.h"
+#include "check.h"
+
+static const unsigned char key[16] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                                      0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+static const unsigned char identity[ADV_IDENTITY_SIZE] = {'b', 'e', 'a', 'c', 'o', 'n', 0, 7};
+static const int64_t interval = 250000000; // 250 ms
+
+// what a receiver does: decrypt and check identity and slot
+static bool decodes_to(const unsigned char *payload, uint64_t slot)
+{
+    aes_context ctx;
+    aes_context_init_key_engine(&ctx, key, sizeof(key), aes_engine_reference());
+    unsigned char block[ADV_PAYLOAD_SIZE];
+    memcpy(block, payload, ADV_PAYLOAD_SIZE);
+    aes_context_decrypt(&ctx, block, ADV_PAYLOAD_SIZE);
+    uint64_t decoded = 0;
+    for (int i = 0; i < 8; i++)
+        decoded = decoded << 8 | block[ADV_IDENTITY_SIZE + i];
+    return memcmp(block, identity, ADV_IDENTITY_SIZE) == 0 && decoded == slot;
+}
+
+static void test_init()
+{
+    adv_rotator rotator;
+    CHECK(adv_rotator_init(&rotator, key, 20, identity, 0, interval, 8) == -1, "bad key length");
+    CHECK(adv_rotator_init(&rotator, key, 16, identity, 0, 0, 8) == -1, "zero interval");
+    CHECK(adv_rotator_init(&rotator, key, 16, identity, 0, interval, 0) == -1, "zero capacity");
+    CHECK(adv_rotator_init(&rotator, key, 16, identity, 1000, interval, 8) == 0, "init");
+    CHECK(adv_rotator_slot(&rotator, 0) == 0, "before epoch");
+    CHECK(adv_rotator_slot(&rotator, 1000 + 3 * interval - 1) == 2, "slot boundary");
+    CHECK(adv_rotator_slot(&rotator, 1000 + 3 * interval) == 3, "next slot");
+}
+
+static void test_cache()
+{
+    adv_rotator rotator;
+    adv_rotator_init(&rotator, key, sizeof(key), identity, 0, interval, 64);
+    const int64_t now = 1700000000LL * 1000000000LL;
+    const uint64_t current = adv_rotator_slot(&rotator, now);
+
+    unsigned char payload[ADV_PAYLOAD_SIZE], again[ADV_PAYLOAD_SIZE];
+    CHECK(adv_rotator_payload(&rotator, current, payload) == 0, "miss before refill");
+    CHECK(decodes_to(payload, current), "miss payload decodes");
+    CHECK(adv_rotator_refill(&rotator, now) == 64, "first refill");
+    CHECK(adv_rotator_refill(&rotator, now) == 0, "nothing missing");
+    CHECK(adv_rotator_payload(&rotator, current, again) == 1 && memcmp(payload, again, sizeof(again)) == 0,
+          "cached equals on-the-spot");
+    bool all = true;
+    for (uint64_t slot = current; slot < current + 64; slot++)
+        all = adv_rotator_payload(&rotator, slot, payload) == 1 && decodes_to(payload, slot) && all;
+    CHECK(all, "every cached slot decodes");
+    CHECK(adv_rotator_payload(&rotator, current + 64, payload) == 0, "beyond the cache");
+    CHECK(adv_rotator_payload(&rotator, current - 1, payload) == 0, "before the cache");
+
+    // ten slots later only those ten are encrypted, and the oldest ones are gone
+    CHECK(adv_rotator_refill(&rotator, now + 10 * interval) == 10, "top up");
+    CHECK(adv_rotator_payload(&rotator, current + 73, payload) == 1 && decodes_to(payload, current + 73),
+          "topped up slot");
+    CHECK(adv_rotator_payload(&rotator, current + 5, payload) == 0, "overwritten slot not served");
+
+    // a long pause leaves a gap, the cache restarts at the new now
+    CHECK(adv_rotator_refill(&rotator, now + 1000 * interval) == 64, "refill after a gap");
+    CHECK(adv_rotator_payload(&rotator, current + 1000, payload) == 1 && decodes_to(payload, current + 1000),
+          "slot after the gap");
+    CHECK(adv_rotator_payload(&rotator, current + 73, payload) == 0, "slot before the gap");
+
+    adv_rotator_stats stats;
+    adv_rotator_get_stats(&rotator, now + 1000 * interval, &stats);
+    CHECK(stats.generated == 138 && stats.refills == 3 && stats.cached == 64, "generation stats");
+    CHECK(stats.hits == 67 && stats.misses == 5, "hit stats");
+    printf("generated %llu payloads at %.0f/s, %llu hits, %llu misses\n", (unsigned long long)stats.generated,
+           stats.payloadsPerSecond, (unsigned long long)stats.hits, (unsigned long long)stats.misses);
+}
+
+// rotation on one thread while another keeps the cache topped up
+static void test_concurrent()
+{
+    adv_rotator rotator;
+    adv_rotator_init(&rotator, key, sizeof(key), identity, 0, 1000, 256);
+    std::atomic<int64_t> now(0);
+    std::atomic<bool> done(false);
+    std::thread refiller([&]() {
+        while (!done)
+            adv_rotator_refill(&rotator, now);
+    });
+    bool correct = true;
+    unsigned char payload[ADV_PAYLOAD_SIZE];
+    for (int i = 0; i < 20000; i++) {
+        now += 100;
+        uint64_t slot = adv_rotator_slot(&rotator, now);
+        adv_rotator_payload(&rotator, slot, payload);
+        correct = decodes_to(payload, slot) && correct;
+    }
+    done = true;
+    refiller.join();
+    CHECK(correct, "payloads correct under a concurrent refill");
+}
+
+int main()
+{
+    test_init();
+    test_cache();
+    test_concurrent();
+    return check_summary("adv-rotator");
+}
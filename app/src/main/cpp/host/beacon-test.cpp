@@ -0,0 +1,124 @@
+// Tests for the locator beacon parser and the hex codec, run on the host through ctest.
+// The records mirror what LoggerScanActivity receives: flags, the 0x0197 manufacturer data
+// and zero padding up to the 62-byte legacy scan record.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "beacon-parser.h"
+#include "hex-codec.h"
+#include "check.h"
+
+static std::vector<unsigned char> hex(const char *text)
+{
+    std::vector<unsigned char> bytes(strlen(text) / 2);
+    CHECK(hex_decode(text, strlen(text), bytes.data()) == 0, "hex fixture");
+    return bytes;
+}
+
+static std::vector<unsigned char> padded(const char *text)
+{
+    std::vector<unsigned char> record = hex(text);
+    record.resize(62);
+    return record;
+}
+
+static void test_parse_zone()
+{
+    // status 04, tag 0000162e, locators 00000101 at 2.50 m, 00000102 at 3.00 m, 00000103 at 0.75 m
+    std::vector<unsigned char> record =
+            padded("0201061bff970152040000162e" "00000101fa00" "000001022c01" "000001034b00");
+    beacon_report report;
+    CHECK(beacon_parse(record.data(), record.size(), &report) == 0, "zone parse");
+    CHECK(report.status == BEACON_STATUS_INSIDE && report.tagId == 0x162e, "zone tag");
+    CHECK(report.locatorCount == 3, "zone locator count");
+    CHECK(report.locatorId[0] == 0x101 && report.distanceCm[0] == 250, "zone locator a");
+    CHECK(report.locatorId[1] == 0x102 && report.distanceCm[1] == 300, "zone locator b");
+    CHECK(report.locatorId[2] == 0x103 && report.distanceCm[2] == 75, "zone locator c");
+}
+
+static void test_parse_failure_and_rejects()
+{
+    std::vector<unsigned char> record = padded("0201060bff970152060000162e0203");
+    beacon_report report;
+    CHECK(beacon_parse(record.data(), record.size(), &report) == 0, "failure parse");
+    CHECK(report.status == BEACON_STATUS_FAILURE && report.errorCode == 2 && report.failureCount == 3,
+          "failure fields");
+
+    const char *rejects[] = {
+            "0201060bff970152070000162e0203",   // unknown status
+            "0201060bff980152060000162e0203",   // other company
+            "0201060bff970153060000162e0203",   // other product
+            "0201060bff970152060000162e02",     // field runs past the record
+            "0201060509ff970152",               // not manufacturer data
+    };
+    for (const char *text : rejects) {
+        std::vector<unsigned char> bad = hex(text);
+        CHECK(beacon_parse(bad.data(), bad.size(), &report) == -1, text);
+    }
+}
+
+static void test_parse_batch()
+{
+    const char *texts[] = {"0201060bff970152060000162e0203", "0201060bff980152060000162e0203",
+                           "0201060aff97015205000000070000"};
+    std::vector<unsigned char> batch;
+    for (const char *text : texts) {
+        std::vector<unsigned char> record = padded(text);
+        batch.push_back((unsigned char)record.size());
+        batch.push_back(0);
+        batch.insert(batch.end(), record.begin(), record.end());
+    }
+    beacon_report reports[4];
+    CHECK(beacon_parse_batch(batch.data(), batch.size(), reports, 4) == 2, "batch count");
+    CHECK(reports[0].index == 0 && reports[0].tagId == 0x162e, "batch first");
+    CHECK(reports[1].index == 2 && reports[1].tagId == 7 && reports[1].locatorCount == 0, "batch third");
+    CHECK(beacon_parse_batch(batch.data(), batch.size(), reports, 1) == 1, "batch capacity");
+    CHECK(beacon_parse_batch(batch.data(), batch.size() - 1, reports, 4) == 1, "batch truncated");
+}
+
+// the SIMD paths must match a plain %02X formatter at every length around 16 and 32
+static void test_hex_codec()
+{
+    for (size_t length = 0; length < 80; length++) {
+        std::vector<unsigned char> bytes(length);
+        std::string expected;
+        for (size_t i = 0; i < length; i++) {
+            bytes[i] = (unsigned char)(i * 37 + length);
+            char digits[3];
+            snprintf(digits, sizeof(digits), "%02X", bytes[i]);
+            expected += digits;
+        }
+        std::string text(2 * length, '\0');
+        hex_encode(bytes.data(), length, &text[0]);
+        CHECK(text == expected, "hex encode");
+        // decoding takes either case
+        for (size_t i = 0; i < text.size(); i += 3)
+            if (text[i] >= 'A')
+                text[i] += 'a' - 'A';
+        std::vector<unsigned char> decoded(length);
+        CHECK(hex_decode(text.data(), text.size(), decoded.data()) == 0 && decoded == bytes, "hex decode");
+        if (length > 0) {
+            for (size_t bad = 0; bad < text.size(); bad += 7) {
+                std::string broken = text;
+                broken[bad] = bad % 2 ? 'g' : (char)0xc1;
+                CHECK(hex_decode(broken.data(), broken.size(), decoded.data()) == -1, "hex decode reject");
+            }
+        }
+    }
+    unsigned char out;
+    CHECK(hex_decode("abc", 3, &out) == -1, "hex decode odd length");
+    const char *boundaries[] = {"/0", ":0", "@0", "G0", "`0", "g0"};
+    for (const char *text : boundaries)
+        CHECK(hex_decode(text, 2, &out) == -1, text);
+}
+
+int main()
+{
+    test_parse_zone();
+    test_parse_failure_and_rejects();
+    test_parse_batch();
+    test_hex_codec();
+    return check_summary("beacon parser");
+}
@@ -0,0 +1,23 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+
+// shared by the host tests: CHECK reports a failed condition and carries on, main() ends with
+// return check_summary("...") so ctest sees the failures in the exit code
+
+static int failures = 0;
+
+#define CHECK(cond, name) do { if (!(cond)) { printf("FAIL %s (%s:%d)\n", name, __FILE__, __LINE__); failures++; } } while (0)
+
+static int check_summary(const char *suite)
+{
+    if (failures != 0) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all %s tests passed\n", suite);
+    return 0;
+}
+
+#endif //CHECK_H
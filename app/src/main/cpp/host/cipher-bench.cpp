@@ -0,0 +1,183 @@
+// Throughput benchmark for the cipher cores.
+//   cipher-bench [--quick] [--json] [--threads N]
+// Prints one row per path: cycles per byte, blocks per second and MB/s; key-setup rows
+// report nanoseconds per setup instead. --json emits the same rows as a JSON object for
+// tracking regressions: the build type, compiler and flags under "build", the rows under
+// "results". Cycles come from the TSC on x86 and are left at 0 elsewhere.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aes-core.h"
+#include "aes-modes.h"
+#include "crc32.h"
+#include "rc5-core.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint64_t cycles() { return __rdtsc(); }
+#else
+static uint64_t cycles() { return 0; }
+#endif
+
+struct result {
+    std::string name;
+    std::string engine;
+    size_t blockSize;
+    double bytes;         // bytes processed, or key setups for setup rows
+    double seconds;
+    double cycleCount;
+};
+
+static std::vector<result> results;
+
+template <typename F>
+static void measure(const std::string &name, const std::string &engine, size_t blockSize, double bytesPerRun,
+                    double minSeconds, F run)
+{
+    run();  // warm up tables, page in buffers
+    size_t runs = 0;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t startCycles = cycles();
+    double elapsed = 0;
+    do {
+        run();
+        runs++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    results.push_back({name, engine, blockSize, bytesPerRun * runs, elapsed, (double)(cycles() - startCycles)});
+}
+
+int main(int argc, char **argv)
+{
+    bool quick = false, json = false;
+    unsigned int threads = std::thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0)
+            quick = true;
+        else if (strcmp(argv[i], "--json") == 0)
+            json = true;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+    }
+    if (threads == 0)
+        threads = 1;
+    const double minSeconds = quick ? 0.001 : 0.5;
+    const size_t bulkBytes = quick ? 4096 : 1 << 20;
+
+    unsigned char key[AES_MAX_KEY_SIZE];
+    for (int i = 0; i < AES_MAX_KEY_SIZE; i++)
+        key[i] = (unsigned char)(i * 17 + 3);
+    std::vector<unsigned char> buffer(bulkBytes);
+    for (size_t i = 0; i < buffer.size(); i++)
+        buffer[i] = (unsigned char)i;
+
+    // AES key setup and the legacy per-block path that re-expands the key every time
+    aes_context ctx;
+    measure("aes-key-setup", "-", AES_BLOCK_SIZE, 1, minSeconds, [&]() { aes_context_init(&ctx, key); });
+    measure("aes-single-block-legacy", "reference", AES_BLOCK_SIZE, AES_BLOCK_SIZE, minSeconds,
+            [&]() { wcl_sw_aes_encrypt(buffer.data(), key); });
+
+    const aes_engine *engines[] = {aes_engine_reference(), aes_engine_ttable(), aes_engine_aesni(), aes_engine_armce()};
+    for (const aes_engine *engine : engines) {
+        if (engine == NULL)
+            continue;
+        aes_context_init_engine(&ctx, key, engine);
+        measure("aes-single-block", engine->name, AES_BLOCK_SIZE, AES_BLOCK_SIZE, minSeconds,
+                [&]() { aes_context_encrypt(&ctx, buffer.data(), AES_BLOCK_SIZE); });
+        measure("aes-bulk-ecb", engine->name, AES_BLOCK_SIZE, buffer.size(), minSeconds,
+                [&]() { aes_context_encrypt(&ctx, buffer.data(), buffer.size()); });
+        measure("aes-bulk-ecb-decrypt", engine->name, AES_BLOCK_SIZE, buffer.size(), minSeconds,
+                [&]() { aes_context_decrypt(&ctx, buffer.data(), buffer.size()); });
+        aes_context_init_key_engine(&ctx, key, 24, engine);
+        measure("aes192-bulk-ecb", engine->name, AES_BLOCK_SIZE, buffer.size(), minSeconds,
+                [&]() { aes_context_encrypt(&ctx, buffer.data(), buffer.size()); });
+        aes_context_init_key_engine(&ctx, key, 32, engine);
+        measure("aes256-bulk-ecb", engine->name, AES_BLOCK_SIZE, buffer.size(), minSeconds,
+                [&]() { aes_context_encrypt(&ctx, buffer.data(), buffer.size()); });
+    }
+
+    aes_context_init(&ctx, key);
+    const char *selected = ctx.engine->name;
+    unsigned char iv[AES_BLOCK_SIZE] = {0};
+    measure("aes-bulk-cbc", selected, AES_BLOCK_SIZE, buffer.size(), minSeconds,
+            [&]() { aes_cbc_encrypt(&ctx, iv, buffer.data(), buffer.data(), buffer.size()); });
+    measure("aes-bulk-ctr", selected, AES_BLOCK_SIZE, buffer.size(), minSeconds,
+            [&]() { aes_ctr_crypt(&ctx, iv, buffer.data(), buffer.data(), buffer.size()); });
+
+    // one shared read-only context driven from several threads at once
+    std::vector<std::vector<unsigned char>> perThread(threads, std::vector<unsigned char>(bulkBytes));
+    measure("aes-multithread-ecb", selected, AES_BLOCK_SIZE, (double)bulkBytes * threads, minSeconds, [&]() {
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < threads; t++)
+            workers.emplace_back([&, t]() { aes_context_encrypt(&ctx, perThread[t].data(), bulkBytes); });
+        for (std::thread &worker : workers)
+            worker.join();
+    });
+
+    // RC5
+    measure("rc5-key-setup", "-", RC5_ENC_BLOCK_SIZE, 1, minSeconds, [&]() { cipher_rc5_setup(key); });
+    measure("rc5-single-block", "scalar", RC5_ENC_BLOCK_SIZE, RC5_ENC_BLOCK_SIZE, minSeconds,
+            [&]() { cipher_rc5_encrypt_block(buffer.data(), buffer.data()); });
+    const rc5_kernel *kernels[] = {rc5_kernel_scalar(), rc5_kernel_sse2(), rc5_kernel_avx2(), rc5_kernel_neon()};
+    for (const rc5_kernel *kernel : kernels) {
+        if (kernel == NULL)
+            continue;
+        size_t blocks = buffer.size() / RC5_ENC_BLOCK_SIZE;
+        measure("rc5-bulk", kernel->name, RC5_ENC_BLOCK_SIZE, buffer.size(), minSeconds,
+                [&]() { kernel->encrypt_blocks(_S, buffer.data(), buffer.data(), blocks); });
+        measure("rc5-bulk-decrypt", kernel->name, RC5_ENC_BLOCK_SIZE, buffer.size(), minSeconds,
+                [&]() { kernel->decrypt_blocks(_S, buffer.data(), buffer.data(), blocks); });
+    }
+    rc5_session session;
+    measure("rc5-session-setup", "-", RC5_ENC_BLOCK_SIZE, 1, minSeconds, [&]() { rc5_session_init(&session, key); });
+    std::vector<unsigned char> frame(cipher_rc5_frame_size(240));
+    measure("rc5-ota-frame", session.kernel->name, RC5_ENC_BLOCK_SIZE, 240, minSeconds,
+            [&]() { rc5_session_encrypt_frame(&session, buffer.data(), 240, frame.data()); });
+
+    // image integrity, run over every byte of an OTA
+    const crc32_kernel *crcKernels[] = {crc32_kernel_slice8(), crc32_kernel_pclmul(), crc32_kernel_armv8()};
+    for (const crc32_kernel *kernel : crcKernels) {
+        if (kernel != NULL)
+            measure("crc32-bulk", kernel->name, 1, buffer.size(), minSeconds,
+                    [&]() { kernel->update(0, buffer.data(), buffer.size()); });
+    }
+    aes_cmac cmac;
+    aes_cmac_init(&cmac, key);
+    measure("aes-cmac", cmac.ctx.engine->name, AES_BLOCK_SIZE, buffer.size(), minSeconds,
+            [&]() { aes_cmac_update(&cmac, buffer.data(), buffer.size()); });
+
+    if (json) {
+        printf("{\n  \"build\": {\"type\": \"%s\", \"compiler\": \"%s\", \"cxx_flags\": \"%s\"},\n"
+               "  \"results\": [\n", BENCH_BUILD_TYPE, BENCH_COMPILER, BENCH_CXX_FLAGS);
+        for (size_t i = 0; i < results.size(); i++) {
+            const result &r = results[i];
+            bool setup = r.name.find("key-setup") != std::string::npos;
+            printf("    {\"name\": \"%s\", \"engine\": \"%s\", \"threads\": %u, ", r.name.c_str(), r.engine.c_str(),
+                   r.name.find("multithread") != std::string::npos ? threads : 1);
+            if (setup)
+                printf("\"ns_per_setup\": %.1f, \"cycles_per_setup\": %.1f}", r.seconds * 1e9 / r.bytes, r.cycleCount / r.bytes);
+            else
+                printf("\"cycles_per_byte\": %.3f, \"blocks_per_second\": %.0f, \"mb_per_second\": %.2f}",
+                       r.cycleCount / r.bytes, r.bytes / r.blockSize / r.seconds, r.bytes / r.seconds / 1e6);
+            printf("%s\n", i + 1 < results.size() ? "," : "");
+        }
+        printf("  ]\n}\n");
+    } else {
+        printf("build: %s, %s, flags %s\n", BENCH_BUILD_TYPE, BENCH_COMPILER, BENCH_CXX_FLAGS);
+        printf("%-26s %-10s %12s %16s %12s\n", "path", "engine", "cycles/byte", "blocks/s", "MB/s");
+        for (const result &r : results) {
+            if (r.name.find("key-setup") != std::string::npos)
+                printf("%-26s %-10s %9.1f ns/setup, %.1f cycles/setup\n", r.name.c_str(), r.engine.c_str(),
+                       r.seconds * 1e9 / r.bytes, r.cycleCount / r.bytes);
+            else
+                printf("%-26s %-10s %12.3f %16.0f %12.2f\n", r.name.c_str(), r.engine.c_str(), r.cycleCount / r.bytes,
+                       r.bytes / r.blockSize / r.seconds, r.bytes / r.seconds / 1e6);
+        }
+    }
+    return 0;
+}
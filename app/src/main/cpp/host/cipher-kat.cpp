@@ -0,0 +1,409 @@
+// Known-answer tests for the cipher cores, run on the host through ctest.
+// AES vectors are from FIPS-197 appendix C and SP 800-38A, CMAC from RFC 4493; RC5-16/12/16
+// is checked against an independent word-size generic RC5 that is itself anchored to published
+// vectors. Every CRC-32 kernel must give the standard check value and match slicing-by-8.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "aes-core.h"
+#include "aes-modes.h"
+#include "crc32.h"
+#include "rc5-core.h"
+#include "check.h"
+
+static std::vector<unsigned char> hex(const char *text)
+{
+    std::vector<unsigned char> bytes(strlen(text) / 2);
+    for (size_t i = 0; i < bytes.size(); i++)
+        sscanf(text + 2 * i, "%2hhx", &bytes[i]);
+    return bytes;
+}
+
+static std::vector<const aes_engine *> aes_engines()
+{
+    std::vector<const aes_engine *> engines;
+    const aes_engine *all[] = {aes_engine_reference(), aes_engine_ttable(), aes_engine_aesni(), aes_engine_armce()};
+    for (const aes_engine *engine : all)
+        if (engine != NULL)
+            engines.push_back(engine);
+    return engines;
+}
+
+static void test_aes_fips197()
+{
+    std::vector<unsigned char> key = hex("000102030405060708090a0b0c0d0e0f");
+    std::vector<unsigned char> pt = hex("00112233445566778899aabbccddeeff");
+    std::vector<unsigned char> ct = hex("69c4e0d86a7b0430d8cdb78070b4c55a");
+
+    std::vector<unsigned char> block = pt;
+    wcl_sw_aes_encrypt(block.data(), key.data());
+    CHECK(block == ct, "fips197 wcl_sw_aes_encrypt");
+    wcl_sw_aes_decrypt(block.data(), key.data());
+    CHECK(block == pt, "fips197 wcl_sw_aes_decrypt");
+
+    for (const aes_engine *engine : aes_engines()) {
+        aes_context ctx;
+        aes_context_init_engine(&ctx, key.data(), engine);
+        block = pt;
+        aes_context_encrypt(&ctx, block.data(), block.size());
+        CHECK(block == ct, engine->name);
+        aes_context_decrypt(&ctx, block.data(), block.size());
+        CHECK(block == pt, engine->name);
+    }
+}
+
+// FIPS-197 C.2 and C.3, and the key lengths no AES variant has
+static void test_aes_key_sizes()
+{
+    std::vector<unsigned char> pt = hex("00112233445566778899aabbccddeeff");
+    struct {
+        const char *key;
+        const char *ct;
+        int rounds;
+    } vectors[] = {
+        {"000102030405060708090a0b0c0d0e0f1011121314151617", "dda97ca4864cdfe06eaf70a0ec0d7191", 12},
+        {"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", "8ea2b7ca516745bfeafc49904b496089", 14},
+    };
+    for (auto &vector : vectors) {
+        std::vector<unsigned char> key = hex(vector.key);
+        for (const aes_engine *engine : aes_engines()) {
+            aes_context ctx;
+            CHECK(aes_context_init_key_engine(&ctx, key.data(), key.size(), engine) == 0 &&
+                  ctx.rounds == vector.rounds, "key size accepted");
+            std::vector<unsigned char> block = pt;
+            aes_context_encrypt(&ctx, block.data(), block.size());
+            CHECK(block == hex(vector.ct), engine->name);
+            aes_context_decrypt(&ctx, block.data(), block.size());
+            CHECK(block == pt, engine->name);
+        }
+    }
+    std::vector<unsigned char> key(33);
+    aes_context ctx;
+    for (size_t length : {0, 8, 15, 17, 20, 31, 33})
+        CHECK(aes_context_init_key(&ctx, key.data(), length) == -1, "bad key length");
+    aes_stream stream;
+    CHECK(aes_stream_init(&stream, AES_MODE_CBC, 1, key.data(), 20, NULL) == -1, "stream bad key length");
+
+    CHECK(aesTables.sbox[0x00] == 0x63 && aesTables.sbox[0x01] == 0x7c && aesTables.rsbox[0x00] == 0x52,
+          "constexpr s-box");
+    bool inverse = true;
+    for (int x = 0; x < 256; x++)
+        inverse = inverse && aesTables.rsbox[aesTables.sbox[x]] == x;
+    CHECK(inverse, "inverse s-box");
+}
+
+// every engine must agree with the reference on odd batch sizes, in both directions, for every
+// key size
+static void test_aes_engines_match()
+{
+    std::vector<unsigned char> key = hex("2b7e151628aed2a6abf7158809cf4f3c603deb1015ca71be2b73aef0857d7781");
+    std::vector<unsigned char> data(AES_BLOCK_SIZE * 37);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (unsigned char)(i * 131 + 7);
+    for (size_t keyLength : {16, 24, 32}) {
+        aes_context ref;
+        aes_context_init_key_engine(&ref, key.data(), keyLength, aes_engine_reference());
+        std::vector<unsigned char> expected = data;
+        aes_context_encrypt(&ref, expected.data(), expected.size());
+        for (const aes_engine *engine : aes_engines()) {
+            aes_context ctx;
+            aes_context_init_key_engine(&ctx, key.data(), keyLength, engine);
+            std::vector<unsigned char> out = data;
+            aes_context_encrypt(&ctx, out.data(), out.size());
+            CHECK(out == expected, engine->name);
+            aes_context_decrypt(&ctx, out.data(), out.size());
+            CHECK(out == data, engine->name);
+        }
+    }
+}
+
+static void test_aes_modes()
+{
+    std::vector<unsigned char> key = hex("2b7e151628aed2a6abf7158809cf4f3c");
+    std::vector<unsigned char> pt = hex("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                                        "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710");
+    aes_context ctx;
+    aes_context_init(&ctx, key.data());
+    std::vector<unsigned char> out(pt.size());
+
+    aes_ecb_encrypt(&ctx, pt.data(), out.data(), pt.size());
+    CHECK(out == hex("3ad77bb40d7a3660a89ecaf32466ef97f5d3d58503b9699de785895a96fdbaaf"
+                     "43b1cd7f598ece23881b00e3ed0306887b0c785e27e8ad3f8223207104725dd4"), "sp800-38a ecb");
+
+    std::vector<unsigned char> iv = hex("000102030405060708090a0b0c0d0e0f");
+    aes_cbc_encrypt(&ctx, iv.data(), pt.data(), out.data(), pt.size());
+    CHECK(out == hex("7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2"
+                     "73bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7"), "sp800-38a cbc");
+    iv = hex("000102030405060708090a0b0c0d0e0f");
+    aes_cbc_decrypt(&ctx, iv.data(), out.data(), out.data(), out.size());
+    CHECK(out == pt, "sp800-38a cbc decrypt");
+
+    std::vector<unsigned char> counter = hex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");
+    aes_ctr_crypt(&ctx, counter.data(), pt.data(), out.data(), pt.size());
+    CHECK(out == hex("874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"
+                     "5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee"), "sp800-38a ctr");
+}
+
+// CTR above the parallel threshold and streamed in ragged pieces must equal serial CTR
+static void test_aes_ctr_stream()
+{
+    std::vector<unsigned char> key = hex("2b7e151628aed2a6abf7158809cf4f3c");
+    std::vector<unsigned char> counter0 = hex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");
+    std::vector<unsigned char> data(4 * AES_CTR_PARALLEL_THRESHOLD + 5);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (unsigned char)(i ^ (i >> 8));
+    aes_context ctx;
+    aes_context_init(&ctx, key.data());
+    std::vector<unsigned char> oneShot(data.size());
+    std::vector<unsigned char> counter = counter0;
+    aes_ctr_crypt(&ctx, counter.data(), data.data(), oneShot.data(), data.size());
+
+    aes_stream stream;
+    aes_stream_init(&stream, AES_MODE_CTR, 1, key.data(), key.size(), counter0.data());
+    std::vector<unsigned char> streamed(data.size() + AES_BLOCK_SIZE);
+    size_t written = 0;
+    for (size_t offset = 0, piece = 1; offset < data.size(); offset += piece, piece = piece * 3 % 4099 + 1) {
+        size_t length = data.size() - offset < piece ? data.size() - offset : piece;
+        written += aes_stream_update(&stream, data.data() + offset, length, streamed.data() + written);
+    }
+    CHECK(aes_stream_final(&stream) == 0, "ctr stream final");
+    streamed.resize(written);
+    CHECK(streamed == oneShot, "ctr stream equals one-shot");
+}
+
+// RFC 4493 examples, then the same message absorbed in ragged pieces
+static void test_aes_cmac()
+{
+    std::vector<unsigned char> key = hex("2b7e151628aed2a6abf7158809cf4f3c");
+    std::vector<unsigned char> message = hex("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                                             "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710");
+    struct { size_t length; const char *tag; } examples[] = {
+        {0, "bb1d6929e95937287fa37d129b756746"},
+        {16, "070a16b46b4d4144f79bdd9dd04a287c"},
+        {40, "dfa66747de9ae63030ca32611497c827"},
+        {64, "51f0bebf7e3b9d92fc49741779363cfe"},
+    };
+    for (const auto &example : examples) {
+        aes_cmac cmac;
+        aes_cmac_init(&cmac, key.data());
+        aes_cmac_update(&cmac, message.data(), example.length);
+        std::vector<unsigned char> tag(AES_BLOCK_SIZE);
+        aes_cmac_final(&cmac, tag.data());
+        CHECK(tag == hex(example.tag), "rfc 4493 cmac");
+
+        aes_cmac_init(&cmac, key.data());
+        for (size_t offset = 0, piece = 1; offset < example.length; offset += piece, piece = piece * 2 % 13 + 1)
+            aes_cmac_update(&cmac, message.data() + offset, std::min(piece, example.length - offset));
+        std::vector<unsigned char> streamed(AES_BLOCK_SIZE);
+        aes_cmac_final(&cmac, streamed.data());
+        CHECK(streamed == tag, "cmac in pieces");
+    }
+}
+
+static void test_crc32()
+{
+    const unsigned char check[] = "123456789";
+    std::vector<unsigned char> data(70000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (unsigned char)(i * 131 + (i >> 9));
+    const crc32_kernel *kernels[] = {crc32_kernel_slice8(), crc32_kernel_pclmul(), crc32_kernel_armv8()};
+    for (const crc32_kernel *kernel : kernels) {
+        if (kernel == NULL)
+            continue;
+        CHECK(kernel->update(0, check, 9) == 0xcbf43926, "crc32 check value");
+        CHECK(kernel->update(0, check, 0) == 0, "crc32 of nothing");
+        // every length and alignment around the folding boundaries, chained in two pieces
+        for (size_t length = 0; length < 300; length++) {
+            uint32_t whole = crc32_kernel_slice8()->update(0, data.data() + length % 7, length);
+            uint32_t split = kernel->update(kernel->update(0, data.data() + length % 7, length / 3),
+                                            data.data() + length % 7 + length / 3, length - length / 3);
+            if (whole != split) {
+                printf("%s length %zu\n", kernel->name, length);
+                CHECK(false, "crc32 kernels match");
+                break;
+            }
+        }
+        CHECK(kernel->update(0, data.data(), data.size()) == crc32_kernel_slice8()->update(0, data.data(), data.size()),
+              "crc32 bulk");
+    }
+}
+
+// word-size generic RC5-w/r/b written straight from the RC5 paper, independent of rc5-core
+static std::vector<unsigned char> rc5_generic(int w, int r, const std::vector<unsigned char> &key,
+                                              const std::vector<unsigned char> &pt)
+{
+    typedef unsigned long long word;
+    const word mask = w == 64 ? ~0ULL : (1ULL << w) - 1;
+    const word P = w == 16 ? 0xb7e1 : 0xb7e15163, Q = w == 16 ? 0x9e37 : 0x9e3779b9;
+    const int u = w / 8, t = 2 * (r + 1);
+    int c = key.size() / u > 0 ? (key.size() + u - 1) / u : 1;
+    std::vector<word> L(c, 0), S(t);
+    for (int i = key.size() - 1; i >= 0; i--)
+        L[i / u] = ((L[i / u] << 8) + key[i]) & mask;
+    auto rotl = [&](word x, word y) { x &= mask; y %= w; return ((x << y) | (x >> ((w - y) % w))) & mask; };
+    S[0] = P;
+    for (int i = 1; i < t; i++)
+        S[i] = (S[i - 1] + Q) & mask;
+    word A = 0, B = 0;
+    for (int k = 0, i = 0, j = 0; k < 3 * (t > c ? t : c); k++, i = (i + 1) % t, j = (j + 1) % c) {
+        A = S[i] = rotl(S[i] + A + B, 3);
+        B = L[j] = rotl(L[j] + A + B, A + B);
+    }
+    word a = 0, b = 0;
+    for (int i = u - 1; i >= 0; i--) {
+        a = (a << 8) | pt[i];
+        b = (b << 8) | pt[u + i];
+    }
+    a = (a + S[0]) & mask;
+    b = (b + S[1]) & mask;
+    for (int i = 1; i <= r; i++) {
+        a = (rotl(a ^ b, b) + S[2 * i]) & mask;
+        b = (rotl(b ^ a, a) + S[2 * i + 1]) & mask;
+    }
+    std::vector<unsigned char> ct(2 * u);
+    for (int i = 0; i < u; i++) {
+        ct[i] = (unsigned char)(a >> (8 * i));
+        ct[u + i] = (unsigned char)(b >> (8 * i));
+    }
+    return ct;
+}
+
+static void test_rc5_generic_anchor()
+{
+    // RC5-32/12/16 from the RC5 paper / RFC 2040 and RC5-16/16/8 from the RC5 test vector draft
+    CHECK(rc5_generic(32, 12, hex("00000000000000000000000000000000"), hex("0000000000000000"))
+          == hex("21a5dbee154b8f6d"), "rc5-32/12/16 paper vector");
+    CHECK(rc5_generic(16, 16, hex("0001020304050607"), hex("00010203")) == hex("23a8d72e"),
+          "rc5-16/16/8 draft vector");
+}
+
+static void test_rc5_16_12_16()
+{
+    const char *keys[] = {"00000000000000000000000000000000", "000102030405060708090a0b0c0d0e0f",
+                          "4507b6f3169ae7937d3d4b8a3170498f"};
+    for (const char *keyText : keys) {
+        std::vector<unsigned char> key = hex(keyText);
+        cipher_rc5_setup(key.data());
+        std::vector<unsigned char> pt = hex("00010203");
+        std::vector<unsigned char> ct(RC5_ENC_BLOCK_SIZE);
+        cipher_rc5_encrypt_block(pt.data(), ct.data());
+        CHECK(ct == rc5_generic(16, 12, key, pt), "rc5-16/12/16 encrypt");
+        cipher_rc5_decrypt_block(ct.data(), ct.data());
+        CHECK(ct == pt, "rc5-16/12/16 decrypt");
+    }
+}
+
+// every kernel must agree with scalar for lengths around the lane widths, in place too
+static void test_rc5_kernels_match()
+{
+    std::vector<unsigned char> key = hex("4507b6f3169ae7937d3d4b8a3170498f");
+    cipher_rc5_setup(key.data());
+    const rc5_kernel *kernels[] = {rc5_kernel_scalar(), rc5_kernel_sse2(), rc5_kernel_avx2(), rc5_kernel_neon()};
+    size_t counts[] = {1, 7, 8, 15, 16, 17, 33, 1000};
+    for (size_t blocks : counts) {
+        std::vector<unsigned char> data(blocks * RC5_ENC_BLOCK_SIZE);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = (unsigned char)(i * 29 + blocks);
+        std::vector<unsigned char> expected(data.size());
+        rc5_kernel_scalar()->encrypt_blocks(_S, data.data(), expected.data(), blocks);
+        for (const rc5_kernel *kernel : kernels) {
+            if (kernel == NULL)
+                continue;
+            std::vector<unsigned char> out = data;
+            kernel->encrypt_blocks(_S, out.data(), out.data(), blocks);
+            CHECK(out == expected, kernel->name);
+            kernel->decrypt_blocks(_S, out.data(), out.data(), blocks);
+            CHECK(out == data, kernel->name);
+        }
+    }
+}
+
+static void test_rc5_frame()
+{
+    std::vector<unsigned char> key = hex("4507b6f3169ae7937d3d4b8a3170498f");
+    cipher_rc5_setup(key.data());
+    std::vector<unsigned char> chunk(242);
+    for (size_t i = 0; i < chunk.size(); i++)
+        chunk[i] = (unsigned char)i;
+    std::vector<unsigned char> frame(cipher_rc5_frame_size(chunk.size()));
+    size_t length = cipher_rc5_encrypt_frame(chunk.data(), chunk.size(), frame.data());
+    // the length byte carries the chunk size, the two trailing bytes are not sent
+    CHECK(length == 1 + 240 && frame[0] == 242, "rc5 frame layout");
+    std::vector<unsigned char> block(RC5_ENC_BLOCK_SIZE);
+    cipher_rc5_encrypt_block(chunk.data() + 236, block.data());
+    CHECK(memcmp(frame.data() + 1 + 236, block.data(), RC5_ENC_BLOCK_SIZE) == 0, "rc5 frame last block");
+}
+
+// sessions with different keys used from concurrent threads must match their serial results
+// and leave the legacy global key table alone
+static void test_rc5_sessions()
+{
+    std::vector<unsigned char> keys[] = {hex("4507b6f3169ae7937d3d4b8a3170498f"),
+                                         hex("000102030405060708090a0b0c0d0e0f")};
+    std::vector<unsigned char> globalKey = hex("00000000000000000000000000000000");
+    cipher_rc5_setup(globalKey.data());
+    WORD globalS[_sTableSize];
+    memcpy(globalS, _S, sizeof(globalS));
+
+    rc5_session sessions[2];
+    std::vector<unsigned char> data(4096);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (unsigned char)(i * 13);
+    std::vector<unsigned char> expected[2];
+    for (int s = 0; s < 2; s++) {
+        rc5_session_init(&sessions[s], keys[s].data());
+        std::vector<unsigned char> pt(data.begin(), data.begin() + RC5_ENC_BLOCK_SIZE);
+        std::vector<unsigned char> ct(RC5_ENC_BLOCK_SIZE);
+        rc5_session_encrypt(&sessions[s], pt.data(), ct.data(), ct.size());
+        CHECK(ct == rc5_generic(16, 12, keys[s], pt), "rc5 session encrypt");
+        expected[s].resize(data.size());
+        rc5_kernel_scalar()->encrypt_blocks(sessions[s].S, data.data(), expected[s].data(),
+                                            data.size() / RC5_ENC_BLOCK_SIZE);
+    }
+
+    std::vector<unsigned char> out[2][4];
+    std::vector<std::thread> workers;
+    for (int s = 0; s < 2; s++)
+        for (int t = 0; t < 4; t++)
+            workers.emplace_back([&, s, t]() {
+                out[s][t].resize(data.size());
+                for (int round = 0; round < 50; round++)
+                    rc5_session_encrypt(&sessions[s], data.data(), out[s][t].data(), data.size());
+            });
+    for (std::thread &worker : workers)
+        worker.join();
+    for (int s = 0; s < 2; s++)
+        for (int t = 0; t < 4; t++)
+            CHECK(out[s][t] == expected[s], "rc5 concurrent sessions");
+    CHECK(memcmp(globalS, _S, sizeof(globalS)) == 0, "rc5 sessions leave global key");
+
+    std::vector<unsigned char> frame(cipher_rc5_frame_size(242));
+    size_t length = rc5_session_encrypt_frame(&sessions[0], data.data(), 242, frame.data());
+    CHECK(length == 241 && frame[0] == 242 && memcmp(frame.data() + 1, expected[0].data(), 240) == 0,
+          "rc5 session frame");
+    rc5_session_decrypt(&sessions[1], expected[1].data(), expected[1].data(), expected[1].size());
+    CHECK(expected[1] == data, "rc5 session decrypt");
+}
+
+int main()
+{
+    test_aes_fips197();
+    test_aes_key_sizes();
+    test_aes_engines_match();
+    test_aes_modes();
+    test_aes_ctr_stream();
+    test_aes_cmac();
+    test_crc32();
+    test_rc5_generic_anchor();
+    test_rc5_16_12_16();
+    test_rc5_kernels_match();
+    test_rc5_frame();
+    test_rc5_sessions();
+    printf("aes engine %s, rc5 kernel %s, crc32 kernel %s\n", aes_engine_select()->name, rc5_kernel_select()->name,
+           crc32_kernel_select()->name);
+    return check_summary("known-answer");
+}
@@ -0,0 +1,70 @@
+// Tests for the scanner device table, run on the host through ctest.
+
+#include <cstdio>
+#include <map>
+#include <vector>
+#include "device-table.h"
+#include "check.h"
+
+// rows are handed out in first-seen order and never move, across growth too
+static void test_upsert_stable_rows()
+{
+    device_table table;
+    device_table_init(&table, 4);
+    std::map<uint64_t, int32_t> expected;
+    for (uint64_t i = 0; i < 2000; i++) {
+        // MACs sharing a vendor prefix differ only in their low bytes
+        uint64_t key = 0xc0ffee000000ull | (i * 7919 % 65536);
+        int32_t row = device_table_upsert(&table, key);
+        if (expected.count(key) == 0)
+            expected[key] = (int32_t)expected.size();
+        CHECK(row == expected[key], "upsert row");
+    }
+    CHECK(device_table_rows(&table) == expected.size(), "row count");
+    bool allFound = true;
+    for (const auto &entry : expected)
+        allFound &= device_table_find(&table, entry.first) == entry.second;
+    CHECK(allFound, "find every key");
+    CHECK(device_table_find(&table, 0x1234) == -1, "find missing");
+    CHECK(device_table_find(&table, 0) == -1, "find zero key");
+    CHECK(device_table_upsert(&table, 0) == (int32_t)expected.size(), "zero key is a key");
+
+    device_table_clear(&table);
+    CHECK(device_table_rows(&table) == 0 && device_table_find(&table, 0xc0ffee000000ull) == -1, "clear");
+    CHECK(device_table_upsert(&table, 42) == 0, "rows restart after clear");
+}
+
+static void test_take_changes()
+{
+    device_table table;
+    device_table_init(&table, 0);
+    for (uint64_t key = 100; key < 110; key++)
+        device_table_upsert(&table, key);
+    int32_t start, count, ranges[8];
+    CHECK(device_table_take_changes(&table, &start, &count, ranges, 4) == 0 && start == 0 && count == 10,
+          "first frame is all inserts");
+    CHECK(device_table_take_changes(&table, &start, &count, ranges, 4) == 0 && start == 10 && count == 0,
+          "nothing changed");
+
+    // rows 1, 2, 3, 7 change, 3 twice, and one row is added
+    uint64_t touched[] = {103, 101, 107, 102, 103, 200};
+    for (uint64_t key : touched)
+        device_table_upsert(&table, key);
+    size_t n = device_table_take_changes(&table, &start, &count, ranges, 4);
+    CHECK(n == 2 && ranges[0] == 1 && ranges[1] == 3 && ranges[2] == 7 && ranges[3] == 1, "merged ranges");
+    CHECK(start == 10 && count == 1, "inserted after reported rows");
+
+    // more ranges than room: the last one covers the rest
+    uint64_t scattered[] = {100, 102, 104, 106, 108};
+    for (uint64_t key : scattered)
+        device_table_upsert(&table, key);
+    n = device_table_take_changes(&table, &start, &count, ranges, 2);
+    CHECK(n == 2 && ranges[0] == 0 && ranges[1] == 1 && ranges[2] == 2 && ranges[3] == 7, "stretched range");
+}
+
+int main()
+{
+    test_upsert_stable_rows();
+    test_take_changes();
+    return check_summary("device table");
+}
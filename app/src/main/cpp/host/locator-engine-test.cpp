@@ -0,0 +1,276 @@
+// Locator engine: trilateration, both distance filters, the debounced zone machine, and a
+// log store replay that matches feeding the same records one by one, on every kernel.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "locator-engine.h"
+#include "check.h"
+
+// locators at three corners of a 10 m square
+static const uint32_t ids[3] = {0x101, 0x102, 0x103};
+static const float lx[3] = {0, 1000, 0};
+static const float ly[3] = {0, 0, 1000};
+
+static uint32_t seed = 12345;
+
+static float noise(float amplitude)
+{
+    seed = seed * 1664525 + 1013904223;
+    return ((seed >> 8) / 16777216.0f * 2 - 1) * amplitude;
+}
+
+static void place(locator_engine *engine)
+{
+    for (int i = 0; i < 3; i++)
+        locator_engine_place(engine, ids[i], lx[i], ly[i]);
+}
+
+static beacon_report zone_report(uint32_t tagId, uint8_t status, float x, float y, float jitter)
+{
+    beacon_report report;
+    memset(&report, 0, sizeof(report));
+    report.tagId = tagId;
+    report.status = status;
+    report.locatorCount = 3;
+    for (int i = 0; i < 3; i++) {
+        float d = std::sqrt((x - lx[i]) * (x - lx[i]) + (y - ly[i]) * (y - ly[i])) + noise(jitter);
+        report.locatorId[i] = ids[i];
+        report.distanceCm[i] = (uint16_t)(d > 0 ? d + 0.5f : 0);
+    }
+    return report;
+}
+
+static beacon_report failure_report(uint32_t tagId)
+{
+    beacon_report report;
+    memset(&report, 0, sizeof(report));
+    report.tagId = tagId;
+    report.status = BEACON_STATUS_FAILURE;
+    report.errorCode = 2;
+    report.failureCount = 1;
+    return report;
+}
+
+// the scan record a locator beacon would send for report
+static std::vector<unsigned char> record_of(const beacon_report &report)
+{
+    std::vector<unsigned char> record = {0x02, 0x01, 0x06, 0x00, 0xff, 0x97, 0x01, 0x52, report.status};
+    for (int shift = 24; shift >= 0; shift -= 8)
+        record.push_back((unsigned char)(report.tagId >> shift));
+    if (report.status == BEACON_STATUS_FAILURE) {
+        record.push_back(report.errorCode);
+        record.push_back(report.failureCount);
+    }
+    for (int i = 0; i < report.locatorCount; i++) {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            record.push_back((unsigned char)(report.locatorId[i] >> shift));
+        record.push_back((unsigned char)report.distanceCm[i]);
+        record.push_back((unsigned char)(report.distanceCm[i] >> 8));
+    }
+    record[3] = (unsigned char)(record.size() - 4);
+    return record;
+}
+
+static void test_trilaterate()
+{
+    float r[3] = {500, std::sqrt(700.0f * 700 + 400 * 400), std::sqrt(300.0f * 300 + 600 * 600)};
+    float x, y, residual;
+    CHECK(locator_trilaterate(lx, ly, r, &x, &y, &residual) == 0, "solved");
+    CHECK(std::fabs(x - 300) < 0.1f && std::fabs(y - 400) < 0.1f && residual < 0.1f, "exact circles");
+    r[0] += 50;
+    locator_trilaterate(lx, ly, r, &x, &y, &residual);
+    CHECK(residual > 5 && residual < 50, "inconsistent circles leave a residual");
+    const float cx[3] = {0, 500, 1000}, cy[3] = {0, 1, 0};
+    CHECK(locator_trilaterate(cx, cy, r, &x, &y, &residual) == -1, "collinear locators");
+}
+
+static void test_kalman()
+{
+    locator_engine engine;
+    locator_engine_init(&engine, NULL);
+    place(&engine);
+    locator_fix fix;
+    float rawError = 0, filteredError = 0;
+    for (int i = 0; i < 200; i++) {
+        beacon_report report = zone_report(7, BEACON_STATUS_INSIDE, 300, 400, 80);
+        locator_engine_update(&engine, &report, i * 200000000LL, &fix);
+        if (i >= 100) {
+            rawError += std::fabs(report.distanceCm[0] - 500.0f);
+            filteredError += std::fabs(fix.distanceCm[0] - 500);
+        }
+    }
+    CHECK(fix.tagId == 7 && fix.tag == 0 && fix.hasPosition, "fix");
+    CHECK(filteredError < rawError / 2, "kalman smooths the distance");
+    CHECK(std::fabs(fix.x - 300) < 30 && std::fabs(fix.y - 400) < 30, "position from filtered distances");
+    const locator_tag &tag = engine.tags[0];
+    CHECK(tag.trackCount == 3 && tag.fixes == 200 && tag.reports == 200, "tag counters");
+    printf("kalman: raw error %.1f cm, filtered %.1f cm, residual %.1f cm\n", rawError / 100, filteredError / 100,
+           fix.residualCm);
+
+    // a tag heard by more locators than it has slots keeps the most recent ones
+    beacon_report report = zone_report(8, BEACON_STATUS_INSIDE, 300, 400, 0);
+    for (uint32_t i = 0; i < LOCATOR_SLOTS + 2; i++) {
+        report.locatorId[0] = 0x200 + i;
+        locator_engine_update(&engine, &report, i, NULL);
+    }
+    const locator_tag &busy = engine.tags[locator_engine_find_tag(&engine, 8)];
+    CHECK(busy.trackCount == LOCATOR_SLOTS && busy.fixes == 0, "slots capped, unplaced locator not solved");
+
+    // with every slot taken, the locators of one report must not evict each other
+    for (uint32_t i = 0; i < LOCATOR_SLOTS; i++) {
+        for (int k = 0; k < 3; k++)
+            report.locatorId[k] = 0x300 + (i + k) % LOCATOR_SLOTS;
+        locator_engine_update(&engine, &report, i, NULL);
+    }
+    const uint32_t crowd[3] = {500, 501, 502};
+    memcpy(report.locatorId, crowd, sizeof(crowd));
+    locator_engine_update(&engine, &report, LOCATOR_SLOTS, NULL);
+    const locator_tag &full = engine.tags[locator_engine_find_tag(&engine, 8)];
+    int kept = 0;
+    for (int i = 0; i < full.trackCount; i++)
+        kept += full.tracks[i].locatorId >= 500 && full.tracks[i].locatorId <= 502;
+    CHECK(full.trackCount == LOCATOR_SLOTS && kept == 3, "one report keeps a track per locator");
+}
+
+static void test_median()
+{
+    locator_config config;
+    locator_config_default(&config);
+    config.filter = LOCATOR_FILTER_MEDIAN;
+    locator_engine engine;
+    locator_engine_init(&engine, &config);
+    place(&engine);
+    locator_fix fix;
+    const uint16_t distances[] = {500, 510, 490, 3000, 505, 20, 495};
+    const float medians[] = {500, 500, 500, 500, 505, 505, 495};
+    bool all = true;
+    for (int i = 0; i < 7; i++) {
+        beacon_report report = zone_report(9, BEACON_STATUS_INSIDE, 300, 400, 0);
+        report.distanceCm[0] = distances[i];
+        locator_engine_update(&engine, &report, i, &fix);
+        all = fix.distanceCm[0] == medians[i] && all;
+    }
+    CHECK(all, "median of the last five, spikes ignored");
+}
+
+static void test_zone_machine()
+{
+    locator_engine engine;
+    locator_engine_init(&engine, NULL);
+    const uint8_t statuses[] = {4, 5, 4, 5, 5, 6, 4, 6, 6, 4, 4};
+    const uint8_t zones[] = {1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 1};
+    bool all = true, flagged = true;
+    locator_fix fix;
+    for (int i = 0; i < 11; i++) {
+        beacon_report report = statuses[i] == 6 ? failure_report(3) : zone_report(3, statuses[i], 300, 400, 0);
+        locator_engine_update(&engine, &report, i * 1000000000LL, &fix);
+        all = fix.zone == zones[i] && all;
+        flagged = fix.transition == (i == 4 || i == 8 || i == 10) && flagged;
+    }
+    CHECK(all, "zones debounced over two reports");
+    CHECK(flagged, "transitions flagged");
+    const locator_tag &tag = engine.tags[0];
+    CHECK(tag.transitions == 3 && tag.failures == 3 && tag.reports == 11, "zone counters");
+    CHECK(tag.dwellNs[LOCATOR_ZONE_INSIDE] == 4000000000LL && tag.dwellNs[LOCATOR_ZONE_OUTSIDE] == 4000000000LL &&
+          tag.dwellNs[LOCATOR_ZONE_FAILURE] == 2000000000LL, "dwell per zone");
+    CHECK(tag.zoneSinceNs == 10000000000LL, "zone since");
+    beacon_report bad = failure_report(3);
+    bad.status = 0x07;
+    CHECK(locator_engine_update(&engine, &bad, 0, NULL) == -1, "unknown status refused");
+}
+
+static bool same_tag(const locator_tag &a, const locator_tag &b, float tolerance)
+{
+    if (a.tagId != b.tagId || a.zone != b.zone || a.reports != b.reports || a.fixes != b.fixes ||
+        a.failures != b.failures || a.transitions != b.transitions || a.trackCount != b.trackCount ||
+        memcmp(a.dwellNs, b.dwellNs, sizeof(a.dwellNs)) != 0)
+        return false;
+    if (std::fabs(a.x - b.x) > tolerance || std::fabs(a.y - b.y) > tolerance)
+        return false;
+    for (int i = 0; i < a.trackCount; i++)
+        if (a.tracks[i].locatorId != b.tracks[i].locatorId ||
+            std::fabs(a.tracks[i].estimate - b.tracks[i].estimate) > tolerance)
+            return false;
+    return true;
+}
+
+static void test_replay(int filter)
+{
+    // 11 tags walking at different speeds, uneven history lengths, failures and foreign records
+    log_store store;
+    log_store_open(&store, 4096 * LOG_PAGE_SIZE, NULL);
+    std::vector<beacon_report> fed;
+    std::vector<int64_t> times;
+    const unsigned char foreign[] = {0x02, 0x01, 0x06, 0x03, 0xff, 0x4c, 0x00};
+    for (int step = 0; step < 400; step++) {
+        for (uint32_t t = 0; t < 11; t++) {
+            if (step > 100 + 30 * (int)t)
+                continue;
+            int64_t now = step * 250000000LL + t;
+            if ((step + t) % 37 == 0) {
+                log_store_append(&store, 0x1000 + t, now, -60, foreign, sizeof(foreign));
+                continue;
+            }
+            float x = 100 + (step * (t + 1)) % 800, y = 200 + (step * 3) % 600;
+            uint8_t status = (step / (20 + t)) % 2 == 0 ? BEACON_STATUS_INSIDE : BEACON_STATUS_OUTSIDE;
+            beacon_report report = (step + 3 * t) % 29 == 0 ? failure_report(0x1000 + t)
+                                                              : zone_report(0x1000 + t, status, x, y, 60);
+            std::vector<unsigned char> record = record_of(report);
+            log_store_append(&store, report.tagId, now, -60, record.data(), record.size());
+            fed.push_back(report);
+            times.push_back(now);
+        }
+    }
+
+    locator_config config;
+    locator_config_default(&config);
+    config.filter = filter;
+    locator_engine live;
+    locator_engine_init(&live, &config);
+    place(&live);
+    // the live engine sees the records in arrival order, interleaved across tags
+    for (size_t i = 0; i < fed.size(); i++)
+        locator_engine_update(&live, &fed[i], times[i], NULL);
+
+    const locator_kernel *kernels[] = {locator_kernel_scalar(), locator_kernel_simd()};
+    for (const locator_kernel *kernel : kernels) {
+        if (kernel == NULL)
+            continue;
+        locator_engine replay;
+        locator_engine_init(&replay, &config);
+        place(&replay);
+        std::vector<locator_transition> transitions;
+        auto began = std::chrono::steady_clock::now();
+        size_t count = locator_engine_replay(&replay, &store, kernel, &transitions);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+        CHECK(count == fed.size(), "every beacon record replayed");
+        CHECK(replay.tags.size() == 11, "every tag replayed");
+        bool same = true;
+        uint64_t liveTransitions = 0;
+        for (size_t row = 0; row < live.tags.size(); row++) {
+            int32_t other = locator_engine_find_tag(&replay, live.tags[row].tagId);
+            same = other >= 0 && same_tag(live.tags[row], replay.tags[other], 0.01f) && same;
+            liveTransitions += live.tags[row].transitions;
+        }
+        CHECK(same, "replay matches live updates");
+        CHECK(transitions.size() == liveTransitions && liveTransitions > 0, "replay transitions");
+        printf("%s replay (%s): %zu reports, %llu transitions, %.1f M reports/s\n",
+               filter == LOCATOR_FILTER_MEDIAN ? "median" : "kalman", kernel->name, count,
+               (unsigned long long)transitions.size(), count / seconds / 1e6);
+    }
+    log_store_close(&store);
+}
+
+int main()
+{
+    test_trilaterate();
+    test_kalman();
+    test_median();
+    test_zone_machine();
+    test_replay(LOCATOR_FILTER_KALMAN);
+    test_replay(LOCATOR_FILTER_MEDIAN);
+    return check_summary("locator-engine");
+}
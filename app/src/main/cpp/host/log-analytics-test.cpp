@@ -0,0 +1,153 @@
+// Exported scan logs: the export maps back record for record, the per-tag statistics are
+// right, and the result does not depend on how many threads split the work.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "log-analytics.h"
+#include "check.h"
+
+static std::vector<unsigned char> beacon(uint8_t status, uint32_t tagId, uint16_t distance, uint8_t errorCode)
+{
+    std::vector<unsigned char> record = {0x02, 0x01, 0x06, 0x00, 0xff, 0x97, 0x01, 0x52, status,
+                                         (unsigned char)(tagId >> 24), (unsigned char)(tagId >> 16),
+                                         (unsigned char)(tagId >> 8), (unsigned char)tagId};
+    if (status == BEACON_STATUS_FAILURE) {
+        record.push_back(errorCode);
+        record.push_back(3);
+    } else {
+        for (int l = 0; l < 3; l++) {
+            uint16_t d = (uint16_t)(distance + 100 * l);
+            const unsigned char entry[] = {0, 0, 1, (unsigned char)(l + 1), (unsigned char)d, (unsigned char)(d >> 8)};
+            record.insert(record.end(), entry, entry + 6);
+        }
+    }
+    record[3] = (unsigned char)(record.size() - 4);
+    return record;
+}
+
+// 50 tags; tag t sends 20 + t reports a second apart, inside for the first ten, then outside,
+// with a failure (error code t % 4) every seventh report and a foreign record every eleventh
+static void fill(log_store *store, locator_engine *live)
+{
+    const unsigned char foreign[] = {0x02, 0x01, 0x06, 0x03, 0xff, 0x4c, 0x00};
+    for (int step = 0; step < 70; step++) {
+        for (uint32_t t = 0; t < 50; t++) {
+            if (step >= 20 + (int)t)
+                continue;
+            uint32_t tagId = 0x5000 + t;
+            int64_t now = step * 1000000000LL;
+            int rssi = -40 - (step * 3 + (int)t) % 50;
+            if (step % 11 == 10) {
+                log_store_append(store, tagId, now, rssi, foreign, sizeof(foreign));
+                continue;
+            }
+            uint8_t status = step % 7 == 6 ? BEACON_STATUS_FAILURE
+                                           : step < 10 ? BEACON_STATUS_INSIDE : BEACON_STATUS_OUTSIDE;
+            std::vector<unsigned char> record = beacon(status, tagId, (uint16_t)(200 + step), (uint8_t)(t % 4));
+            log_store_append(store, tagId, now, rssi, record.data(), record.size());
+            beacon_report report;
+            beacon_parse(record.data(), record.size(), &report);
+            locator_engine_update(live, &report, now, NULL);
+        }
+    }
+}
+
+static bool same(const log_tag_summary &a, const log_tag_summary &b)
+{
+    return a.tagId == b.tagId && a.records == b.records && a.reports == b.reports && a.failures == b.failures &&
+           a.failureCount == b.failureCount && a.topErrorCode == b.topErrorCode && a.transitions == b.transitions &&
+           a.zone == b.zone && a.firstNs == b.firstNs && a.lastNs == b.lastNs &&
+           memcmp(a.dwellNs, b.dwellNs, sizeof(a.dwellNs)) == 0 && memcmp(a.rssi, b.rssi, sizeof(a.rssi)) == 0 &&
+           memcmp(a.distanceCm, b.distanceCm, sizeof(a.distanceCm)) == 0;
+}
+
+int main()
+{
+    log_store store;
+    log_store_open(&store, 1024 * LOG_PAGE_SIZE, NULL);
+    locator_engine live;
+    locator_engine_init(&live, NULL);
+    fill(&store, &live);
+    char path[] = "/tmp/log-analytics-test-XXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    size_t stored = 0;
+    for (size_t t = 0; t < log_store_tag_count(&store); t++)
+        stored += log_store_record_count(&store, (int32_t)t);
+    CHECK(log_store_export(&store, path) == (int64_t)stored, "export");
+
+    log_capture capture;
+    CHECK(log_capture_open(&capture, path) == 0 && capture.count == stored, "capture maps");
+    const log_record *first = log_store_record(&store, 0, 0);
+    CHECK(capture.records[0].tagId == 0x5000 && memcmp(&capture.records[0].record, first, LOG_RECORD_SIZE) == 0,
+          "records as stored");
+
+    std::vector<log_tag_summary> one, many;
+    CHECK(log_analyze(&capture, 1, 1, NULL, &one) == stored, "records analysed");
+    log_analyze(&capture, 1, 7, NULL, &many);
+    CHECK(one.size() == 50 && many.size() == 50, "every tag summarised");
+    bool equal = true;
+    for (size_t i = 0; i < one.size() && i < many.size(); i++)
+        equal = same(one[i], many[i]) && equal;
+    CHECK(equal, "same result on 1 and 7 threads");
+
+    // tag 0x5003: 23 records, 21 beacons, 3 failures with error code 3
+    const log_tag_summary &s = one[3];
+    CHECK(s.tagId == 0x5003 && s.records == 23 && s.reports == 21, "tag counts");
+    CHECK(s.failures == 3 && s.failureCount == 9 && s.topErrorCode == 3 && s.topErrorReports == 3, "failures");
+    const locator_tag &state = live.tags[locator_engine_find_tag(&live, 0x5003)];
+    CHECK(s.transitions == state.transitions && s.zone == state.zone &&
+          memcmp(s.dwellNs, state.dwellNs, sizeof(s.dwellNs)) == 0, "zones as on the device");
+    // step 10 is a foreign record, so the second outside report (step 12) confirms the change
+    CHECK(s.dwellNs[LOCATOR_ZONE_INSIDE] == 12000000000LL && s.zone == LOCATOR_ZONE_OUTSIDE, "dwell inside");
+    CHECK(s.distanceCm[0] >= 200 && s.distanceCm[1] > s.distanceCm[0] && s.distanceCm[2] <= 222 + 200,
+          "distance percentiles");
+    CHECK(s.rssi[0] <= s.rssi[1] && s.rssi[1] <= s.rssi[2] && s.rssi[2] <= -40, "rssi percentiles");
+
+    // two captures read back to back count twice
+    log_capture twice[2] = {capture, capture};
+    std::vector<log_tag_summary> doubled;
+    CHECK(log_analyze(twice, 2, 3, NULL, &doubled) == 2 * stored && doubled[3].records == 46, "two captures");
+
+    // a second session an hour later: its zones start over and the gap is no one's dwell
+    char later[] = "/tmp/log-analytics-test-XXXXXX";
+    fd = mkstemp(later);
+    std::vector<unsigned char> bytes(capture.data, capture.data + capture.size);
+    for (size_t i = 0; i < capture.count; i++) {
+        log_export_record record;
+        unsigned char *at = &bytes[LOG_EXPORT_HEADER_SIZE + i * LOG_EXPORT_RECORD_SIZE];
+        memcpy(&record, at, sizeof(record));
+        record.record.timestampNs += 3600 * 1000000000LL;
+        memcpy(at, &record, sizeof(record));
+    }
+    CHECK(fd >= 0 && write(fd, bytes.data(), bytes.size()) == (ssize_t)bytes.size(), "later capture");
+    close(fd);
+    log_capture sessions[2] = {capture};
+    CHECK(log_capture_open(&sessions[1], later) == 0, "later capture maps");
+    unlink(later);
+    std::vector<log_tag_summary> apart;
+    log_analyze(sessions, 2, 3, NULL, &apart);
+    bool restarted = true;
+    for (int z = 0; z < LOCATOR_ZONES; z++)
+        restarted = apart[3].dwellNs[z] == 2 * s.dwellNs[z] && doubled[3].dwellNs[z] == 2 * s.dwellNs[z] && restarted;
+    CHECK(restarted && apart[3].transitions == 2 * s.transitions && apart[3].zone == s.zone, "session per capture");
+    log_capture_close(&sessions[1]);
+
+    // a cut capture loses its partial record, a foreign file is refused
+    CHECK(truncate(path, LOG_EXPORT_HEADER_SIZE + 10 * LOG_EXPORT_RECORD_SIZE + 7) == 0, "truncate");
+    log_capture cut;
+    CHECK(log_capture_open(&cut, path) == 0 && cut.count == 10, "cut capture");
+    log_capture_close(&cut);
+    FILE *file = fopen(path, "wb");
+    fputs("not a capture at all", file);
+    fclose(file);
+    CHECK(log_capture_open(&cut, path) == -1, "foreign file");
+
+    log_capture_close(&capture);
+    log_store_close(&store);
+    unlink(path);
+    return check_summary("log-analytics");
+}
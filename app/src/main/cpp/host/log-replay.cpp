@@ -0,0 +1,141 @@
+// Offline analytics for scan logs exported by the app (LogStore.export, log_store_export).
+//   log-replay [--threads N] [--median] [--csv] capture.btlog...
+//   log-replay --generate capture.btlog RECORDS [TAGS]
+// Captures are read in the order given, so pass them oldest first. Prints one row per tag:
+// record and report counts, dwell per zone, zone transitions, ranging failures (share of
+// reports, summed failure counters, most frequent error code), RSSI and distance p5/p50/p95.
+// --generate writes a synthetic capture of walking tags for benchmarking.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "log-analytics.h"
+
+static int generate(const char *path, size_t records, uint32_t tags)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+        return -1;
+    log_export_header header;
+    memcpy(header.magic, LOG_EXPORT_MAGIC, 4);
+    header.version = LOG_EXPORT_VERSION;
+    header.recordSize = LOG_EXPORT_RECORD_SIZE;
+    header.reserved = 0;
+    fwrite(&header, sizeof(header), 1, file);
+    uint32_t seed = 1;
+    std::vector<log_export_record> block(4096);
+    for (size_t written = 0; written < records;) {
+        size_t n = std::min(block.size(), records - written);
+        for (size_t i = 0; i < n; i++) {
+            size_t sequence = written + i;
+            log_export_record &r = block[i];
+            memset(&r, 0, sizeof(r));
+            r.tagId = 0x1000 + (uint32_t)(sequence % tags);
+            r.record.timestampNs = (int64_t)(sequence / tags) * 250000000LL;
+            seed = seed * 1664525 + 1013904223;
+            r.record.rssi = (int8_t)(-50 - (int)(seed >> 27));
+            // the tag walks in and out of the zone every 40 reports, failing now and then
+            size_t step = sequence / tags;
+            uint8_t status = (seed >> 8) % 50 == 0 ? BEACON_STATUS_FAILURE
+                                                   : (step / 40) % 2 == 0 ? BEACON_STATUS_INSIDE
+                                                                          : BEACON_STATUS_OUTSIDE;
+            unsigned char *p = r.record.payload;
+            const unsigned char prefix[] = {0x02, 0x01, 0x06, 0x00, 0xff, 0x97, 0x01, 0x52, status,
+                                            (unsigned char)(r.tagId >> 24), (unsigned char)(r.tagId >> 16),
+                                            (unsigned char)(r.tagId >> 8), (unsigned char)r.tagId};
+            memcpy(p, prefix, sizeof(prefix));
+            size_t length = sizeof(prefix);
+            if (status == BEACON_STATUS_FAILURE) {
+                p[length++] = (unsigned char)(1 + (seed >> 12) % 3);
+                p[length++] = (unsigned char)(1 + (seed >> 16) % 5);
+            } else {
+                for (int l = 0; l < BEACON_LOCATORS; l++) {
+                    uint16_t distance = (uint16_t)(300 + 200 * l + (step * 7 + l * 13) % 400 + (seed >> (l * 4)) % 60);
+                    const unsigned char entry[] = {0, 0, 0x01, (unsigned char)(l + 1), (unsigned char)distance,
+                                                   (unsigned char)(distance >> 8)};
+                    memcpy(p + length, entry, sizeof(entry));
+                    length += sizeof(entry);
+                }
+            }
+            p[3] = (unsigned char)(length - 4);
+            r.record.length = (uint8_t)length;
+        }
+        fwrite(block.data(), sizeof(block[0]), n, file);
+        written += n;
+    }
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int threads = 0;
+    bool csv = false;
+    locator_config config;
+    locator_config_default(&config);
+    std::vector<const char *> paths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--median") == 0)
+            config.filter = LOCATOR_FILTER_MEDIAN;
+        else if (strcmp(argv[i], "--csv") == 0)
+            csv = true;
+        else if (strcmp(argv[i], "--generate") == 0 && i + 2 < argc) {
+            uint32_t tags = i + 3 < argc ? (uint32_t)atoi(argv[i + 3]) : 64;
+            if (generate(argv[i + 1], strtoull(argv[i + 2], NULL, 10), tags > 0 ? tags : 1) != 0) {
+                fprintf(stderr, "cannot write %s\n", argv[i + 1]);
+                return 1;
+            }
+            return 0;
+        } else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty()) {
+        fprintf(stderr, "usage: log-replay [--threads N] [--median] [--csv] capture.btlog...\n"
+                        "       log-replay --generate capture.btlog RECORDS [TAGS]\n");
+        return 2;
+    }
+
+    std::vector<log_capture> captures(paths.size());
+    size_t bytes = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (log_capture_open(&captures[i], paths[i]) != 0) {
+            fprintf(stderr, "%s: not a scan log export\n", paths[i]);
+            return 1;
+        }
+        bytes += captures[i].size;
+    }
+    auto began = std::chrono::steady_clock::now();
+    std::vector<log_tag_summary> summaries;
+    size_t records = log_analyze(captures.data(), captures.size(), threads, &config, &summaries);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - began).count();
+
+    if (csv)
+        printf("tag,records,reports,inside_s,outside_s,failure_s,transitions,zone,failure_rate,failure_count,"
+               "top_error,rssi_p5,rssi_p50,rssi_p95,distance_p5_m,distance_p50_m,distance_p95_m\n");
+    else
+        printf("%-8s %9s %9s %10s %10s %10s %6s %4s %7s %7s %4s %15s %17s\n", "tag", "records", "reports",
+               "inside s", "outside s", "failure s", "trans", "zone", "fail %", "fails", "err",
+               "rssi p5/50/95", "dist m p5/50/95");
+    static const char *const zones[LOCATOR_ZONES] = {"-", "in", "out", "fail"};
+    for (const log_tag_summary &s : summaries) {
+        double rate = s.reports > 0 ? 100.0 * s.failures / s.reports : 0;
+        const char *format = csv ? "%08X,%llu,%llu,%.1f,%.1f,%.1f,%llu,%s,%.2f,%llu,%02X,%.0f,%.0f,%.0f,%.2f,%.2f,%.2f\n"
+                                 : "%08X %9llu %9llu %10.1f %10.1f %10.1f %6llu %4s %7.2f %7llu %4.2X %5.0f%5.0f%5.0f "
+                                   "%5.2f %5.2f %5.2f\n";
+        printf(format, s.tagId, (unsigned long long)s.records, (unsigned long long)s.reports,
+               s.dwellNs[LOCATOR_ZONE_INSIDE] / 1e9, s.dwellNs[LOCATOR_ZONE_OUTSIDE] / 1e9,
+               s.dwellNs[LOCATOR_ZONE_FAILURE] / 1e9, (unsigned long long)s.transitions, zones[s.zone], rate,
+               (unsigned long long)s.failureCount, s.topErrorCode, s.rssi[0], s.rssi[1], s.rssi[2],
+               s.distanceCm[0] / 100, s.distanceCm[1] / 100, s.distanceCm[2] / 100);
+    }
+    fprintf(stderr, "%zu records, %zu tags, %.1f MB in %.3f s (%.1f M records/s, %.0f MB/s)\n", records,
+            summaries.size(), bytes / 1e6, seconds, records / seconds / 1e6, bytes / seconds / 1e6);
+    for (log_capture &capture : captures)
+        log_capture_close(&capture);
+    return 0;
+}
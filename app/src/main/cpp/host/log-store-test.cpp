@@ -0,0 +1,136 @@
+// Tests for the per-tag scan log store, run on the host through ctest.
+
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <cstring>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <vector>
+#include "log-store.h"
+#include "check.h"
+
+static void append(log_store *store, uint32_t tagId, int64_t sequence)
+{
+    unsigned char payload[LOG_PAYLOAD_MAX];
+    for (size_t i = 0; i < sizeof(payload); i++)
+        payload[i] = (unsigned char)(sequence + i);
+    log_store_append(store, tagId, sequence, -(int)(sequence % 100), payload, 30 + sequence % 20);
+}
+
+// every record of every tag comes back in order with its payload
+static bool history_intact(const log_store *store, uint32_t tagId, int64_t firstSequence, int64_t step, size_t count)
+{
+    int32_t tag = log_store_find_tag(store, tagId);
+    if (log_store_record_count(store, tag) != count)
+        return false;
+    for (size_t i = 0; i < count; i++) {
+        const log_record *record = log_store_record(store, tag, i);
+        int64_t sequence = firstSequence + (int64_t)i * step;
+        if (record->timestampNs != sequence || record->rssi != -(int)(sequence % 100) ||
+            record->length != 30 + sequence % 20 || record->payload[5] != (unsigned char)(sequence + 5) ||
+            record->payload[record->length] != 0)
+            return false;
+    }
+    return true;
+}
+
+static void test_in_memory()
+{
+    log_store store;
+    CHECK(log_store_open(&store, LOG_PAGE_SIZE, NULL) == -1, "cap below two pages");
+    log_store_close(&store);
+    CHECK(log_store_open(&store, 64 * LOG_PAGE_SIZE, NULL) == 0, "open");
+    for (int64_t i = 0; i < 300; i++)
+        append(&store, (uint32_t)(i % 3 + 10), i);
+    CHECK(log_store_tag_count(&store) == 3, "tag count");
+    CHECK(history_intact(&store, 10, 0, 3, 100) && history_intact(&store, 12, 2, 3, 100), "history");
+    CHECK(log_store_find_tag(&store, 99) == -1 && log_store_record(&store, 0, 100) == NULL, "out of range");
+
+    // paging straddles page boundaries
+    std::vector<log_record> page(40);
+    int32_t tag = log_store_find_tag(&store, 11);
+    CHECK(log_store_read(&store, tag, 70, 40, page.data()) == 30, "read clamps to the end");
+    CHECK(page[0].timestampNs == 211 && page[29].timestampNs == 298, "read contents");
+    log_store_close(&store);
+}
+
+// without a spill file the oldest pages go and memory stays at the cap
+static void test_drop_oldest()
+{
+    log_store store;
+    log_store_open(&store, 8 * LOG_PAGE_SIZE, NULL);
+    for (int64_t i = 0; i < 1000; i++)
+        append(&store, 7, i);
+    size_t kept = log_store_record_count(&store, 0);
+    CHECK(kept == 8 * LOG_RECORDS_PER_PAGE || kept == 7 * LOG_RECORDS_PER_PAGE + 1000 % LOG_RECORDS_PER_PAGE,
+          "kept records bounded");
+    CHECK(history_intact(&store, 7, 1000 - (int64_t)kept, 1, kept), "newest kept");
+    CHECK(store.tags[0].dropped == 1000 - kept, "dropped counted");
+
+    // more tags than pages: new tags are refused once nothing full is left to evict
+    log_store_close(&store);
+    log_store_open(&store, 2 * LOG_PAGE_SIZE, NULL);
+    CHECK(log_store_append(&store, 1, 0, 0, NULL, 0) == 0 && log_store_append(&store, 2, 0, 0, NULL, 0) == 1,
+          "two tags fit");
+    CHECK(log_store_append(&store, 3, 0, 0, NULL, 0) == -1 && store.rejected == 1, "third tag refused");
+    log_store_close(&store);
+}
+
+// with a spill file nothing is lost and the old pages read back from disk
+static void test_spill()
+{
+    char path[] = "/tmp/log-store-test-XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0, "temp file");
+    close(fd);
+    log_store store;
+    CHECK(log_store_open(&store, 4 * LOG_PAGE_SIZE, path) == 0, "open with spill");
+    CHECK(access(path, F_OK) != 0, "spill file unlinked");
+    for (int64_t i = 0; i < 20000; i++)
+        append(&store, (uint32_t)(i % 2), i);
+    CHECK(history_intact(&store, 0, 0, 2, 10000) && history_intact(&store, 1, 1, 2, 10000), "spilled history");
+    CHECK(store.spillPages > 0 && store.tags[0].dropped == 0, "pages spilled");
+    std::vector<log_record> page(50);
+    CHECK(log_store_read(&store, 1, 3, 50, page.data()) == 50 && page[49].timestampNs == 105, "read from spill");
+    log_store_close(&store);
+}
+
+// a spill file that cannot grow drops the oldest arena page and keeps what is on disk
+static void test_spill_full()
+{
+    char path[] = "/tmp/log-store-test-XXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    // the first 256 spill pages fit, growing the file to 512 fails
+    rlimit saved;
+    getrlimit(RLIMIT_FSIZE, &saved);
+    rlimit limit = saved;
+    limit.rlim_cur = 300 * LOG_PAGE_SIZE;
+    signal(SIGXFSZ, SIG_IGN);
+    setrlimit(RLIMIT_FSIZE, &limit);
+    log_store store;
+    log_store_open(&store, 4 * LOG_PAGE_SIZE, path);
+    for (int64_t i = 0; i < 6000; i++)
+        append(&store, 5, i);
+    setrlimit(RLIMIT_FSIZE, &saved);
+    const log_tag &tag = store.tags[0];
+    size_t count = log_store_record_count(&store, 0);
+    CHECK(store.spillPages == 256 && tag.spilled == 256 && tag.dropped > 0, "spill file full");
+    CHECK(count + tag.dropped == 6000 && log_store_record(&store, 0, count - 1)->timestampNs == 5999,
+          "newest kept");
+    bool spilled = true;
+    for (size_t i = 0; i < 256 * LOG_RECORDS_PER_PAGE; i++)
+        spilled = log_store_record(&store, 0, i)->timestampNs == (int64_t)i && spilled;
+    CHECK(spilled, "spilled pages kept");
+    log_store_close(&store);
+}
+
+int main()
+{
+    test_in_memory();
+    test_drop_oldest();
+    test_spill();
+    test_spill_full();
+    return check_summary("log store");
+}
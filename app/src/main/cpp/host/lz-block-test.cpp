@@ -0,0 +1,217 @@
+// Round trips for the OTA image compression: single blocks through the reference decoder,
+// whole streams, malformed input, and a mapped image compressed, cut into encrypted OTA
+// frames, decrypted and decoded again the way the peripheral would.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <unistd.h>
+#include <vector>
+#include "firmware-image.h"
+#include "lz-block.h"
+#include "check.h"
+
+static bool block_round_trip(const std::vector<unsigned char> &data)
+{
+    std::vector<unsigned char> packed(lz_block_bound(data.size()));
+    size_t length = lz_compress_block(data.data(), data.size(), packed.data());
+    std::vector<unsigned char> unpacked(data.size());
+    int decoded = lz_decompress_block(packed.data(), length, unpacked.data(), unpacked.size());
+    return decoded == (int)data.size() && unpacked == data;
+}
+
+// firmware-like: repeated instruction patterns with varying operands, tables and erased flash
+static std::vector<unsigned char> firmware_like(size_t size, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::vector<unsigned char> image;
+    while (image.size() < size) {
+        unsigned kind = random() % 8;
+        if (kind == 0) {
+            image.insert(image.end(), 64 + random() % 512, 0xff);
+        } else if (kind < 3) {
+            for (int i = random() % 64; i >= 0; i--)
+                image.push_back((unsigned char)random());
+        } else {
+            static const unsigned char prologue[] = {0x2d, 0xe9, 0xf0, 0x41, 0x04, 0x46, 0x0d, 0x46};
+            image.insert(image.end(), prologue, prologue + sizeof(prologue));
+            for (int i = 0; i < 4; i++) {
+                image.push_back((unsigned char)(random() % 16));
+                image.push_back(0x20 + (unsigned char)i);
+                image.push_back(0x00);
+                image.push_back(0xf0);
+            }
+            image.push_back(0xbd);
+            image.push_back(0xe8);
+        }
+    }
+    image.resize(size);
+    return image;
+}
+
+static std::vector<unsigned char> encode_stream(const std::vector<unsigned char> &data, size_t blockSize)
+{
+    lz_encoder encoder;
+    std::vector<unsigned char> stream;
+    if (lz_encoder_init(&encoder, data.data(), data.size(), blockSize) != 0)
+        return stream;
+    std::vector<unsigned char> piece(lz_encoder_bound(&encoder));
+    size_t written;
+    while ((written = lz_encoder_next(&encoder, piece.data())) > 0)
+        stream.insert(stream.end(), piece.begin(), piece.begin() + written);
+    return stream;
+}
+
+static void test_blocks()
+{
+    std::mt19937 random(7);
+    std::vector<unsigned char> empty;
+    CHECK(block_round_trip(empty), "empty block");
+    std::vector<unsigned char> tiny = {1, 2, 3, 1, 2, 3, 1, 2, 3};
+    CHECK(block_round_trip(tiny), "shorter than a match");
+    std::vector<unsigned char> zeros(LZ_MAX_BLOCK_SIZE, 0);
+    CHECK(block_round_trip(zeros), "long overlapping match");
+    std::vector<unsigned char> noise(4096);
+    for (unsigned char &b : noise)
+        b = (unsigned char)random();
+    CHECK(block_round_trip(noise), "long literal run");
+    std::vector<unsigned char> text;
+    const char *line = "ota chunk written without response, window of eight frames\n";
+    while (text.size() < 3000)
+        text.insert(text.end(), line, line + strlen(line));
+    CHECK(block_round_trip(text), "repeated text");
+    for (size_t length = 0; length < 64; length++) {
+        std::vector<unsigned char> mixed(length);
+        for (size_t i = 0; i < length; i++)
+            mixed[i] = (unsigned char)(i % 5 == 0 ? random() : i % 3);
+        if (!block_round_trip(mixed)) {
+            printf("length %zu\n", length);
+            CHECK(false, "short blocks");
+        }
+    }
+
+    // the decoder must refuse rather than run off either buffer
+    std::vector<unsigned char> packed(lz_block_bound(text.size()));
+    size_t length = lz_compress_block(text.data(), text.size(), packed.data());
+    CHECK(length < text.size() / 10, "text compresses");
+    std::vector<unsigned char> out(text.size());
+    CHECK(lz_decompress_block(packed.data(), length - 1, out.data(), out.size()) == -1, "truncated block");
+    CHECK(lz_decompress_block(packed.data(), length, out.data(), out.size() - 1) == -1, "output too small");
+    const unsigned char badOffset[] = {0x10, 'a', 0x05, 0x00, 0x00};
+    CHECK(lz_decompress_block(badOffset, sizeof(badOffset), out.data(), out.size()) == -1, "offset before start");
+    const unsigned char zeroOffset[] = {0x10, 'a', 0x00, 0x00, 0x00};
+    CHECK(lz_decompress_block(zeroOffset, sizeof(zeroOffset), out.data(), out.size()) == -1, "zero offset");
+    CHECK(lz_decompress_block(packed.data(), 0, out.data(), out.size()) == -1, "no token");
+}
+
+static void test_streams()
+{
+    lz_encoder encoder;
+    CHECK(lz_encoder_init(&encoder, NULL, 0, 0) == -1, "zero block size");
+    CHECK(lz_encoder_init(&encoder, NULL, 0, LZ_MAX_BLOCK_SIZE + 1) == -1, "block size too large");
+
+    std::vector<unsigned char> image = firmware_like(200000, 1);
+    for (size_t blockSize : {(size_t)512, (size_t)LZ_DEFAULT_BLOCK_SIZE, (size_t)LZ_MAX_BLOCK_SIZE}) {
+        std::vector<unsigned char> stream = encode_stream(image, blockSize);
+        CHECK(lz_stream_raw_size(stream.data(), stream.size()) == (long)image.size(), "raw size in header");
+        std::vector<unsigned char> decoded(image.size());
+        CHECK(lz_stream_decode(stream.data(), stream.size(), decoded.data(), decoded.size()) == (long)image.size() &&
+              decoded == image, "stream round trip");
+        printf("block %5zu: %zu -> %zu bytes, ratio %.3f\n", blockSize, image.size(), stream.size(),
+               (double)stream.size() / image.size());
+    }
+
+    std::vector<unsigned char> stream = encode_stream(image, LZ_DEFAULT_BLOCK_SIZE);
+    CHECK(stream.size() < image.size() * 7 / 10, "firmware-like image saves at least 30%");
+    std::vector<unsigned char> decoded(image.size());
+    CHECK(lz_stream_decode(stream.data(), stream.size() - 1, decoded.data(), decoded.size()) == -1, "truncated stream");
+    CHECK(lz_stream_decode(stream.data(), stream.size(), decoded.data(), decoded.size() - 1) == -1, "stream too large");
+    std::vector<unsigned char> padded(stream);
+    padded.insert(padded.end(), 3, 0);
+    CHECK(lz_stream_decode(padded.data(), padded.size(), decoded.data(), decoded.size()) == (long)image.size(),
+          "padding after the last block");
+    std::vector<unsigned char> badMagic(stream);
+    badMagic[0] = 'X';
+    CHECK(lz_stream_decode(badMagic.data(), badMagic.size(), decoded.data(), decoded.size()) == -1, "magic");
+
+    // incompressible blocks go out stored, a few bytes over the raw size at most
+    std::mt19937 random(3);
+    std::vector<unsigned char> noise(10000);
+    for (unsigned char &b : noise)
+        b = (unsigned char)random();
+    std::vector<unsigned char> stored = encode_stream(noise, LZ_DEFAULT_BLOCK_SIZE);
+    CHECK(stored.size() == noise.size() + LZ_STREAM_HEADER_SIZE + 3 * LZ_BLOCK_HEADER_SIZE, "stored blocks");
+    decoded.assign(noise.size(), 0);
+    CHECK(lz_stream_decode(stored.data(), stored.size(), decoded.data(), decoded.size()) == (long)noise.size() &&
+          decoded == noise, "stored round trip");
+}
+
+static bool write_temp(char *path, const std::vector<unsigned char> &bytes)
+{
+    int fd = mkstemp(path);
+    bool written = fd >= 0 && write(fd, bytes.data(), bytes.size()) == (ssize_t)bytes.size();
+    if (fd >= 0)
+        close(fd);
+    return written;
+}
+
+static void test_firmware_image()
+{
+    std::vector<unsigned char> bytes = firmware_like(100003, 2);
+    char path[] = "/tmp/lz-block-test-XXXXXX";
+    CHECK(write_temp(path, bytes), "temp image");
+    firmware_image image;
+    CHECK(firmware_image_open(&image, path) == 0, "open image");
+    unlink(path);
+    firmware_image_set_chunk_size(&image, 240);
+    size_t rawChunks = image.chunkCount;
+    long packedSize = firmware_image_compress(&image, LZ_DEFAULT_BLOCK_SIZE);
+    CHECK(packedSize > 0 && (size_t)packedSize == image.size && image.rawSize == bytes.size(), "compressed size");
+    CHECK(image.size % RC5_ENC_BLOCK_SIZE == 0, "padded to whole rc5 blocks");
+    CHECK(image.chunkCount < rawChunks, "fewer chunks");
+    CHECK(firmware_image_compress(&image, LZ_DEFAULT_BLOCK_SIZE) == -1, "compressed once");
+    printf("image: %zu -> %zu bytes over the air, %zu -> %zu frames\n", image.rawSize, image.size, rawChunks,
+           image.chunkCount);
+
+    // the peripheral side: decrypt every frame, join them and decode the stream
+    rc5_session session;
+    unsigned char key[_keyLengthInByte] = {0x45, 0x07, 0xb6, 0xf3, 0x16, 0x9a, 0xe7, 0x93,
+                                           0x7d, 0x3d, 0x4b, 0x8a, 0x31, 0x70, 0x49, 0x8f};
+    rc5_session_init(&session, key);
+    std::vector<unsigned char> frame(cipher_rc5_frame_size(image.chunkSize));
+    std::vector<unsigned char> received;
+    for (size_t i = 0; i < image.chunkCount; i++) {
+        size_t length = firmware_image_encrypt_frame(&image, &session, i, frame.data());
+        received.insert(received.end(), frame.begin() + 1, frame.begin() + length);
+    }
+    rc5_session_decrypt(&session, received.data(), received.data(), received.size());
+    std::vector<unsigned char> decoded(bytes.size());
+    CHECK(lz_stream_decode(received.data(), received.size(), decoded.data(), decoded.size()) == (long)bytes.size() &&
+          decoded == bytes, "image through encrypted frames");
+    firmware_image_close(&image);
+
+    // an image that would not shrink keeps going out raw
+    std::mt19937 random(5);
+    std::vector<unsigned char> noise(5000);
+    for (unsigned char &b : noise)
+        b = (unsigned char)random();
+    char noisePath[] = "/tmp/lz-block-test-XXXXXX";
+    CHECK(write_temp(noisePath, noise), "temp noise");
+    CHECK(firmware_image_open(&image, noisePath) == 0, "open noise");
+    unlink(noisePath);
+    firmware_image_set_chunk_size(&image, 240);
+    CHECK(firmware_image_compress(&image, LZ_DEFAULT_BLOCK_SIZE) == -1, "incompressible image");
+    firmware_chunk chunk = firmware_image_chunk(&image, 0);
+    CHECK(image.size == noise.size() && chunk.data != NULL && memcmp(chunk.data, noise.data(), chunk.size) == 0,
+          "raw image untouched");
+    firmware_image_close(&image);
+}
+
+int main()
+{
+    test_blocks();
+    test_streams();
+    test_firmware_image();
+    return check_summary("lz-block");
+}
@@ -0,0 +1,259 @@
+// Runs the windowed OTA sender against a simulated peripheral on a loopback link, on the host
+// through ctest. As with BluetoothGatt, the app has one write outstanding at a time and a
+// second one is refused until its onCharacteristicWrite. A write request calls back with the
+// response; a write command once the stack has room for it in its buffers, which the
+// connection events drain a few packets at a time. The link also has a one-way latency,
+// random busy refusals and on-air losses that the link layer resends at the next event.
+// The peripheral decrypts what it receives and the result must be the image, with the
+// digest built while sending matching one computed over what arrived.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <unistd.h>
+#include <vector>
+#include "ota-transfer.h"
+#include "check.h"
+
+static unsigned char otaKey[_keyLengthInByte] = {0x45, 0x07, 0xb6, 0xf3, 0x16, 0x9a, 0xe7, 0x93,
+                                                 0x7d, 0x3d, 0x4b, 0x8a, 0x31, 0x70, 0x49, 0x8f};
+
+struct link_config {
+    bool withResponse;       // write request: completes when the response comes back
+    size_t window;
+    int64_t intervalNs;      // connection interval
+    size_t packetsPerEvent;
+    int64_t latencyNs;       // one way
+    size_t queueSlots;       // stack and controller buffers for outgoing writes, not visible to the app
+    int64_t stackNs;         // from a write command to its callback when a buffer is free
+    double refuseRate;       // writes refused although none is outstanding
+    double lossRate;         // packets lost on air, resent at the next event
+    double errorRate;        // write requests answered with an error
+    bool linkLost;           // stops completing after the first event
+};
+
+struct link_result {
+    int state;
+    ota_transfer_stats stats;
+    std::vector<unsigned char> received; // decrypted, whole blocks of each chunk
+    bool digestComplete;
+    unsigned char digest[IMAGE_DIGEST_SIZE];
+};
+
+struct pending {
+    int64_t atNs;
+    int status;
+};
+
+static link_result run_link(const firmware_image *image, const rc5_session *session, const link_config &config,
+                            unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    ota_transfer transfer;
+    link_result result;
+    result.state = ota_transfer_init(&transfer, image, session, config.window, 5, 2000000000ll, 244);
+    if (result.state != 0)
+        return result;
+    image_digest digest;
+    image_digest_init(&digest, otaKey);
+    ota_transfer_attach_digest(&transfer, &digest);
+    std::vector<unsigned char> frame(ota_transfer_frame_size(&transfer));
+    std::deque<std::vector<unsigned char>> queue;
+    std::vector<unsigned char> held;     // written, waiting for a free buffer
+    bool writing = false;                // a write is outstanding
+    std::deque<pending> completions;
+    int64_t now = 0, nextEvent = config.intervalNs;
+    int state = 0;
+    // a write command calls back once it is in a buffer, a request only with its response
+    auto buffer = [&](std::vector<unsigned char> packet, int64_t at) {
+        queue.push_back(std::move(packet));
+        if (!config.withResponse)
+            completions.push_back({at + config.stackNs, 0});
+    };
+    while (state >= 0 && now < 600ll * 1000000000) {
+        // the app writes whatever the window allows, the framework takes one at a time
+        size_t length;
+        while (ota_transfer_next(&transfer, now, frame.data(), &length) >= 0) {
+            if (writing || uniform(random) < config.refuseRate) {
+                ota_transfer_refused(&transfer);
+                break;
+            }
+            writing = true;
+            std::vector<unsigned char> packet(frame.begin(), frame.begin() + length);
+            if (queue.size() < config.queueSlots)
+                buffer(std::move(packet), now);
+            else
+                held = std::move(packet);
+        }
+        state = ota_transfer_poll(&transfer, now);
+        if (state < 0)
+            break;
+        // next thing to happen: a completion callback or a connection event
+        if (!completions.empty() && completions.front().atNs <= nextEvent) {
+            now = completions.front().atNs;
+            writing = false;
+            state = ota_transfer_complete(&transfer, completions.front().status, now);
+            completions.pop_front();
+            continue;
+        }
+        now = nextEvent;
+        nextEvent += config.intervalNs;
+        if (config.linkLost && now > config.intervalNs)
+            continue;
+        for (size_t sent = 0; sent < config.packetsPerEvent && !queue.empty(); sent++) {
+            if (uniform(random) < config.lossRate)
+                break;
+            const std::vector<unsigned char> &packet = queue.front();
+            int status = 0;
+            if (config.withResponse && uniform(random) < config.errorRate)
+                status = 1;
+            else
+                result.received.insert(result.received.end(), packet.begin() + 1, packet.end());
+            // the response goes out at the peripheral's next event
+            if (config.withResponse)
+                completions.push_back({now + 2 * config.latencyNs + config.intervalNs, status});
+            queue.pop_front();
+        }
+        if (!held.empty() && queue.size() < config.queueSlots) {
+            buffer(std::move(held), now);
+            held.clear();
+        }
+    }
+    // the last commands are confirmed from the buffers and go on air after that
+    for (; state == OTA_TRANSFER_DONE && !queue.empty(); queue.pop_front())
+        result.received.insert(result.received.end(), queue.front().begin() + 1, queue.front().end());
+    result.state = state;
+    ota_transfer_get_stats(&transfer, &result.stats);
+    result.digestComplete = image_digest_complete(&digest, image);
+    image_digest_final(&digest, result.digest);
+    rc5_session_decrypt(session, result.received.data(), result.received.data(), result.received.size());
+    return result;
+}
+
+// the image bytes the peripheral can get: the whole blocks of every chunk
+static std::vector<unsigned char> expected_payload(const firmware_image *image)
+{
+    std::vector<unsigned char> payload;
+    for (size_t i = 0; i < image->chunkCount; i++) {
+        firmware_chunk chunk = firmware_image_chunk(image, i);
+        payload.insert(payload.end(), chunk.data, chunk.data + chunk.size - chunk.size % RC5_ENC_BLOCK_SIZE);
+    }
+    return payload;
+}
+
+// what the peripheral computes over the payload it reassembled
+static bool digest_matches(const link_result &result)
+{
+    unsigned char expected[IMAGE_DIGEST_SIZE];
+    uint32_t crc = crc32_update(0, result.received.data(), result.received.size());
+    for (int i = 0; i < 4; i++)
+        expected[i] = (unsigned char)(crc >> (8 * i));
+    aes_cmac cmac;
+    aes_cmac_init(&cmac, otaKey);
+    aes_cmac_update(&cmac, result.received.data(), result.received.size());
+    aes_cmac_final(&cmac, expected + 4);
+    return result.digestComplete && memcmp(expected, result.digest, IMAGE_DIGEST_SIZE) == 0;
+}
+
+static link_config default_link()
+{
+    link_config config;
+    config.withResponse = false;
+    config.window = 1;
+    config.intervalNs = 15000000;
+    config.packetsPerEvent = 4;
+    config.latencyNs = 2000000;
+    config.queueSlots = 6;
+    config.stackNs = 1000000;
+    config.refuseRate = 0;
+    config.lossRate = 0;
+    config.errorRate = 0;
+    config.linkLost = false;
+    return config;
+}
+
+int main()
+{
+    char path[] = "/tmp/ota-transfer-test-XXXXXX";
+    int fd = mkstemp(path);
+    std::vector<unsigned char> bytes(30003);
+    for (size_t i = 0; i < bytes.size(); i++)
+        bytes[i] = (unsigned char)(i * 31 + (i >> 8));
+    CHECK(fd >= 0 && write(fd, bytes.data(), bytes.size()) == (ssize_t)bytes.size(), "temp image");
+    close(fd);
+    firmware_image image;
+    CHECK(firmware_image_open(&image, path) == 0, "open image");
+    unlink(path);
+    firmware_image_set_chunk_size(&image, 240);
+    rc5_session session;
+    rc5_session_init(&session, otaKey);
+    std::vector<unsigned char> expected = expected_payload(&image);
+
+    ota_transfer transfer;
+    CHECK(ota_transfer_init(&transfer, &image, &session, 8, 5, 0, 240) == -1, "frame larger than the MTU");
+    CHECK(ota_transfer_init(&transfer, &image, &session, 0, 5, 0, 244) == -1, "empty window");
+
+    // the old way: one write request per chunk
+    link_config baseline = default_link();
+    baseline.withResponse = true;
+    baseline.window = 1;
+    link_result serial = run_link(&image, &session, baseline, 1);
+    CHECK(serial.state == OTA_TRANSFER_DONE && serial.received == expected, "request per chunk");
+
+    // what the app does: a write command, the next one from its callback
+    link_result paced = run_link(&image, &session, default_link(), 1);
+    CHECK(paced.state == OTA_TRANSFER_DONE && paced.received == expected, "command per callback");
+    CHECK(paced.stats.elapsedNs * 4 < serial.stats.elapsedNs, "commands at least 4x faster");
+    CHECK(digest_matches(serial) && digest_matches(paced), "digest of what arrived");
+
+    // a wider window only produces frames the framework refuses
+    link_config wide = default_link();
+    wide.window = 8;
+    link_result windowed = run_link(&image, &session, wide, 1);
+    CHECK(windowed.state == OTA_TRANSFER_DONE && windowed.received == expected, "windowed");
+    CHECK(windowed.stats.refusals >= windowed.stats.chunks && windowed.stats.elapsedNs >= paced.stats.elapsedNs,
+          "one write outstanding, a window gains nothing");
+    CHECK(memcmp(serial.digest, windowed.digest, IMAGE_DIGEST_SIZE) == 0, "digest independent of the window");
+
+    link_config lossy = default_link();
+    lossy.refuseRate = 0.1;
+    lossy.lossRate = 0.2;
+    link_result busy = run_link(&image, &session, lossy, 2);
+    CHECK(busy.state == OTA_TRANSFER_DONE && busy.received == expected, "refusals and losses");
+    CHECK(busy.stats.refusals > 0 && busy.stats.retransmits == 0, "refusals are not retransmits");
+
+    link_config errors = baseline;
+    errors.errorRate = 0.1;
+    link_result retried = run_link(&image, &session, errors, 3);
+    CHECK(retried.state == OTA_TRANSFER_DONE && retried.received == expected, "error responses resent");
+    CHECK(retried.stats.retransmits > 0, "retransmits counted");
+    CHECK(digest_matches(retried) && digest_matches(busy), "resent chunks absorbed once");
+
+    errors.errorRate = 1;
+    CHECK(run_link(&image, &session, errors, 4).state == OTA_TRANSFER_FAILED, "gives up after max attempts");
+
+    link_config lost = default_link();
+    lost.linkLost = true;
+    link_result timedOut = run_link(&image, &session, lost, 5);
+    CHECK(timedOut.state == OTA_TRANSFER_FAILED, "times out on a lost link");
+    CHECK(!timedOut.digestComplete, "no digest for a partial transfer");
+
+    // chunk size from the smallest MTU: 23 - 4 leaves 19 bytes, rounded down to 16
+    firmware_image_set_chunk_size(&image, 23 - 4);
+    CHECK(image.chunkSize == 16 && ota_transfer_init(&transfer, &image, &session, 8, 5, 0, 23 - 3) == 0,
+          "chunk size in whole blocks");
+    link_result small = run_link(&image, &session, default_link(), 6);
+    CHECK(small.state == OTA_TRANSFER_DONE && small.received.size() == bytes.size() - bytes.size() % RC5_ENC_BLOCK_SIZE &&
+          memcmp(small.received.data(), bytes.data(), small.received.size()) == 0, "minimum MTU loses nothing");
+    CHECK(digest_matches(small), "digest at the minimum MTU");
+
+    printf("%zu chunks: request per chunk %.0f ms, command per callback %.0f ms (latency p95 %.1f ms), "
+           "window of 8 %.0f ms (%zu refusals), lossy %.0f ms (%zu refusals)\n", serial.stats.chunks,
+           serial.stats.elapsedNs / 1e6, paced.stats.elapsedNs / 1e6, paced.stats.latencyP95Ns / 1e6,
+           windowed.stats.elapsedNs / 1e6, windowed.stats.refusals, busy.stats.elapsedNs / 1e6, busy.stats.refusals);
+    firmware_image_close(&image);
+    return check_summary("OTA transfer");
+}
@@ -0,0 +1,103 @@
+// Hot-path probes: per-thread slabs add up in a snapshot, registries of several libraries
+// merge, quantiles come from the right buckets, and both exports carry the same totals.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "probe.h"
+#include "check.h"
+
+static uint64_t read64(const unsigned char *p)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--)
+        value = value << 8 | p[i];
+    return value;
+}
+
+static void test_threads()
+{
+    probe_registry *local = probe_local_registry();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++)
+        workers.emplace_back([t]() {
+            for (int i = 0; i < 10000; i++)
+                probe_record(PROBE_AES_ENCRYPT, 100 + t, 16);
+        });
+    for (std::thread &worker : workers)
+        worker.join();
+    probe_totals totals[PROBE_COUNT];
+    probe_snapshot(&local, 1, totals);
+    CHECK(totals[PROBE_AES_ENCRYPT].calls == 40000, "calls from every thread");
+    CHECK(totals[PROBE_AES_ENCRYPT].bytes == 640000, "bytes");
+    CHECK(totals[PROBE_AES_ENCRYPT].totalNs == 10000ull * (100 + 101 + 102 + 103), "total ns");
+    CHECK(totals[PROBE_AES_ENCRYPT].maxNs == 103, "max ns");
+    CHECK(totals[PROBE_AES_ENCRYPT].buckets[6] == 40000, "64..127 ns bucket");
+    CHECK(totals[PROBE_JNI].calls == 0, "untouched probe");
+}
+
+static void test_scope_and_quantiles()
+{
+    {
+        probe_scope scope(PROBE_BEACON_PARSE);
+        scope.bytes = 62;
+    }
+    for (int i = 0; i < 98; i++)
+        probe_record(PROBE_OTA_RTT, 7000000, 240);         // ~7 ms, bucket 22
+    probe_record(PROBE_OTA_RTT, 300000000, 240);           // a 300 ms stall, bucket 28
+    probe_record(PROBE_OTA_RTT, 1ull << 40, 240);          // beyond the last bucket
+    probe_registry *local = probe_local_registry();
+    probe_totals totals[PROBE_COUNT];
+    probe_snapshot(&local, 1, totals);
+    CHECK(totals[PROBE_BEACON_PARSE].calls == 1 && totals[PROBE_BEACON_PARSE].bytes == 62, "scope records");
+    const probe_totals &rtt = totals[PROBE_OTA_RTT];
+    CHECK(rtt.buckets[22] == 98 && rtt.buckets[28] == 1 && rtt.buckets[PROBE_BUCKETS - 1] == 1, "rtt buckets");
+    CHECK(probe_quantile_ns(&rtt, 0.5) == (1ull << 23) - 1, "p50 upper bound");
+    CHECK(probe_quantile_ns(&rtt, 0.99) == (1ull << 29) - 1, "p99 reaches the stall");
+    CHECK(probe_quantile_ns(&rtt, 1.0) == 1ull << 40, "last bucket reports the max");
+    CHECK(probe_quantile_ns(&totals[PROBE_RC5_DECRYPT], 0.5) == 0, "empty probe");
+}
+
+// a second library's registry, built the way its own copy of probe.cpp would
+static void test_merge_and_export()
+{
+    probe_registry other = {{NULL}};
+    probe_slab *slab = new probe_slab();
+    slab->calls[PROBE_JNI].store(5);
+    slab->totalNs[PROBE_JNI].store(5000);
+    slab->maxNs[PROBE_JNI].store(2000);
+    slab->buckets[PROBE_JNI][9].store(5);
+    slab->next = NULL;
+    other.slabs.store(slab);
+
+    probe_record(PROBE_JNI, 3000, 0);
+    probe_registry *registries[] = {probe_local_registry(), &other};
+    probe_totals totals[PROBE_COUNT];
+    probe_snapshot(registries, 2, totals);
+    CHECK(totals[PROBE_JNI].calls == 6 && totals[PROBE_JNI].totalNs == 8000 && totals[PROBE_JNI].maxNs == 3000,
+          "registries merge");
+
+    std::vector<unsigned char> trace = probe_export_binary(totals);
+    const size_t perProbe = 8 * (4 + PROBE_BUCKETS);
+    CHECK(trace.size() == 12 + PROBE_COUNT * perProbe && memcmp(trace.data(), "PRB1", 4) == 0, "binary layout");
+    const unsigned char *jni = trace.data() + 12 + PROBE_JNI * perProbe;
+    CHECK(read64(jni) == 6 && read64(jni + 16) == 8000 && read64(jni + 32 + 8 * 9) == 5, "binary values");
+
+    std::string json = probe_export_json(totals);
+    CHECK(json.find("\"jni\":{\"calls\":6,\"bytes\":0,\"totalNs\":8000,\"maxNs\":3000,\"meanNs\":1333") !=
+          std::string::npos, "json counters");
+    CHECK(json.find("\"buckets\":{\"512\":5,\"2048\":1}") != std::string::npos, "json buckets");
+    CHECK(json.front() == '{' && json.back() == '}' && json.find("\"ota-rtt\"") != std::string::npos, "json shape");
+    printf("%s\n", json.c_str());
+    delete slab;
+}
+
+int main()
+{
+    test_threads();
+    test_scope_and_quantiles();
+    test_merge_and_export();
+    return check_summary("probe");
+}
@@ -0,0 +1,38 @@
+#include "image-digest.h"
+
+void image_digest_init(image_digest *digest, unsigned char *key)
+{
+    digest->crc32 = crc32_kernel_select();
+    digest->crc = 0;
+    aes_cmac_init(&digest->cmac, key);
+    digest->nextChunk = 0;
+    digest->bytes = 0;
+}
+
+int image_digest_add_chunk(image_digest *digest, const firmware_image *image, size_t index)
+{
+    if (index != digest->nextChunk)
+        return -1;
+    firmware_chunk chunk = firmware_image_chunk(image, index);
+    if (chunk.data == NULL)
+        return -1;
+    // the frame drops a partial last block, so does the digest
+    size_t length = chunk.size - chunk.size % RC5_ENC_BLOCK_SIZE;
+    digest->crc = digest->crc32->update(digest->crc, chunk.data, length);
+    aes_cmac_update(&digest->cmac, chunk.data, length);
+    digest->nextChunk++;
+    digest->bytes += length;
+    return 0;
+}
+
+bool image_digest_complete(const image_digest *digest, const firmware_image *image)
+{
+    return digest->nextChunk == image->chunkCount;
+}
+
+void image_digest_final(const image_digest *digest, unsigned char *out)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = (unsigned char)(digest->crc >> (8 * i));
+    aes_cmac_final(&digest->cmac, out + 4);
+}
@@ -0,0 +1,32 @@
+#ifndef IMAGE_DIGEST_H
+#define IMAGE_DIGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "aes-modes.h"
+#include "crc32.h"
+#include "firmware-image.h"
+
+// integrity of what the peripheral reassembles: the whole RC5 blocks of every chunk, in chunk
+// order, after decryption. It is built up as frames are first produced, so it costs no pass
+// of its own over the image. The digest is the CRC-32 (little endian) followed by the
+// AES-CMAC keyed with the OTA key
+#define IMAGE_DIGEST_SIZE (4 + AES_BLOCK_SIZE)
+
+struct image_digest {
+    const crc32_kernel *crc32;
+    uint32_t crc;
+    aes_cmac cmac;
+    size_t nextChunk;
+    size_t bytes;
+};
+
+void image_digest_init(image_digest *digest, unsigned char *key);
+// absorbs chunk index when it is the next one in order and returns 0; resent or out of order
+// chunks are ignored and return -1
+int image_digest_add_chunk(image_digest *digest, const firmware_image *image, size_t index);
+// true once every chunk of the image has been absorbed
+bool image_digest_complete(const image_digest *digest, const firmware_image *image);
+void image_digest_final(const image_digest *digest, unsigned char *out);
+
+#endif //IMAGE_DIGEST_H
@@ -0,0 +1,492 @@
+#include <math.h>
+#include <string.h>
+#include "locator-engine.h"
+
+static_assert(sizeof(locator_fix) == LOCATOR_FIX_SIZE, "locator_fix layout is shared with Kotlin");
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// the kernel is written once over these operations, so the scalar and the vector kernels
+// run the same arithmetic in the same order
+struct scalar_ops {
+    typedef float v;
+    static v load(const float *p) { return *p; }
+    static void store(float *p, v a) { *p = a; }
+    static v set(float a) { return a; }
+    static v add(v a, v b) { return a + b; }
+    static v sub(v a, v b) { return a - b; }
+    static v mul(v a, v b) { return a * b; }
+    static v div(v a, v b) { return a / b; }
+    static v min(v a, v b) { return a < b ? a : b; }
+    static v max(v a, v b) { return a > b ? a : b; }
+    static v sqrt(v a) { return sqrtf(a); }
+    static v abs(v a) { return fabsf(a); }
+    static void greater(uint32_t *out, v a, v b) { *out = a > b ? 0xffffffffu : 0; }
+};
+
+#if defined(__SSE2__)
+struct sse2_ops {
+    typedef __m128 v;
+    static v load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, v a) { _mm_storeu_ps(p, a); }
+    static v set(float a) { return _mm_set1_ps(a); }
+    static v add(v a, v b) { return _mm_add_ps(a, b); }
+    static v sub(v a, v b) { return _mm_sub_ps(a, b); }
+    static v mul(v a, v b) { return _mm_mul_ps(a, b); }
+    static v div(v a, v b) { return _mm_div_ps(a, b); }
+    static v min(v a, v b) { return _mm_min_ps(a, b); }
+    static v max(v a, v b) { return _mm_max_ps(a, b); }
+    static v sqrt(v a) { return _mm_sqrt_ps(a); }
+    static v abs(v a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static void greater(uint32_t *out, v a, v b)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_castps_si128(_mm_cmpgt_ps(a, b)));
+    }
+};
+#elif defined(__aarch64__)
+struct neon_ops {
+    typedef float32x4_t v;
+    static v load(const float *p) { return vld1q_f32(p); }
+    static void store(float *p, v a) { vst1q_f32(p, a); }
+    static v set(float a) { return vdupq_n_f32(a); }
+    static v add(v a, v b) { return vaddq_f32(a, b); }
+    static v sub(v a, v b) { return vsubq_f32(a, b); }
+    static v mul(v a, v b) { return vmulq_f32(a, b); }
+    static v div(v a, v b) { return vdivq_f32(a, b); }
+    static v min(v a, v b) { return vminq_f32(a, b); }
+    static v max(v a, v b) { return vmaxq_f32(a, b); }
+    static v sqrt(v a) { return vsqrtq_f32(a); }
+    static v abs(v a) { return vabsq_f32(a); }
+    static void greater(uint32_t *out, v a, v b) { vst1q_u32(out, vcgtq_f32(a, b)); }
+};
+#endif
+
+template <typename O>
+static typename O::v median3(typename O::v a, typename O::v b, typename O::v c)
+{
+    return O::max(O::min(a, b), O::min(O::max(a, b), c));
+}
+
+// exact median of five with nine min/max and no branches
+template <typename O>
+static typename O::v median5(typename O::v a, typename O::v b, typename O::v c, typename O::v d,
+                             typename O::v e)
+{
+    return median3<O>(e, O::max(O::min(a, b), O::min(c, d)), O::min(O::max(a, b), O::max(c, d)));
+}
+
+// subtracting the first circle from the other two leaves a 2x2 linear system, solved around
+// the first locator to keep the squares small; the residual is the rms misfit of the circles
+template <typename O>
+static void solve(const float *lx, const float *ly, const float *r, size_t stride, float *x, float *y,
+                  float *residual, uint32_t *solved)
+{
+    typedef typename O::v v;
+    v x0 = O::load(lx), y0 = O::load(ly);
+    v dx1 = O::sub(O::load(lx + stride), x0), dy1 = O::sub(O::load(ly + stride), y0);
+    v dx2 = O::sub(O::load(lx + 2 * stride), x0), dy2 = O::sub(O::load(ly + 2 * stride), y0);
+    v r0 = O::load(r), r1 = O::load(r + stride), r2 = O::load(r + 2 * stride);
+    v span1 = O::add(O::mul(dx1, dx1), O::mul(dy1, dy1));
+    v span2 = O::add(O::mul(dx2, dx2), O::mul(dy2, dy2));
+    v half = O::set(0.5f);
+    v b1 = O::mul(O::add(O::sub(O::mul(r0, r0), O::mul(r1, r1)), span1), half);
+    v b2 = O::mul(O::add(O::sub(O::mul(r0, r0), O::mul(r2, r2)), span2), half);
+    v det = O::sub(O::mul(dx1, dy2), O::mul(dy1, dx2));
+    // the sine of the angle at the first locator must be above ~1%
+    O::greater(solved, O::abs(det), O::mul(O::add(span1, span2), O::set(0.005f)));
+    v px = O::div(O::sub(O::mul(b1, dy2), O::mul(dy1, b2)), det);
+    v py = O::div(O::sub(O::mul(dx1, b2), O::mul(b1, dx2)), det);
+    v e0 = O::sub(O::sqrt(O::add(O::mul(px, px), O::mul(py, py))), r0);
+    v ex1 = O::sub(px, dx1), ey1 = O::sub(py, dy1);
+    v e1 = O::sub(O::sqrt(O::add(O::mul(ex1, ex1), O::mul(ey1, ey1))), r1);
+    v ex2 = O::sub(px, dx2), ey2 = O::sub(py, dy2);
+    v e2 = O::sub(O::sqrt(O::add(O::mul(ex2, ex2), O::mul(ey2, ey2))), r2);
+    v sum = O::add(O::add(O::mul(e0, e0), O::mul(e1, e1)), O::mul(e2, e2));
+    O::store(x, O::add(x0, px));
+    O::store(y, O::add(y0, py));
+    O::store(residual, O::sqrt(O::mul(sum, O::set(1.0f / 3))));
+}
+
+// filters and solves the lanes starting at lane, as many as O::v holds
+template <typename O>
+static void run_lanes(const locator_config *config, locator_lanes *l, size_t lane)
+{
+    typedef typename O::v v;
+    for (int k = 0; k < BEACON_LOCATORS; k++) {
+        if (config->filter == LOCATOR_FILTER_MEDIAN) {
+            v median = median5<O>(O::load(&l->window[0][k][lane]), O::load(&l->window[1][k][lane]),
+                                  O::load(&l->window[2][k][lane]), O::load(&l->window[3][k][lane]),
+                                  O::load(&l->window[4][k][lane]));
+            O::store(&l->estimate[k][lane], median);
+            continue;
+        }
+        v estimate = O::load(&l->estimate[k][lane]);
+        v p = O::add(O::load(&l->variance[k][lane]), O::load(&l->q[k][lane]));
+        v gain = O::div(p, O::add(p, O::set(config->measurementNoise)));
+        O::store(&l->estimate[k][lane], O::add(estimate, O::mul(gain, O::sub(O::load(&l->z[k][lane]), estimate))));
+        O::store(&l->variance[k][lane], O::mul(O::sub(O::set(1.0f), gain), p));
+    }
+    solve<O>(&l->lx[0][lane], &l->ly[0][lane], &l->estimate[0][lane], LOCATOR_LANES, &l->x[lane], &l->y[lane],
+             &l->residual[lane], &l->solved[lane]);
+}
+
+static void scalar_run(const locator_config *config, locator_lanes *lanes, size_t count)
+{
+    for (size_t lane = 0; lane < count; lane++)
+        run_lanes<scalar_ops>(config, lanes, lane);
+}
+
+const locator_kernel *locator_kernel_scalar()
+{
+    static const locator_kernel kernel = {"scalar", scalar_run};
+    return &kernel;
+}
+
+#if defined(__SSE2__)
+static void sse2_run(const locator_config *config, locator_lanes *lanes, size_t /* count */)
+{
+    run_lanes<sse2_ops>(config, lanes, 0);
+}
+
+const locator_kernel *locator_kernel_simd()
+{
+    static const locator_kernel kernel = {"sse2", sse2_run};
+    return &kernel;
+}
+#elif defined(__aarch64__)
+static void neon_run(const locator_config *config, locator_lanes *lanes, size_t /* count */)
+{
+    run_lanes<neon_ops>(config, lanes, 0);
+}
+
+const locator_kernel *locator_kernel_simd()
+{
+    static const locator_kernel kernel = {"neon", neon_run};
+    return &kernel;
+}
+#else
+const locator_kernel *locator_kernel_simd()
+{
+    return NULL;
+}
+#endif
+
+const locator_kernel *locator_kernel_select()
+{
+    const locator_kernel *kernel = locator_kernel_simd();
+    return kernel != NULL ? kernel : locator_kernel_scalar();
+}
+
+int locator_trilaterate(const float *lx, const float *ly, const float *r, float *x, float *y, float *residual)
+{
+    uint32_t solved;
+    solve<scalar_ops>(lx, ly, r, 1, x, y, residual, &solved);
+    return solved != 0 ? 0 : -1;
+}
+
+void locator_config_default(locator_config *config)
+{
+    config->filter = LOCATOR_FILTER_KALMAN;
+    config->processNoise = 400;       // 20 cm per sqrt(s) of walking drift
+    config->measurementNoise = 2500;  // 50 cm per reported distance
+    config->confirmReports = 2;
+}
+
+void locator_engine_init(locator_engine *engine, const locator_config *config)
+{
+    if (config != NULL)
+        engine->config = *config;
+    else
+        locator_config_default(&engine->config);
+    if (engine->config.confirmReports < 1)
+        engine->config.confirmReports = 1;
+    device_table_init(&engine->locatorIndex, 16);
+    engine->locators.clear();
+    device_table_init(&engine->tagIndex, 64);
+    engine->tags.clear();
+}
+
+void locator_engine_place(locator_engine *engine, uint32_t locatorId, float x, float y)
+{
+    int32_t row = device_table_upsert(&engine->locatorIndex, locatorId);
+    if ((size_t)row == engine->locators.size())
+        engine->locators.push_back(locator_point());
+    engine->locators[row].x = x;
+    engine->locators[row].y = y;
+}
+
+int32_t locator_engine_find_tag(const locator_engine *engine, uint32_t tagId)
+{
+    return device_table_find(&engine->tagIndex, tagId);
+}
+
+void locator_engine_end_session(locator_engine *engine, int32_t tag)
+{
+    locator_tag *t = &engine->tags[tag];
+    t->trackCount = 0;
+    t->zone = LOCATOR_ZONE_UNKNOWN;
+    t->pendingZone = LOCATOR_ZONE_UNKNOWN;
+    t->pendingCount = 0;
+    t->hasPosition = 0;
+}
+
+static int32_t tag_row(locator_engine *engine, uint32_t tagId)
+{
+    int32_t row = device_table_upsert(&engine->tagIndex, tagId);
+    if ((size_t)row == engine->tags.size()) {
+        engine->tags.push_back(locator_tag());
+        memset(&engine->tags[row], 0, sizeof(locator_tag));
+        engine->tags[row].tagId = tagId;
+    }
+    return row;
+}
+
+static uint8_t zone_of(uint8_t status)
+{
+    switch (status) {
+        case BEACON_STATUS_INSIDE: return LOCATOR_ZONE_INSIDE;
+        case BEACON_STATUS_OUTSIDE: return LOCATOR_ZONE_OUTSIDE;
+        case BEACON_STATUS_FAILURE: return LOCATOR_ZONE_FAILURE;
+        default: return LOCATOR_ZONE_UNKNOWN;
+    }
+}
+
+// the track of locatorId, a new one replacing the longest unheard when all slots are taken
+static locator_track *track_of(locator_tag *tag, uint32_t locatorId, float z, int64_t timestampNs)
+{
+    // claimed for the report being gathered, so its other locators cannot take the slot
+    for (int i = 0; i < tag->trackCount; i++)
+        if (tag->tracks[i].locatorId == locatorId) {
+            tag->tracks[i].lastReport = (uint32_t)tag->reports;
+            return &tag->tracks[i];
+        }
+    int slot = tag->trackCount;
+    if (slot == LOCATOR_SLOTS) {
+        slot = 0;
+        for (int i = 1; i < LOCATOR_SLOTS; i++)
+            if (tag->tracks[i].lastReport < tag->tracks[slot].lastReport)
+                slot = i;
+    } else {
+        tag->trackCount++;
+    }
+    locator_track *track = &tag->tracks[slot];
+    track->locatorId = locatorId;
+    track->lastNs = timestampNs;
+    track->lastReport = (uint32_t)tag->reports;
+    // a wide prior, so the first distance is taken almost as is; the window starts full of it
+    track->estimate = z;
+    track->variance = 1e8f;
+    for (int i = 0; i < LOCATOR_MEDIAN_WINDOW; i++)
+        track->window[i] = z;
+    track->windowNext = 0;
+    return track;
+}
+
+// a report's place in the lanes between gather and scatter
+struct lane_report {
+    locator_tag *tag;
+    const beacon_report *report;
+    int64_t timestampNs;
+    locator_track *tracks[BEACON_LOCATORS];
+    bool placed;                 // all three locators have a position
+};
+
+static void gather(const locator_engine *engine, lane_report *r, locator_lanes *l, size_t lane)
+{
+    const beacon_report *report = r->report;
+    r->placed = report->locatorCount == BEACON_LOCATORS;
+    for (int k = 0; k < report->locatorCount; k++) {
+        float z = report->distanceCm[k];
+        locator_track *track = track_of(r->tag, report->locatorId[k], z, r->timestampNs);
+        r->tracks[k] = track;
+        track->window[track->windowNext] = z;
+        track->windowNext = (track->windowNext + 1) % LOCATOR_MEDIAN_WINDOW;
+        int64_t elapsed = r->timestampNs > track->lastNs ? r->timestampNs - track->lastNs : 0;
+        l->z[k][lane] = z;
+        l->q[k][lane] = engine->config.processNoise * (float)(elapsed * 1e-9);
+        l->estimate[k][lane] = track->estimate;
+        l->variance[k][lane] = track->variance;
+        for (int w = 0; w < LOCATOR_MEDIAN_WINDOW; w++)
+            l->window[w][k][lane] = track->window[w];
+        int32_t row = device_table_find(&engine->locatorIndex, report->locatorId[k]);
+        if (row < 0) {
+            r->placed = false;
+            continue;
+        }
+        l->lx[k][lane] = engine->locators[row].x;
+        l->ly[k][lane] = engine->locators[row].y;
+    }
+}
+
+static void advance_zone(const locator_engine *engine, locator_tag *tag, uint8_t zone, int64_t timestampNs,
+                         locator_fix *fix, std::vector<locator_transition> *transitions)
+{
+    // no dwell before the first report of a session, the zone is unknown until then
+    if (tag->reports == 0)
+        tag->firstNs = timestampNs;
+    else if (tag->zone != LOCATOR_ZONE_UNKNOWN && timestampNs > tag->lastNs)
+        tag->dwellNs[tag->zone] += timestampNs - tag->lastNs;
+    tag->lastNs = timestampNs;
+    tag->reports++;
+    if (zone == LOCATOR_ZONE_FAILURE)
+        tag->failures++;
+
+    uint8_t previous = tag->zone;
+    if (zone == tag->zone) {
+        tag->pendingCount = 0;
+    } else if (tag->zone == LOCATOR_ZONE_UNKNOWN) {
+        // the first status is taken as is, there is nothing to debounce against
+        tag->zone = zone;
+        tag->zoneSinceNs = timestampNs;
+    } else {
+        if (zone != tag->pendingZone || tag->pendingCount == 0) {
+            tag->pendingZone = zone;
+            tag->pendingCount = 0;
+        }
+        if (++tag->pendingCount >= (uint32_t)engine->config.confirmReports) {
+            tag->zone = zone;
+            tag->zoneSinceNs = timestampNs;
+            tag->pendingCount = 0;
+            tag->transitions++;
+            if (transitions != NULL)
+                transitions->push_back({tag->tagId, previous, zone, timestampNs});
+        }
+    }
+    if (fix != NULL) {
+        fix->zone = tag->zone;
+        fix->previousZone = previous;
+        fix->transition = previous != LOCATOR_ZONE_UNKNOWN && previous != tag->zone;
+    }
+}
+
+// writes the lane back into the tracks, then runs the zone machine; l is NULL for reports
+// without distances
+static void scatter(const locator_engine *engine, const lane_report *r, const locator_lanes *l, size_t lane,
+                    locator_fix *fix, std::vector<locator_transition> *transitions)
+{
+    locator_tag *tag = r->tag;
+    const beacon_report *report = r->report;
+    if (fix != NULL) {
+        memset(fix, 0, sizeof(*fix));
+        fix->timestampNs = r->timestampNs;
+        fix->tagId = tag->tagId;
+    }
+    if (l != NULL) {
+        for (int k = 0; k < report->locatorCount; k++) {
+            locator_track *track = r->tracks[k];
+            track->estimate = l->estimate[k][lane];
+            track->variance = l->variance[k][lane];
+            track->lastNs = r->timestampNs;
+            track->lastReport = (uint32_t)tag->reports;
+            if (fix != NULL)
+                fix->distanceCm[k] = track->estimate;
+        }
+        if (r->placed && l->solved[lane] != 0) {
+            tag->x = l->x[lane];
+            tag->y = l->y[lane];
+            tag->residualCm = l->residual[lane];
+            tag->hasPosition = 1;
+            tag->fixes++;
+            if (fix != NULL) {
+                fix->x = tag->x;
+                fix->y = tag->y;
+                fix->residualCm = tag->residualCm;
+                fix->hasPosition = 1;
+            }
+        }
+    }
+    advance_zone(engine, tag, zone_of(report->status), r->timestampNs, fix, transitions);
+}
+
+int32_t locator_engine_update(locator_engine *engine, const beacon_report *report, int64_t timestampNs,
+                              locator_fix *fix)
+{
+    if (zone_of(report->status) == LOCATOR_ZONE_UNKNOWN)
+        return -1;
+    int32_t row = tag_row(engine, report->tagId);
+    lane_report r = {&engine->tags[row], report, timestampNs, {NULL}, false};
+    if (report->status == BEACON_STATUS_FAILURE || report->locatorCount == 0) {
+        scatter(engine, &r, NULL, 0, fix, NULL);
+    } else {
+        locator_lanes lanes;
+        memset(&lanes, 0, sizeof(lanes));
+        gather(engine, &r, &lanes, 0);
+        locator_kernel_scalar()->run(&engine->config, &lanes, 1);
+        scatter(engine, &r, &lanes, 0, fix, NULL);
+    }
+    if (fix != NULL)
+        fix->tag = row;
+    return row;
+}
+
+// a tag of the store being replayed in one lane
+struct replay_cursor {
+    int32_t row;                 // engine row, -1 when the lane has no tag left
+    int32_t storeTag;
+    size_t next, count;
+    beacon_report report;
+};
+
+size_t locator_engine_replay(locator_engine *engine, const log_store *store, const locator_kernel *kernel,
+                             std::vector<locator_transition> *transitions)
+{
+    if (kernel == NULL)
+        kernel = locator_kernel_select();
+    // every row is added up front, the lanes point into engine->tags
+    size_t tagCount = log_store_tag_count(store);
+    std::vector<int32_t> rows(tagCount);
+    for (size_t t = 0; t < tagCount; t++)
+        rows[t] = tag_row(engine, store->tags[t].tagId);
+    size_t nextTag = 0, fed = 0;
+    replay_cursor cursors[LOCATOR_LANES];
+    for (int i = 0; i < LOCATOR_LANES; i++)
+        cursors[i].row = -1;
+    locator_lanes lanes;
+    memset(&lanes, 0, sizeof(lanes));
+    lane_report pending[LOCATOR_LANES];
+
+    for (;;) {
+        // one report with distances per lane, each lane on its own tag; reports without
+        // distances in between are applied on the spot, in order with the tag's others
+        size_t used = 0;
+        for (int i = 0; i < LOCATOR_LANES; i++) {
+            replay_cursor &c = cursors[i];
+            for (;;) {
+                if (c.row < 0 || c.next == c.count) {
+                    if (nextTag == tagCount) {
+                        c.row = -1;
+                        break;
+                    }
+                    c.storeTag = (int32_t)nextTag++;
+                    c.row = rows[c.storeTag];
+                    c.next = 0;
+                    c.count = log_store_record_count(store, c.storeTag);
+                    continue;
+                }
+                const log_record *record = log_store_record(store, c.storeTag, c.next++);
+                if (beacon_parse(record->payload, record->length, &c.report) != 0)
+                    continue;
+                fed++;
+                lane_report r = {&engine->tags[c.row], &c.report, record->timestampNs, {NULL}, false};
+                if (c.report.status == BEACON_STATUS_FAILURE || c.report.locatorCount == 0) {
+                    scatter(engine, &r, NULL, 0, NULL, transitions);
+                    continue;
+                }
+                pending[used] = r;
+                gather(engine, &pending[used], &lanes, used);
+                used++;
+                break;
+            }
+        }
+        if (used == 0)
+            break;
+        kernel->run(&engine->config, &lanes, used);
+        for (size_t lane = 0; lane < used; lane++)
+            scatter(engine, &pending[lane], &lanes, lane, NULL, transitions);
+    }
+    return fed;
+}
@@ -0,0 +1,151 @@
+#ifndef LOCATOR_ENGINE_H
+#define LOCATOR_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "beacon-parser.h"
+#include "device-table.h"
+#include "log-store.h"
+
+// streaming position and zone tracking from locator beacon reports
+// per tag the distance to each locator it reports is smoothed (a scalar Kalman filter or the
+// median of the last LOCATOR_MEDIAN_WINDOW reports); a 04/05 report naming three placed
+// locators is trilaterated from the smoothed distances, and the 04/05/06 statuses drive a
+// debounced zone state machine. Distances and positions are in cm. Not thread-safe.
+// Each update runs in three steps: a scalar gather of the filter state into lanes, a kernel
+// over the lanes (filter and solver) and a scalar scatter with the zone machine. A live update
+// is one lane; replaying a log store fills the lanes with reports of different tags.
+
+#define LOCATOR_SLOTS 8          // locators followed per tag, the longest unheard is replaced
+#define LOCATOR_MEDIAN_WINDOW 5
+#define LOCATOR_LANES 4
+
+enum locator_filter {
+    LOCATOR_FILTER_KALMAN,
+    LOCATOR_FILTER_MEDIAN
+};
+
+enum locator_zone {
+    LOCATOR_ZONE_UNKNOWN,
+    LOCATOR_ZONE_INSIDE,         // status 04
+    LOCATOR_ZONE_OUTSIDE,        // status 05
+    LOCATOR_ZONE_FAILURE,        // status 06
+    LOCATOR_ZONES
+};
+
+struct locator_config {
+    int filter;
+    float processNoise;          // Kalman: cm^2 of drift per second
+    float measurementNoise;      // Kalman: cm^2 of a single reported distance
+    int confirmReports;          // consecutive reports of a new status before the zone changes
+};
+
+struct locator_track {
+    uint32_t locatorId;
+    uint32_t lastReport;         // tag report counter when last heard
+    int64_t lastNs;
+    float estimate;              // smoothed distance
+    float variance;
+    float window[LOCATOR_MEDIAN_WINDOW];
+    uint8_t windowNext;
+};
+
+struct locator_tag {
+    uint32_t tagId;
+    uint8_t trackCount;
+    uint8_t zone;
+    uint8_t pendingZone;
+    uint8_t hasPosition;
+    uint32_t pendingCount;
+    locator_track tracks[LOCATOR_SLOTS];
+    float x, y;                  // last trilaterated position
+    float residualCm;            // rms distance misfit of that position
+    int64_t firstNs, lastNs;
+    int64_t zoneSinceNs;
+    int64_t dwellNs[LOCATOR_ZONES];
+    uint64_t reports;
+    uint64_t fixes;
+    uint64_t failures;
+    uint64_t transitions;
+};
+
+struct locator_point {
+    float x, y;
+};
+
+struct locator_engine {
+    locator_config config;
+    device_table locatorIndex;   // locator id -> row of locators
+    std::vector<locator_point> locators;
+    device_table tagIndex;       // tag id -> row of tags
+    std::vector<locator_tag> tags;
+};
+
+// result of one report, written as-is into the caller's direct ByteBuffer (native byte order)
+struct locator_fix {
+    int64_t timestampNs;
+    uint32_t tagId;
+    int32_t tag;                 // row in the engine
+    float distanceCm[BEACON_LOCATORS]; // smoothed, in report order, 0 when absent
+    float x, y;
+    float residualCm;
+    uint8_t hasPosition;
+    uint8_t zone;
+    uint8_t previousZone;
+    uint8_t transition;          // the zone changed with this report
+};
+#define LOCATOR_FIX_SIZE 48
+
+struct locator_transition {
+    uint32_t tagId;
+    uint8_t from, to;
+    int64_t timestampNs;
+};
+
+// one report per lane, structure of arrays so the kernels run across tags
+struct locator_lanes {
+    float z[BEACON_LOCATORS][LOCATOR_LANES];        // reported distance
+    float q[BEACON_LOCATORS][LOCATOR_LANES];        // process noise since the track was last heard
+    float estimate[BEACON_LOCATORS][LOCATOR_LANES]; // filter state in and out
+    float variance[BEACON_LOCATORS][LOCATOR_LANES];
+    float window[LOCATOR_MEDIAN_WINDOW][BEACON_LOCATORS][LOCATOR_LANES]; // z already inserted
+    float lx[BEACON_LOCATORS][LOCATOR_LANES];       // locator positions
+    float ly[BEACON_LOCATORS][LOCATOR_LANES];
+    float x[LOCATOR_LANES], y[LOCATOR_LANES], residual[LOCATOR_LANES];
+    uint32_t solved[LOCATOR_LANES];                 // out: nonzero when x and y are valid
+};
+
+// filter and solve lanes [0, count); a vector kernel computes all LOCATOR_LANES, the ones
+// past count hold finite leftovers and are ignored
+struct locator_kernel {
+    const char *name;
+    void (*run)(const locator_config *config, locator_lanes *lanes, size_t count);
+};
+
+// the SIMD kernel returns NULL when not built for this CPU (SSE2 on x86, NEON on arm64)
+const locator_kernel *locator_kernel_scalar();
+const locator_kernel *locator_kernel_simd();
+const locator_kernel *locator_kernel_select();
+
+void locator_config_default(locator_config *config);
+void locator_engine_init(locator_engine *engine, const locator_config *config);
+// position of a locator in cm, placing it again moves it
+void locator_engine_place(locator_engine *engine, uint32_t locatorId, float x, float y);
+// feeds one decoded report; fix may be NULL. Returns the tag's row
+int32_t locator_engine_update(locator_engine *engine, const beacon_report *report, int64_t timestampNs,
+                              locator_fix *fix);
+int32_t locator_engine_find_tag(const locator_engine *engine, uint32_t tagId);
+// forgets the tracks, position and zone of tag (a row) when its session ended, keeping the
+// counters and dwell; the next report starts over as the first one, with no dwell before it
+void locator_engine_end_session(locator_engine *engine, int32_t tag);
+// replays every record of store, tag by tag in LOCATOR_LANES parallel lanes; the result is the
+// same as updating each tag's records in order. kernel NULL selects one; zone changes are
+// appended to transitions when given. Returns the number of reports fed
+size_t locator_engine_replay(locator_engine *engine, const log_store *store, const locator_kernel *kernel,
+                             std::vector<locator_transition> *transitions);
+
+// position from three circles, -1 when the locators are (nearly) collinear
+int locator_trilaterate(const float *lx, const float *ly, const float *r, float *x, float *y, float *residual);
+
+#endif //LOCATOR_ENGINE_H
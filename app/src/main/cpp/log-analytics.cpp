@@ -0,0 +1,207 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <thread>
+#include "log-analytics.h"
+
+int log_capture_open(log_capture *capture, const char *path)
+{
+    memset(capture, 0, sizeof(*capture));
+    capture->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (capture->fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(capture->fd, &st) != 0 || (size_t)st.st_size < LOG_EXPORT_HEADER_SIZE) {
+        log_capture_close(capture);
+        return -1;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, capture->fd, 0);
+    if (data == MAP_FAILED) {
+        log_capture_close(capture);
+        return -1;
+    }
+    capture->data = static_cast<const unsigned char *>(data);
+    capture->size = st.st_size;
+    const log_export_header *header = reinterpret_cast<const log_export_header *>(capture->data);
+    if (memcmp(header->magic, LOG_EXPORT_MAGIC, 4) != 0 || header->version != LOG_EXPORT_VERSION ||
+        header->recordSize != LOG_EXPORT_RECORD_SIZE) {
+        log_capture_close(capture);
+        return -1;
+    }
+    // a capture cut short loses only its partial last record
+    capture->records = reinterpret_cast<const log_export_record *>(capture->data + LOG_EXPORT_HEADER_SIZE);
+    capture->count = (capture->size - LOG_EXPORT_HEADER_SIZE) / LOG_EXPORT_RECORD_SIZE;
+    return 0;
+}
+
+void log_capture_close(log_capture *capture)
+{
+    if (capture->data != NULL)
+        munmap(const_cast<unsigned char *>(capture->data), capture->size);
+    if (capture->fd >= 0)
+        close(capture->fd);
+    capture->fd = -1;
+    capture->data = NULL;
+    capture->records = NULL;
+    capture->count = 0;
+}
+
+struct tag_work {
+    log_tag_summary summary;
+    size_t session;                // of the latest record
+    uint32_t errorCodes[256];
+    std::vector<int8_t> rssi;
+    std::vector<uint16_t> distances;
+};
+
+typedef std::vector<const log_export_record *> bucket;
+
+static unsigned int owner_of(uint32_t tagId, unsigned int owners)
+{
+    return (unsigned int)(((uint64_t)(uint32_t)(tagId * 2654435761u) * owners) >> 32);
+}
+
+// nearest rank percentiles, values is reordered
+template <typename T>
+static void percentiles(std::vector<T> &values, float *out)
+{
+    static const double ranks[LOG_PERCENTILES] = {0.05, 0.5, 0.95};
+    for (int i = 0; i < LOG_PERCENTILES; i++) {
+        if (values.empty()) {
+            out[i] = 0;
+            continue;
+        }
+        size_t k = (size_t)(ranks[i] * (values.size() - 1) + 0.5);
+        std::nth_element(values.begin(), values.begin() + k, values.end());
+        out[i] = values[k];
+    }
+}
+
+// phase 1: records [begin, end) of the concatenated captures into one bucket per owner
+static void partition(const log_capture *captures, size_t count, size_t begin, size_t end, bucket *owners,
+                      unsigned int ownerCount)
+{
+    size_t base = 0;
+    for (size_t c = 0; c < count && begin < end; base += captures[c].count, c++) {
+        if (begin >= base + captures[c].count)
+            continue;
+        // NULL in every bucket marks where the next capture, a new session, starts
+        if (c > 0 && begin == base)
+            for (unsigned int o = 0; o < ownerCount; o++)
+                owners[o].push_back(NULL);
+        size_t stop = std::min(end, base + captures[c].count);
+        for (const log_export_record *r = captures[c].records + (begin - base); begin < stop; begin++, r++)
+            owners[owner_of(r->tagId, ownerCount)].push_back(r);
+    }
+}
+
+// phase 2: every tag of one owner, records taken slice by slice to keep file order
+static void summarise(const std::vector<std::vector<bucket>> &slices, unsigned int owner,
+                      const locator_config *config, std::vector<log_tag_summary> *out)
+{
+    size_t session = 0;
+    device_table index;
+    device_table_init(&index, 256);
+    std::vector<tag_work> tags;
+    locator_engine engine;
+    locator_engine_init(&engine, config);
+    beacon_report report;
+    for (const std::vector<bucket> &slice : slices) {
+        for (const log_export_record *r : slice[owner]) {
+            if (r == NULL) {
+                session++;
+                continue;
+            }
+            int32_t row = device_table_upsert(&index, r->tagId);
+            if ((size_t)row == tags.size()) {
+                tags.emplace_back();
+                memset(&tags[row].summary, 0, sizeof(tags[row].summary));
+                memset(tags[row].errorCodes, 0, sizeof(tags[row].errorCodes));
+                tags[row].summary.tagId = r->tagId;
+                tags[row].summary.firstNs = r->record.timestampNs;
+                tags[row].session = session;
+            }
+            tag_work &tag = tags[row];
+            // timestamps of another session do not follow on, its zones start over
+            if (tag.session != session) {
+                tag.session = session;
+                int32_t state = locator_engine_find_tag(&engine, r->tagId);
+                if (state >= 0)
+                    locator_engine_end_session(&engine, state);
+            }
+            tag.summary.records++;
+            tag.summary.lastNs = r->record.timestampNs;
+            tag.rssi.push_back(r->record.rssi);
+            size_t length = std::min<size_t>(r->record.length, LOG_PAYLOAD_MAX);
+            if (beacon_parse(r->record.payload, length, &report) != 0)
+                continue;
+            tag.summary.reports++;
+            if (report.status == BEACON_STATUS_FAILURE) {
+                tag.summary.failures++;
+                tag.summary.failureCount += report.failureCount;
+                tag.errorCodes[report.errorCode]++;
+            }
+            for (int i = 0; i < report.locatorCount; i++)
+                tag.distances.push_back(report.distanceCm[i]);
+            // the device keys zones by the id inside the report, the export by the stored one
+            report.tagId = r->tagId;
+            locator_engine_update(&engine, &report, r->record.timestampNs, NULL);
+        }
+    }
+    for (tag_work &tag : tags) {
+        log_tag_summary &s = tag.summary;
+        int32_t row = locator_engine_find_tag(&engine, s.tagId);
+        if (row >= 0) {
+            const locator_tag &state = engine.tags[row];
+            s.transitions = state.transitions;
+            s.zone = state.zone;
+            memcpy(s.dwellNs, state.dwellNs, sizeof(s.dwellNs));
+        }
+        for (int code = 0; code < 256; code++) {
+            if (tag.errorCodes[code] > s.topErrorReports) {
+                s.topErrorCode = (uint8_t)code;
+                s.topErrorReports = tag.errorCodes[code];
+            }
+        }
+        percentiles(tag.rssi, s.rssi);
+        percentiles(tag.distances, s.distanceCm);
+        out->push_back(s);
+    }
+}
+
+size_t log_analyze(const log_capture *captures, size_t count, unsigned int threads, const locator_config *config,
+                   std::vector<log_tag_summary> *summaries)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+    size_t total = 0;
+    for (size_t c = 0; c < count; c++)
+        total += captures[c].count;
+
+    std::vector<std::vector<bucket>> slices(threads, std::vector<bucket>(threads));
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < threads; t++)
+        workers.emplace_back(partition, captures, count, total * t / threads, total * (t + 1) / threads,
+                             slices[t].data(), threads);
+    for (std::thread &worker : workers)
+        worker.join();
+    workers.clear();
+
+    std::vector<std::vector<log_tag_summary>> results(threads);
+    for (unsigned int t = 0; t < threads; t++)
+        workers.emplace_back(summarise, std::cref(slices), t, config, &results[t]);
+    for (std::thread &worker : workers)
+        worker.join();
+
+    summaries->clear();
+    for (const std::vector<log_tag_summary> &result : results)
+        summaries->insert(summaries->end(), result.begin(), result.end());
+    std::sort(summaries->begin(), summaries->end(),
+              [](const log_tag_summary &a, const log_tag_summary &b) { return a.tagId < b.tagId; });
+    return total;
+}
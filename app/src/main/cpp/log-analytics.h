@@ -0,0 +1,54 @@
+#ifndef LOG_ANALYTICS_H
+#define LOG_ANALYTICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "locator-engine.h"
+#include "log-store.h"
+
+// per-tag statistics over exported scan logs (log_store_export), decoded with the app's beacon
+// parser and run through the same locator engine, so zones and dwell match what the device
+// computes. Captures are memory-mapped and read in place. Records are partitioned by tag over
+// worker threads: each thread first buckets a contiguous slice of the records by owner
+// (a hash of the tag id), then every owner walks its buckets slice by slice, so each tag is
+// handled by one thread and still sees its records in file order. Each capture is a session
+// of its own: elapsed-realtime timestamps do not carry over, so a tag's zone starts over and
+// no dwell is counted across the gap.
+
+#define LOG_PERCENTILES 3          // p5, p50, p95
+
+struct log_capture {
+    int fd;
+    const unsigned char *data;
+    size_t size;
+    const log_export_record *records;
+    size_t count;
+};
+
+// maps path read-only and checks the header; returns 0 or -1
+int log_capture_open(log_capture *capture, const char *path);
+void log_capture_close(log_capture *capture);
+
+struct log_tag_summary {
+    uint32_t tagId;
+    uint64_t records;              // everything stored for the tag
+    uint64_t reports;              // locator beacon reports among them
+    uint64_t failures;             // status 06 reports
+    uint64_t failureCount;         // sum of their failure counters
+    uint8_t topErrorCode;          // most frequent error code of the failures
+    uint64_t topErrorReports;
+    uint64_t transitions;          // zone changes, debounced as on the device
+    uint8_t zone;                  // zone at the end of the capture
+    int64_t firstNs, lastNs;
+    int64_t dwellNs[LOCATOR_ZONES];
+    float rssi[LOG_PERCENTILES];        // dBm over every record
+    float distanceCm[LOG_PERCENTILES];  // raw reported distances, every locator
+};
+
+// threads 0 uses one per core; config NULL uses the device defaults. Summaries are sorted by
+// tag id. Returns the number of records read
+size_t log_analyze(const log_capture *captures, size_t count, unsigned int threads, const locator_config *config,
+                   std::vector<log_tag_summary> *summaries);
+
+#endif //LOG_ANALYTICS_H
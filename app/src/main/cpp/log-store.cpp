@@ -0,0 +1,249 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "log-store.h"
+
+static_assert(sizeof(log_record) == LOG_RECORD_SIZE, "log_record layout is shared with Kotlin");
+static_assert(sizeof(log_export_header) == LOG_EXPORT_HEADER_SIZE, "export layout is read by host tools");
+static_assert(sizeof(log_export_record) == LOG_EXPORT_RECORD_SIZE, "export layout is read by host tools");
+
+int log_store_open(log_store *store, size_t memoryCap, const char *spillPath)
+{
+    store->arenaPages = memoryCap / LOG_PAGE_SIZE;
+    store->arena = NULL;
+    store->spillFd = -1;
+    store->spill = NULL;
+    store->spillPages = 0;
+    store->spillCapacity = 0;
+    store->rejected = 0;
+    store->tags.clear();
+    store->fullPages.clear();
+    device_table_init(&store->tagIndex, 64);
+    if (store->arenaPages < 2)
+        return -1;
+    void *arena = mmap(NULL, store->arenaPages * LOG_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                       -1, 0);
+    if (arena == MAP_FAILED)
+        return -1;
+    store->arena = static_cast<unsigned char *>(arena);
+    // handed out from the back, so page 0 goes first
+    store->freePages.resize(store->arenaPages);
+    for (size_t i = 0; i < store->arenaPages; i++)
+        store->freePages[i] = (uint32_t)(store->arenaPages - 1 - i);
+    if (spillPath != NULL) {
+        store->spillFd = open(spillPath, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (store->spillFd < 0) {
+            log_store_close(store);
+            return -1;
+        }
+        unlink(spillPath);
+    }
+    return 0;
+}
+
+void log_store_close(log_store *store)
+{
+    if (store->arena != NULL)
+        munmap(store->arena, store->arenaPages * LOG_PAGE_SIZE);
+    if (store->spill != NULL)
+        munmap(store->spill, store->spillCapacity * LOG_PAGE_SIZE);
+    if (store->spillFd >= 0)
+        close(store->spillFd);
+    store->arena = NULL;
+    store->spill = NULL;
+    store->spillFd = -1;
+    store->spillPages = 0;
+    store->spillCapacity = 0;
+    store->freePages.clear();
+    store->fullPages.clear();
+    store->tags.clear();
+    device_table_clear(&store->tagIndex);
+}
+
+static inline unsigned char *page_data(const log_store *store, log_page_ref ref)
+{
+    return (ref.onDisk ? store->spill : store->arena) + (size_t)ref.index * LOG_PAGE_SIZE;
+}
+
+// grows the spill mapping by doubling; returns the next free spill page or -1
+static int64_t spill_page(log_store *store)
+{
+    if (store->spillPages == store->spillCapacity) {
+        size_t capacity = store->spillCapacity == 0 ? 256 : 2 * store->spillCapacity;
+        if (ftruncate(store->spillFd, (off_t)(capacity * LOG_PAGE_SIZE)) != 0)
+            return -1;
+        void *mapping = mmap(NULL, capacity * LOG_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, store->spillFd, 0);
+        if (mapping == MAP_FAILED)
+            return -1;
+        if (store->spill != NULL)
+            munmap(store->spill, store->spillCapacity * LOG_PAGE_SIZE);
+        store->spill = static_cast<unsigned char *>(mapping);
+        store->spillCapacity = capacity;
+    }
+    return (int64_t)store->spillPages++;
+}
+
+// frees the oldest full arena page, spilling or dropping it; returns the page or -1
+static int64_t evict_page(log_store *store)
+{
+    if (store->fullPages.empty())
+        return -1;
+    uint64_t entry = store->fullPages.front();
+    store->fullPages.pop_front();
+    log_tag &tag = store->tags[entry >> 32];
+    uint32_t page = (uint32_t)entry;
+    // the oldest full arena page of a tag is its first arena page
+    size_t position = tag.spilled;
+    int64_t diskPage = store->spillFd >= 0 ? spill_page(store) : -1;
+    if (diskPage >= 0) {
+        memcpy(store->spill + diskPage * LOG_PAGE_SIZE, store->arena + (size_t)page * LOG_PAGE_SIZE, LOG_PAGE_SIZE);
+        tag.pages[position].index = (uint32_t)diskPage;
+        tag.pages[position].onDisk = 1;
+        tag.spilled++;
+    } else {
+        // the page goes; it is the tag's oldest only when nothing of the tag made it to disk
+        size_t lost = LOG_RECORDS_PER_PAGE - (position == 0 ? tag.first : 0);
+        tag.pages.erase(tag.pages.begin() + position);
+        if (position == 0)
+            tag.first = 0;
+        tag.count -= lost;
+        tag.dropped += lost;
+    }
+    return page;
+}
+
+int32_t log_store_append(log_store *store, uint32_t tagId, int64_t timestampNs, int rssi,
+                         const unsigned char *payload, size_t length)
+{
+    if (store->arena == NULL)
+        return -1;
+    int32_t row = device_table_upsert(&store->tagIndex, tagId);
+    if ((size_t)row == store->tags.size()) {
+        store->tags.emplace_back();
+        store->tags.back().tagId = tagId;
+        store->tags.back().first = 0;
+        store->tags.back().count = 0;
+        store->tags.back().spilled = 0;
+        store->tags.back().dropped = 0;
+    }
+    log_tag &tag = store->tags[row];
+    size_t slot = (tag.first + tag.count) % LOG_RECORDS_PER_PAGE;
+    if (slot == 0) {
+        int64_t page;
+        if (!store->freePages.empty()) {
+            page = store->freePages.back();
+            store->freePages.pop_back();
+        } else if ((page = evict_page(store)) < 0) {
+            store->rejected++;
+            return -1;
+        }
+        tag.pages.push_back({(uint32_t)page, 0});
+    }
+    log_record *record = reinterpret_cast<log_record *>(page_data(store, tag.pages.back()) + slot * LOG_RECORD_SIZE);
+    if (length > LOG_PAYLOAD_MAX)
+        length = LOG_PAYLOAD_MAX;
+    record->timestampNs = timestampNs;
+    record->rssi = (int8_t)rssi;
+    record->length = (uint8_t)length;
+    if (length > 0)
+        memcpy(record->payload, payload, length);
+    memset(record->payload + length, 0, LOG_PAYLOAD_MAX - length);
+    tag.count++;
+    if (slot == LOG_RECORDS_PER_PAGE - 1)
+        store->fullPages.push_back((uint64_t)row << 32 | tag.pages.back().index);
+    return row;
+}
+
+int32_t log_store_find_tag(const log_store *store, uint32_t tagId)
+{
+    return device_table_find(&store->tagIndex, tagId);
+}
+
+size_t log_store_tag_count(const log_store *store)
+{
+    return store->tags.size();
+}
+
+size_t log_store_record_count(const log_store *store, int32_t tag)
+{
+    if (tag < 0 || (size_t)tag >= store->tags.size())
+        return 0;
+    return store->tags[tag].count;
+}
+
+const log_record *log_store_record(const log_store *store, int32_t tag, size_t index)
+{
+    if (index >= log_store_record_count(store, tag))
+        return NULL;
+    const log_tag &entry = store->tags[tag];
+    size_t position = entry.first + index;
+    return reinterpret_cast<const log_record *>(page_data(store, entry.pages[position / LOG_RECORDS_PER_PAGE]) +
+                                                (position % LOG_RECORDS_PER_PAGE) * LOG_RECORD_SIZE);
+}
+
+size_t log_store_read(const log_store *store, int32_t tag, size_t index, size_t count, log_record *out)
+{
+    size_t total = log_store_record_count(store, tag);
+    if (index >= total)
+        return 0;
+    if (count > total - index)
+        count = total - index;
+    // whole runs within a page are contiguous
+    size_t copied = 0;
+    while (copied < count) {
+        const log_record *first = log_store_record(store, tag, index + copied);
+        size_t slot = (store->tags[tag].first + index + copied) % LOG_RECORDS_PER_PAGE;
+        size_t run = LOG_RECORDS_PER_PAGE - slot < count - copied ? LOG_RECORDS_PER_PAGE - slot : count - copied;
+        memcpy(out + copied, first, run * LOG_RECORD_SIZE);
+        copied += run;
+    }
+    return count;
+}
+
+static int write_all(int fd, const void *data, size_t length)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    while (length > 0) {
+        ssize_t written = write(fd, p, length);
+        if (written < 0)
+            return -1;
+        p += written;
+        length -= written;
+    }
+    return 0;
+}
+
+int64_t log_store_export(const log_store *store, const char *path)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return -1;
+    log_export_header header;
+    memcpy(header.magic, LOG_EXPORT_MAGIC, 4);
+    header.version = LOG_EXPORT_VERSION;
+    header.recordSize = LOG_EXPORT_RECORD_SIZE;
+    header.reserved = 0;
+    int64_t exported = 0;
+    int result = write_all(fd, &header, sizeof(header));
+    // a page worth of records per write
+    log_record records[LOG_RECORDS_PER_PAGE];
+    log_export_record out[LOG_RECORDS_PER_PAGE];
+    for (size_t tag = 0; tag < store->tags.size() && result == 0; tag++) {
+        size_t count = store->tags[tag].count;
+        for (size_t index = 0; index < count && result == 0;) {
+            size_t read = log_store_read(store, (int32_t)tag, index, LOG_RECORDS_PER_PAGE, records);
+            for (size_t i = 0; i < read; i++) {
+                out[i].tagId = store->tags[tag].tagId;
+                out[i].reserved = 0;
+                out[i].record = records[i];
+            }
+            result = write_all(fd, out, read * sizeof(out[0]));
+            index += read;
+            exported += read;
+        }
+    }
+    if (close(fd) != 0 || result != 0)
+        return -1;
+    return exported;
+}
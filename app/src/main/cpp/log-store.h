@@ -0,0 +1,97 @@
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include "device-table.h"
+
+// per-tag scan history as fixed-size binary records
+// records live in pages of a capped in-memory arena; each tag fills its own page and a full
+// page joins a global FIFO. When the arena is out of pages the oldest full page is moved to
+// a memory-mapped spill file (when one was given) or dropped, so memory stays under the cap
+// while the newest history is always in RAM. Not thread-safe: callers serialize.
+
+#define LOG_PAYLOAD_MAX 62 // a legacy scan record
+#define LOG_RECORDS_PER_PAGE 16
+
+struct log_record {
+    int64_t timestampNs;   // monotonic (elapsed realtime) receive time
+    int8_t rssi;
+    uint8_t length;        // bytes of payload used
+    uint8_t payload[LOG_PAYLOAD_MAX];
+};
+#define LOG_RECORD_SIZE 72
+#define LOG_PAGE_SIZE (LOG_RECORD_SIZE * LOG_RECORDS_PER_PAGE)
+
+struct log_page_ref {
+    uint32_t index;        // arena page or spill file page
+    uint32_t onDisk;
+};
+
+struct log_tag {
+    uint32_t tagId;
+    std::deque<log_page_ref> pages; // oldest first, spilled pages before arena pages
+    size_t first;          // slot of the oldest kept record in pages.front()
+    size_t count;          // records kept
+    size_t spilled;        // leading pages that are in the spill file
+    uint64_t dropped;      // records lost to the cap, without a spill file or once it is full
+};
+
+struct log_store {
+    unsigned char *arena;
+    size_t arenaPages;
+    std::vector<uint32_t> freePages;
+    std::deque<uint64_t> fullPages; // (tag row << 32 | arena page), oldest first
+    device_table tagIndex;          // tag id -> row of tags
+    std::vector<log_tag> tags;
+    int spillFd;
+    unsigned char *spill;
+    size_t spillPages;              // pages written
+    size_t spillCapacity;           // pages mapped
+    uint64_t rejected;              // appends lost because every page was partly filled
+};
+
+// memoryCap is rounded down to whole pages and must hold at least two; spillPath may be NULL
+// to drop old pages instead. The spill file is unlinked once open, it only lives with the store
+// returns 0 or -1
+int log_store_open(log_store *store, size_t memoryCap, const char *spillPath);
+void log_store_close(log_store *store);
+// returns the tag's row or -1 when the record could not be stored; payload beyond
+// LOG_PAYLOAD_MAX is cut
+int32_t log_store_append(log_store *store, uint32_t tagId, int64_t timestampNs, int rssi,
+                         const unsigned char *payload, size_t length);
+int32_t log_store_find_tag(const log_store *store, uint32_t tagId);
+size_t log_store_tag_count(const log_store *store);
+size_t log_store_record_count(const log_store *store, int32_t tag);
+// record index of tag, 0 being the oldest kept; valid until the next append
+const log_record *log_store_record(const log_store *store, int32_t tag, size_t index);
+// copies up to count records starting at index into out for paging; returns the number copied
+size_t log_store_read(const log_store *store, int32_t tag, size_t index, size_t count, log_record *out);
+
+// export file for offline analysis (host/log-replay): a header, then every kept record tag by
+// tag, oldest first, each behind its tag id; fixed-size and in the device's (little endian)
+// byte order so the file can be memory-mapped and read in place
+#define LOG_EXPORT_MAGIC "BTLG"
+#define LOG_EXPORT_VERSION 1
+
+struct log_export_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;   // LOG_EXPORT_RECORD_SIZE
+    uint32_t reserved;
+};
+#define LOG_EXPORT_HEADER_SIZE 16
+
+struct log_export_record {
+    uint32_t tagId;
+    uint32_t reserved;
+    log_record record;
+};
+#define LOG_EXPORT_RECORD_SIZE 80
+
+// writes the whole store to path, replacing it; returns the number of records or -1
+int64_t log_store_export(const log_store *store, const char *path);
+
+#endif //LOG_STORE_H
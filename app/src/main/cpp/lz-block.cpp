@@ -0,0 +1,240 @@
+#include <string.h>
+#include "lz-block.h"
+
+#define LZ_MIN_MATCH 4
+// the format leaves the last 5 bytes as literals and starts no match in the last 12
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_FIND_LIMIT 12
+#define LZ_HASH_BITS 12
+// after 64 misses in a row the search starts skipping ahead, incompressible data stays cheap
+#define LZ_SKIP_TRIGGER 6
+
+static const unsigned char streamMagic[4] = {'O', 'T', 'A', 'Z'};
+
+static inline uint32_t read32(const unsigned char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t lz_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static unsigned char *write_length(unsigned char *op, size_t length)
+{
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+// matchLength 0 writes the closing literal-only sequence
+static unsigned char *write_sequence(unsigned char *op, const unsigned char *literals, size_t literalLength,
+                                     size_t offset, size_t matchLength)
+{
+    unsigned char *token = op++;
+    *token = (unsigned char)((literalLength < 15 ? literalLength : 15) << 4);
+    if (literalLength >= 15)
+        op = write_length(op, literalLength - 15);
+    if (literalLength > 0)
+        memcpy(op, literals, literalLength);
+    op += literalLength;
+    if (matchLength == 0)
+        return op;
+    *op++ = (unsigned char)offset;
+    *op++ = (unsigned char)(offset >> 8);
+    matchLength -= LZ_MIN_MATCH;
+    *token |= (unsigned char)(matchLength < 15 ? matchLength : 15);
+    if (matchLength >= 15)
+        op = write_length(op, matchLength - 15);
+    return op;
+}
+
+size_t lz_block_bound(size_t length)
+{
+    return length + length / 255 + 16;
+}
+
+size_t lz_compress_block(const unsigned char *in, size_t length, unsigned char *out)
+{
+    // positions are stored + 1 so 0 means empty; blocks are small enough for 16 bits
+    uint16_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+    unsigned char *op = out;
+    size_t anchor = 0;
+    if (length > LZ_MATCH_FIND_LIMIT) {
+        const size_t matchLimit = length - LZ_LAST_LITERALS;
+        const size_t searchLimit = length - LZ_MATCH_FIND_LIMIT;
+        size_t pos = 0;
+        while (pos <= searchLimit) {
+            uint32_t sequence = read32(in + pos);
+            uint32_t h = lz_hash(sequence);
+            size_t candidate = table[h];
+            table[h] = (uint16_t)(pos + 1);
+            if (candidate == 0 || read32(in + candidate - 1) != sequence) {
+                pos += 1 + ((pos - anchor) >> LZ_SKIP_TRIGGER);
+                continue;
+            }
+            candidate--;
+            while (pos > anchor && candidate > 0 && in[pos - 1] == in[candidate - 1]) {
+                pos--;
+                candidate--;
+            }
+            size_t matchEnd = pos + LZ_MIN_MATCH;
+            while (matchEnd < matchLimit && in[matchEnd] == in[candidate + matchEnd - pos])
+                matchEnd++;
+            op = write_sequence(op, in + anchor, pos - anchor, pos - candidate, matchEnd - pos);
+            pos = anchor = matchEnd;
+        }
+    }
+    op = write_sequence(op, in + anchor, length - anchor, 0, 0);
+    return op - out;
+}
+
+// reads the 255-continued length bytes; returns false when the input runs out
+static bool read_length(const unsigned char **ip, const unsigned char *end, size_t *length)
+{
+    unsigned char b;
+    do {
+        if (*ip >= end)
+            return false;
+        b = *(*ip)++;
+        *length += b;
+    } while (b == 255);
+    return true;
+}
+
+int lz_decompress_block(const unsigned char *in, size_t length, unsigned char *out, size_t capacity)
+{
+    const unsigned char *ip = in;
+    const unsigned char *end = in + length;
+    size_t op = 0;
+    while (true) {
+        if (ip >= end)
+            return -1;
+        unsigned char token = *ip++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !read_length(&ip, end, &literalLength))
+            return -1;
+        if (literalLength > (size_t)(end - ip) || literalLength > capacity - op)
+            return -1;
+        if (literalLength > 0)
+            memcpy(out + op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+        if (ip == end)
+            break;
+        if (end - ip < 2)
+            return -1;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op)
+            return -1;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !read_length(&ip, end, &matchLength))
+            return -1;
+        matchLength += LZ_MIN_MATCH;
+        if (matchLength > capacity - op)
+            return -1;
+        // byte by byte, matches may overlap their own output
+        for (size_t i = 0; i < matchLength; i++, op++)
+            out[op] = out[op - offset];
+    }
+    return (int)op;
+}
+
+int lz_encoder_init(lz_encoder *encoder, const unsigned char *input, size_t size, size_t blockSize)
+{
+    if (blockSize == 0 || blockSize > LZ_MAX_BLOCK_SIZE || size > UINT32_MAX)
+        return -1;
+    encoder->input = input;
+    encoder->size = size;
+    encoder->blockSize = blockSize;
+    encoder->offset = 0;
+    encoder->produced = 0;
+    encoder->headerWritten = false;
+    return 0;
+}
+
+size_t lz_encoder_bound(const lz_encoder *encoder)
+{
+    return LZ_BLOCK_HEADER_SIZE + lz_block_bound(encoder->blockSize);
+}
+
+size_t lz_encoder_next(lz_encoder *encoder, unsigned char *out)
+{
+    size_t written;
+    if (!encoder->headerWritten) {
+        memcpy(out, streamMagic, sizeof(streamMagic));
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = (unsigned char)(encoder->size >> (8 * i));
+        out[8] = (unsigned char)encoder->blockSize;
+        out[9] = (unsigned char)(encoder->blockSize >> 8);
+        encoder->headerWritten = true;
+        written = LZ_STREAM_HEADER_SIZE;
+    } else if (encoder->offset < encoder->size) {
+        const unsigned char *block = encoder->input + encoder->offset;
+        size_t length = encoder->size - encoder->offset;
+        if (length > encoder->blockSize)
+            length = encoder->blockSize;
+        size_t payload = lz_compress_block(block, length, out + LZ_BLOCK_HEADER_SIZE);
+        if (payload >= length) {
+            // no gain, the peripheral copies stored blocks straight through
+            memcpy(out + LZ_BLOCK_HEADER_SIZE, block, length);
+            payload = length | LZ_BLOCK_STORED;
+        }
+        out[0] = (unsigned char)payload;
+        out[1] = (unsigned char)(payload >> 8);
+        encoder->offset += length;
+        written = LZ_BLOCK_HEADER_SIZE + (payload & ~LZ_BLOCK_STORED);
+    } else {
+        return 0;
+    }
+    encoder->produced += written;
+    return written;
+}
+
+long lz_stream_raw_size(const unsigned char *in, size_t length)
+{
+    if (length < LZ_STREAM_HEADER_SIZE || memcmp(in, streamMagic, sizeof(streamMagic)) != 0)
+        return -1;
+    return (long)((uint32_t)in[4] | (uint32_t)in[5] << 8 | (uint32_t)in[6] << 16 | (uint32_t)in[7] << 24);
+}
+
+long lz_stream_decode(const unsigned char *in, size_t length, unsigned char *out, size_t capacity)
+{
+    long rawSize = lz_stream_raw_size(in, length);
+    if (rawSize < 0 || (size_t)rawSize > capacity)
+        return -1;
+    size_t blockSize = in[8] | (in[9] << 8);
+    if (blockSize == 0 || blockSize > LZ_MAX_BLOCK_SIZE)
+        return -1;
+    size_t ip = LZ_STREAM_HEADER_SIZE;
+    size_t op = 0;
+    while (op < (size_t)rawSize) {
+        if (length - ip < LZ_BLOCK_HEADER_SIZE)
+            return -1;
+        size_t header = in[ip] | (in[ip + 1] << 8);
+        size_t payload = header & ~LZ_BLOCK_STORED;
+        ip += LZ_BLOCK_HEADER_SIZE;
+        size_t expected = (size_t)rawSize - op < blockSize ? (size_t)rawSize - op : blockSize;
+        if (payload > length - ip)
+            return -1;
+        if (header & LZ_BLOCK_STORED) {
+            if (payload != expected)
+                return -1;
+            memcpy(out + op, in + ip, payload);
+        } else if (lz_decompress_block(in + ip, payload, out + op, expected) != (int)expected) {
+            return -1;
+        }
+        ip += payload;
+        op += expected;
+    }
+    // whatever follows the last block is transport padding
+    return rawSize;
+}
@@ -0,0 +1,54 @@
+#ifndef LZ_BLOCK_H
+#define LZ_BLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// LZ4-style compression for OTA images. The stream is a header followed by independently
+// compressed blocks so the peripheral only ever needs one block of RAM to decode:
+//   header  'O' 'T' 'A' 'Z', raw size (u32 LE), block size (u16 LE)
+//   block   u16 LE payload length with LZ_BLOCK_STORED set when the payload is the raw block,
+//           then the payload
+// A compressed payload is a run of LZ4 block sequences: token (literal length << 4 | match
+// length - 4), extra length bytes of 255 while the nibble is 15, literals, 2 byte LE offset,
+// extra match length bytes. The last sequence carries literals only.
+#define LZ_STREAM_HEADER_SIZE 10
+#define LZ_BLOCK_HEADER_SIZE 2
+#define LZ_BLOCK_STORED 0x8000
+#define LZ_MAX_BLOCK_SIZE 16384
+#define LZ_DEFAULT_BLOCK_SIZE 4096
+
+// worst case compressed size of length bytes
+size_t lz_block_bound(size_t length);
+// compresses one block into out, which must hold lz_block_bound(length) bytes; returns the
+// compressed length (which may exceed length for incompressible data)
+size_t lz_compress_block(const unsigned char *in, size_t length, unsigned char *out);
+// reference decoder; returns the decoded length, or -1 for a malformed block or when it does
+// not fit in capacity
+int lz_decompress_block(const unsigned char *in, size_t length, unsigned char *out, size_t capacity);
+
+// streaming encoder over an input that stays where it is (the mapped image); every call
+// emits the next piece of the stream, the header first and then one block
+struct lz_encoder {
+    const unsigned char *input;
+    size_t size;
+    size_t blockSize;
+    size_t offset;
+    size_t produced;
+    bool headerWritten;
+};
+
+// returns -1 when blockSize is 0 or over LZ_MAX_BLOCK_SIZE, or size does not fit the header
+int lz_encoder_init(lz_encoder *encoder, const unsigned char *input, size_t size, size_t blockSize);
+// bytes out has to hold for any lz_encoder_next call
+size_t lz_encoder_bound(const lz_encoder *encoder);
+// returns the bytes written, 0 once the whole stream has been produced
+size_t lz_encoder_next(lz_encoder *encoder, unsigned char *out);
+
+// raw size announced by a stream header, -1 when the header is not there
+long lz_stream_raw_size(const unsigned char *in, size_t length);
+// reference decoder for a whole stream, bytes after the last block are ignored; returns the raw
+// size, or -1 when the stream is malformed or out is smaller than the raw size
+long lz_stream_decode(const unsigned char *in, size_t length, unsigned char *out, size_t capacity);
+
+#endif //LZ_BLOCK_H
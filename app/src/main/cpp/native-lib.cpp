@@ -1,83 +1,16 @@
 #include <jni.h>
 #include <string>
-#define RC5_ENC_BLOCK_SIZE  4
-
-typedef unsigned short WORD;
-#define _wordLengthInBit sizeof(WORD) * 8//w
-#define _round 12 //r
-#define _keyLengthInByte 16 //b
-#define _keyLengthInWord 8//_keyLengthInByte * 8 / _wordLengthInBit; //c: key length in
-#define _sTableSize 26 //2 * (_round + 1); // t: S table size
-WORD _S[_sTableSize]; //S table
-WORD CyclicRightShift(WORD i, WORD a);
-
-WORD CyclicLeftShift(WORD i, WORD i1);
-
-const WORD _P = (WORD)0xb7e1; //magic constants
-const WORD _Q = (WORD)0x9e37; //magic constants
-WORD CyclicRightShift(WORD x, WORD y)
-{
-    return (x >> (y&(_wordLengthInBit - 1))) | (x << (_wordLengthInBit - (y&(_wordLengthInBit - 1))));
-}
-
-WORD CyclicLeftShift(WORD x, WORD y)
-{
-    return (x << (y&(_wordLengthInBit - 1))) | (x >> (_wordLengthInBit - (y&(_wordLengthInBit - 1))));
-}
-void cipher_rc5_setup(unsigned char *keyData)
-{
-    int i = 0, j= 0, k =0;
-    WORD A = 0, B = 0;
-    WORD u = _wordLengthInBit / 8;
-    WORD L[_keyLengthInWord];
-    memset(L, 0, sizeof(L));
-    for (i = _keyLengthInByte - 1; i != -1; i--)
-        L[i / u] = (L[i / u] << 8) + keyData[i];
-    for (i = 1, _S[0] = _P; i < _sTableSize; i++)
-        _S[i] = _S[i - 1] + _Q;
-    for (A = B = i = j = k = 0; k < 3 * _sTableSize; k++)
-    {
-        A = _S[i] = CyclicLeftShift(_S[i] + (A + B), 3);
-        B = L[j] = CyclicLeftShift(L[j] + (A + B), A + B);
-        i = (i + 1) % _sTableSize;
-        j = (j + 1) % _keyLengthInWord;
-    }
-}
-
-
-
-WORD* cipher_rc5_encrypt(const WORD *pt)
-{
-    int i = 0;
-    WORD ct[2];
-    WORD A = pt[0] + _S[0], B = pt[1] + _S[1];
-    for (i = 1; i <= _round; i++)
-    {
-        A = CyclicLeftShift((WORD)(A^B), B) + _S[2 * i];
-        B = CyclicLeftShift((WORD)(B^A), A) + _S[2 * i + 1];
-    }
-    ct[0] = A;
-    ct[1] = B;
-    return ct;
-}
-WORD* cipher_rc5_Decrypt(const WORD * ct)//must input WORD x[2] for in and out
-{
-    WORD pt[2];
-    int i;
-    WORD B = ct[1], A = ct[0];
-    for (i = _round; i > 0; i--)
-    {
-        B = CyclicRightShift(B - _S[2 * i + 1], A) ^ A;
-        A = CyclicRightShift(A - _S[2 * i], B) ^ B;
-    }
-    pt[1] = B - _S[1];
-    pt[0] = A - _S[0];
-    return pt;
-}
-
-
-
-
+#include <cstring>
+#include <vector>
+#include "rc5-core.h"
+#include "firmware-image.h"
+#include "beacon-parser.h"
+#include "hex-codec.h"
+#include "device-table.h"
+#include "log-store.h"
+#include "ota-transfer.h"
+#include "locator-engine.h"
+#include "probe.h"
 
 extern "C"
 JNIEXPORT void JNICALL
@@ -89,24 +22,550 @@ Java_com_trial_bluetoothtrials_DeviceDetailActivityKt_rc5Setup(JNIEnv *env,jclas
 }extern "C"
 JNIEXPORT jbyteArray JNICALL
 Java_com_trial_bluetoothtrials_DeviceDetailActivityKt_rc5Decrypt(JNIEnv *env, jclass clazz, jbyteArray entry) {
-    unsigned char decryptedValue[4];
-    unsigned char * input= reinterpret_cast<unsigned char *>(env->GetByteArrayElements(entry,
-                                                                                       NULL));
-    WORD * decValuept=cipher_rc5_Decrypt(reinterpret_cast<const WORD *>(input));
-    memcpy(decryptedValue,(unsigned char*)decValuept,sizeof(decryptedValue));
+    WORD input[2], decryptedValue[2];
+    env->GetByteArrayRegion(entry, 0, 4, reinterpret_cast<jbyte *>(input));
+    cipher_rc5_Decrypt(input, decryptedValue);
     jbyteArray ret = env->NewByteArray(4);
     env->SetByteArrayRegion(ret, 0, 4, reinterpret_cast<const jbyte *>(decryptedValue));
     return ret;
 }extern "C"
 JNIEXPORT jbyteArray JNICALL
 Java_com_trial_bluetoothtrials_DeviceDetailActivityKt_rc5Encrypt(JNIEnv *env, jclass clazz, jbyteArray entry) {
-    unsigned char encryptedValue[4];
-    unsigned char * input= reinterpret_cast<unsigned char *>(env->GetByteArrayElements(entry,
-                                                                                       NULL));
-    WORD * encValuept=cipher_rc5_encrypt(reinterpret_cast<const WORD *>(input));
-    memcpy(encryptedValue,(unsigned char*)encValuept,sizeof(encryptedValue));
+    WORD input[2], encryptedValue[2];
+    env->GetByteArrayRegion(entry, 0, 4, reinterpret_cast<jbyte *>(input));
+    cipher_rc5_encrypt(input, encryptedValue);
     jbyteArray ret = env->NewByteArray(4);
     env->SetByteArrayRegion(ret, 0, 4, reinterpret_cast<const jbyte *>(encryptedValue));
     return ret;
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_DeviceDetailActivityKt_rc5EncryptBuffer(JNIEnv *env, jclass clazz, jbyteArray entry) {
+    probe_scope jni(PROBE_JNI);
+    jsize length = env->GetArrayLength(entry);
+    std::vector<unsigned char> buffer(length);
+    env->GetByteArrayRegion(entry, 0, length, reinterpret_cast<jbyte *>(buffer.data()));
+    jni.bytes = length;
+    size_t outLength;
+    {
+        probe_scope probe(PROBE_RC5_ENCRYPT, length);
+        outLength = cipher_rc5_encrypt_buffer(buffer.data(), buffer.data(), buffer.size());
+    }
+    jbyteArray ret = env->NewByteArray(outLength);
+    env->SetByteArrayRegion(ret, 0, outLength, reinterpret_cast<const jbyte *>(buffer.data()));
+    return ret;
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_DeviceDetailActivityKt_rc5DecryptBuffer(JNIEnv *env, jclass clazz, jbyteArray entry) {
+    probe_scope jni(PROBE_JNI);
+    jsize length = env->GetArrayLength(entry);
+    std::vector<unsigned char> buffer(length);
+    env->GetByteArrayRegion(entry, 0, length, reinterpret_cast<jbyte *>(buffer.data()));
+    jni.bytes = length;
+    size_t outLength;
+    {
+        probe_scope probe(PROBE_RC5_DECRYPT, length);
+        outLength = cipher_rc5_decrypt_buffer(buffer.data(), buffer.data(), buffer.size());
+    }
+    jbyteArray ret = env->NewByteArray(outLength);
+    env->SetByteArrayRegion(ret, 0, outLength, reinterpret_cast<const jbyte *>(buffer.data()));
+    return ret;
+}extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_com_trial_bluetoothtrials_DeviceDetailActivityKt_rc5EncryptImage(JNIEnv *env, jclass clazz, jbyteArray image, jint chunkSize) {
+    jsize length = env->GetArrayLength(image);
+    if (chunkSize <= 0)
+        chunkSize = length > 0 ? length : 1;
+    jsize chunkCount = length / chunkSize + (length % chunkSize != 0 ? 1 : 0);
+    jobjectArray frames = env->NewObjectArray(chunkCount, env->FindClass("[B"), NULL);
+    unsigned char *input = reinterpret_cast<unsigned char *>(env->GetByteArrayElements(image, NULL));
+    std::vector<unsigned char> frame(cipher_rc5_frame_size(chunkSize));
+    for (jsize i = 0; i < chunkCount; i++) {
+        size_t offset = (size_t)i * chunkSize;
+        size_t size = length - offset < (size_t)chunkSize ? length - offset : chunkSize;
+        size_t frameLength = cipher_rc5_encrypt_frame(input + offset, size, frame.data());
+        jbyteArray ret = env->NewByteArray(frameLength);
+        env->SetByteArrayRegion(ret, 0, frameLength, reinterpret_cast<const jbyte *>(frame.data()));
+        env->SetObjectArrayElement(frames, i, ret);
+        env->DeleteLocalRef(ret);
+    }
+    env->ReleaseByteArrayElements(image, reinterpret_cast<jbyte *>(input), JNI_ABORT);
+    return frames;
+}extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_trial_bluetoothtrials_DeviceDetailActivityKt_rc5SessionCreate(JNIEnv *env, jclass clazz, jbyteArray key) {
+    if (env->GetArrayLength(key) < _keyLengthInByte)
+        return 0;
+    unsigned char keyData[_keyLengthInByte];
+    env->GetByteArrayRegion(key, 0, _keyLengthInByte, reinterpret_cast<jbyte *>(keyData));
+    rc5_session *session = new rc5_session;
+    rc5_session_init(session, keyData);
+    memset(keyData, 0, sizeof(keyData));
+    return reinterpret_cast<jlong>(session);
+}extern "C"
+JNIEXPORT void JNICALL
+Java_com_trial_bluetoothtrials_DeviceDetailActivityKt_rc5SessionDestroy(JNIEnv *env, jclass clazz, jlong handle) {
+    rc5_session *session = reinterpret_cast<rc5_session *>(handle);
+    if (session != NULL) {
+        memset(session, 0, sizeof(*session));
+        delete session;
+    }
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_DeviceDetailActivityKt_rc5SessionEncrypt(JNIEnv *env, jclass clazz, jlong handle,
+                                                                        jbyteArray entry) {
+    probe_scope jni(PROBE_JNI);
+    if (handle == 0)
+        return NULL;
+    jsize length = env->GetArrayLength(entry);
+    std::vector<unsigned char> buffer(length);
+    env->GetByteArrayRegion(entry, 0, length, reinterpret_cast<jbyte *>(buffer.data()));
+    jni.bytes = length;
+    size_t outLength;
+    {
+        probe_scope probe(PROBE_RC5_ENCRYPT, length);
+        outLength = rc5_session_encrypt(reinterpret_cast<const rc5_session *>(handle), buffer.data(), buffer.data(),
+                                   buffer.size());
+    }
+    jbyteArray ret = env->NewByteArray(outLength);
+    env->SetByteArrayRegion(ret, 0, outLength, reinterpret_cast<const jbyte *>(buffer.data()));
+    return ret;
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_DeviceDetailActivityKt_rc5SessionDecrypt(JNIEnv *env, jclass clazz, jlong handle,
+                                                                        jbyteArray entry) {
+    probe_scope jni(PROBE_JNI);
+    if (handle == 0)
+        return NULL;
+    jsize length = env->GetArrayLength(entry);
+    std::vector<unsigned char> buffer(length);
+    env->GetByteArrayRegion(entry, 0, length, reinterpret_cast<jbyte *>(buffer.data()));
+    jni.bytes = length;
+    size_t outLength;
+    {
+        probe_scope probe(PROBE_RC5_DECRYPT, length);
+        outLength = rc5_session_decrypt(reinterpret_cast<const rc5_session *>(handle), buffer.data(), buffer.data(),
+                                   buffer.size());
+    }
+    jbyteArray ret = env->NewByteArray(outLength);
+    env->SetByteArrayRegion(ret, 0, outLength, reinterpret_cast<const jbyte *>(buffer.data()));
+    return ret;
+}extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_trial_bluetoothtrials_Utility_FileKt_firmwareOpen(JNIEnv *env, jclass clazz, jstring path) {
+    const char *filename = env->GetStringUTFChars(path, NULL);
+    firmware_image *image = new firmware_image;
+    int result = firmware_image_open(image, filename);
+    env->ReleaseStringUTFChars(path, filename);
+    if (result != 0) {
+        delete image;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(image);
+}extern "C"
+JNIEXPORT void JNICALL
+Java_com_trial_bluetoothtrials_Utility_FileKt_firmwareClose(JNIEnv *env, jclass clazz, jlong handle) {
+    firmware_image *image = reinterpret_cast<firmware_image *>(handle);
+    if (image != NULL) {
+        firmware_image_close(image);
+        delete image;
+    }
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_FileKt_firmwareSize(JNIEnv *env, jclass clazz, jlong handle) {
+    if (handle == 0)
+        return 0;
+    return reinterpret_cast<firmware_image *>(handle)->size;
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_FileKt_firmwareCompress(JNIEnv *env, jclass clazz, jlong handle,
+                                                               jint blockSize) {
+    if (handle == 0)
+        return -1;
+    return firmware_image_compress(reinterpret_cast<firmware_image *>(handle), blockSize > 0 ? blockSize : 0);
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_FileKt_firmwareSetChunkSize(JNIEnv *env, jclass clazz, jlong handle,
+                                                                   jint chunkSize) {
+    if (handle == 0)
+        return 0;
+    firmware_image *image = reinterpret_cast<firmware_image *>(handle);
+    firmware_image_set_chunk_size(image, chunkSize > 0 ? chunkSize : 0);
+    return image->chunkCount;
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_Utility_FileKt_firmwareReadChunk(JNIEnv *env, jclass clazz, jlong handle,
+                                                                jint index) {
+    probe_scope jni(PROBE_JNI);
+    if (handle == 0)
+        return NULL;
+    firmware_chunk chunk = firmware_image_chunk(reinterpret_cast<firmware_image *>(handle), index);
+    if (chunk.data == NULL)
+        return NULL;
+    jbyteArray ret = env->NewByteArray(chunk.size);
+    env->SetByteArrayRegion(ret, 0, chunk.size, reinterpret_cast<const jbyte *>(chunk.data));
+    return ret;
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_Utility_FileKt_firmwareEncryptFrame(JNIEnv *env, jclass clazz, jlong handle,
+                                                                   jlong session, jint index) {
+    probe_scope jni(PROBE_JNI);
+    if (handle == 0 || session == 0)
+        return NULL;
+    firmware_image *image = reinterpret_cast<firmware_image *>(handle);
+    std::vector<unsigned char> frame(cipher_rc5_frame_size(image->chunkSize));
+    size_t frameLength;
+    {
+        probe_scope probe(PROBE_RC5_ENCRYPT);
+        frameLength = firmware_image_encrypt_frame(image, reinterpret_cast<const rc5_session *>(session), index,
+                                                   frame.data());
+        probe.bytes = frameLength;
+    }
+    jni.bytes = frameLength;
+    if (frameLength == 0)
+        return NULL;
+    jbyteArray ret = env->NewByteArray(frameLength);
+    env->SetByteArrayRegion(ret, 0, frameLength, reinterpret_cast<const jbyte *>(frame.data()));
+    return ret;
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_LoggerScanActivityKt_beaconParseBatch(JNIEnv *env, jclass clazz, jobject records,
+                                                                     jint length, jobject reports) {
+    probe_scope jni(PROBE_JNI);
+    // both buffers are direct, so the records are parsed and the reports written in place
+    const unsigned char *input = static_cast<const unsigned char *>(env->GetDirectBufferAddress(records));
+    beacon_report *output = static_cast<beacon_report *>(env->GetDirectBufferAddress(reports));
+    if (input == NULL || output == NULL || length < 0 || length > env->GetDirectBufferCapacity(records))
+        return -1;
+    size_t maxReports = env->GetDirectBufferCapacity(reports) / BEACON_REPORT_SIZE;
+    jni.bytes = length;
+    probe_scope probe(PROBE_BEACON_PARSE, length);
+    return beacon_parse_batch(input, length, output, maxReports);
+}extern "C"
+JNIEXPORT jstring JNICALL
+Java_com_trial_bluetoothtrials_LoggerScanActivityKt_hexEncode(JNIEnv *env, jclass clazz, jbyteArray bytes) {
+    probe_scope jni(PROBE_JNI);
+    jsize length = env->GetArrayLength(bytes);
+    std::vector<char> text(2 * length + 1);
+    const unsigned char *input = static_cast<const unsigned char *>(env->GetPrimitiveArrayCritical(bytes, NULL));
+    // the VM could not pin the array and has an OutOfMemoryError pending for the caller
+    if (input == NULL)
+        return NULL;
+    hex_encode(input, length, text.data());
+    env->ReleasePrimitiveArrayCritical(bytes, const_cast<unsigned char *>(input), JNI_ABORT);
+    text[2 * length] = '\0';
+    return env->NewStringUTF(text.data());
+}extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_trial_bluetoothtrials_Utility_DeviceTableKt_deviceTableCreate(JNIEnv *env, jclass clazz, jint expectedRows) {
+    device_table *table = new device_table;
+    device_table_init(table, expectedRows > 0 ? expectedRows : 0);
+    return reinterpret_cast<jlong>(table);
+}extern "C"
+JNIEXPORT void JNICALL
+Java_com_trial_bluetoothtrials_Utility_DeviceTableKt_deviceTableDestroy(JNIEnv *env, jclass clazz, jlong handle) {
+    delete reinterpret_cast<device_table *>(handle);
+}extern "C"
+JNIEXPORT void JNICALL
+Java_com_trial_bluetoothtrials_Utility_DeviceTableKt_deviceTableClear(JNIEnv *env, jclass clazz, jlong handle) {
+    device_table_clear(reinterpret_cast<device_table *>(handle));
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_DeviceTableKt_deviceTableUpsert(JNIEnv *env, jclass clazz, jlong handle,
+                                                                       jlong key) {
+    probe_scope jni(PROBE_JNI);
+    return device_table_upsert(reinterpret_cast<device_table *>(handle), (uint64_t)key);
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_DeviceTableKt_deviceTableFind(JNIEnv *env, jclass clazz, jlong handle,
+                                                                     jlong key) {
+    return device_table_find(reinterpret_cast<device_table *>(handle), (uint64_t)key);
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_DeviceTableKt_deviceTableTakeChanges(JNIEnv *env, jclass clazz, jlong handle,
+                                                                            jintArray changes) {
+    // changes = inserted start, inserted count, then (start, count) pairs of changed rows
+    jsize length = env->GetArrayLength(changes);
+    if (length < 2)
+        return -1;
+    std::vector<jint> out(length);
+    size_t ranges = device_table_take_changes(reinterpret_cast<device_table *>(handle), &out[0], &out[1],
+                                              out.data() + 2, (length - 2) / 2);
+    env->SetIntArrayRegion(changes, 0, 2 + 2 * ranges, out.data());
+    return ranges;
+}extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_trial_bluetoothtrials_Utility_LogStoreKt_logStoreOpen(JNIEnv *env, jclass clazz, jlong memoryCap,
+                                                               jstring spillPath) {
+    const char *path = spillPath != NULL ? env->GetStringUTFChars(spillPath, NULL) : NULL;
+    log_store *store = new log_store;
+    int result = log_store_open(store, memoryCap > 0 ? memoryCap : 0, path);
+    if (path != NULL)
+        env->ReleaseStringUTFChars(spillPath, path);
+    if (result != 0) {
+        log_store_close(store);
+        delete store;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(store);
+}extern "C"
+JNIEXPORT void JNICALL
+Java_com_trial_bluetoothtrials_Utility_LogStoreKt_logStoreClose(JNIEnv *env, jclass clazz, jlong handle) {
+    log_store *store = reinterpret_cast<log_store *>(handle);
+    if (store != NULL) {
+        log_store_close(store);
+        delete store;
+    }
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_LogStoreKt_logStoreAppend(JNIEnv *env, jclass clazz, jlong handle, jlong tagId,
+                                                                 jlong timestampNs, jint rssi, jbyteArray payload) {
+    probe_scope jni(PROBE_JNI);
+    unsigned char buffer[LOG_PAYLOAD_MAX];
+    jsize length = env->GetArrayLength(payload);
+    if (length > LOG_PAYLOAD_MAX)
+        length = LOG_PAYLOAD_MAX;
+    env->GetByteArrayRegion(payload, 0, length, reinterpret_cast<jbyte *>(buffer));
+    return log_store_append(reinterpret_cast<log_store *>(handle), (uint32_t)tagId, timestampNs, rssi, buffer, length);
+}extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_trial_bluetoothtrials_Utility_LogStoreKt_logStoreExport(JNIEnv *env, jclass clazz, jlong handle,
+                                                                 jstring path) {
+    const char *file = env->GetStringUTFChars(path, NULL);
+    int64_t exported = log_store_export(reinterpret_cast<log_store *>(handle), file);
+    env->ReleaseStringUTFChars(path, file);
+    return exported;
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_LogStoreKt_logStoreFindTag(JNIEnv *env, jclass clazz, jlong handle,
+                                                                  jlong tagId) {
+    return log_store_find_tag(reinterpret_cast<log_store *>(handle), (uint32_t)tagId);
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_LogStoreKt_logStoreTagCount(JNIEnv *env, jclass clazz, jlong handle) {
+    return log_store_tag_count(reinterpret_cast<log_store *>(handle));
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_LogStoreKt_logStoreRecordCount(JNIEnv *env, jclass clazz, jlong handle,
+                                                                      jint tag) {
+    return log_store_record_count(reinterpret_cast<log_store *>(handle), tag);
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_LogStoreKt_logStoreReadPage(JNIEnv *env, jclass clazz, jlong handle, jint tag,
+                                                                   jint index, jint count, jobject records,
+                                                                   jobject reports) {
+    probe_scope jni(PROBE_JNI);
+    // records are copied as-is, and each payload is decoded next to it so binding does no parsing
+    log_record *output = static_cast<log_record *>(env->GetDirectBufferAddress(records));
+    beacon_report *decoded = static_cast<beacon_report *>(env->GetDirectBufferAddress(reports));
+    if (output == NULL || decoded == NULL || index < 0 || count < 0)
+        return -1;
+    if (count > env->GetDirectBufferCapacity(records) / LOG_RECORD_SIZE)
+        count = env->GetDirectBufferCapacity(records) / LOG_RECORD_SIZE;
+    if (count > env->GetDirectBufferCapacity(reports) / BEACON_REPORT_SIZE)
+        count = env->GetDirectBufferCapacity(reports) / BEACON_REPORT_SIZE;
+    size_t read = log_store_read(reinterpret_cast<log_store *>(handle), tag, index, count, output);
+    for (size_t i = 0; i < read; i++) {
+        if (beacon_parse(output[i].payload, output[i].length, &decoded[i]) != 0)
+            memset(&decoded[i], 0, sizeof(decoded[i]));
+        decoded[i].index = (uint16_t)i;
+    }
+    return read;
+}
+
+// this library's registry plus the ones other libraries handed out (aesProbeRegistry)
+static void snapshot_registries(JNIEnv *env, jlongArray others, probe_totals *totals)
+{
+    std::vector<probe_registry *> registries(1, probe_local_registry());
+    jsize count = others != NULL ? env->GetArrayLength(others) : 0;
+    std::vector<jlong> handles(count);
+    if (count > 0)
+        env->GetLongArrayRegion(others, 0, count, handles.data());
+    for (jlong handle : handles)
+        registries.push_back(reinterpret_cast<probe_registry *>(handle));
+    probe_snapshot(registries.data(), registries.size(), totals);
 }
 
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_trial_bluetoothtrials_Utility_OtaTransferKt_otaTransferCreate(JNIEnv *env, jclass clazz, jlong image,
+                                                                       jlong session, jint window, jint maxAttempts,
+                                                                       jint timeoutMs, jint maxFrame,
+                                                                       jbyteArray digestKey) {
+    ota_transfer *transfer = new ota_transfer;
+    if (image == 0 || session == 0 || window <= 0 || maxFrame <= 0 ||
+        ota_transfer_init(transfer, reinterpret_cast<const firmware_image *>(image),
+                          reinterpret_cast<const rc5_session *>(session), window, maxAttempts > 0 ? maxAttempts : 1,
+                          (int64_t)timeoutMs * 1000000, maxFrame) != 0) {
+        delete transfer;
+        return 0;
+    }
+    // keys of any other length still encrypt with RC5 but get no digest
+    if (digestKey != NULL && env->GetArrayLength(digestKey) == AES_BLOCK_SIZE) {
+        unsigned char key[AES_BLOCK_SIZE];
+        env->GetByteArrayRegion(digestKey, 0, AES_BLOCK_SIZE, reinterpret_cast<jbyte *>(key));
+        image_digest *digest = new image_digest;
+        image_digest_init(digest, key);
+        ota_transfer_attach_digest(transfer, digest);
+    }
+    return reinterpret_cast<jlong>(transfer);
+}extern "C"
+JNIEXPORT void JNICALL
+Java_com_trial_bluetoothtrials_Utility_OtaTransferKt_otaTransferDestroy(JNIEnv *env, jclass clazz, jlong handle) {
+    ota_transfer *transfer = reinterpret_cast<ota_transfer *>(handle);
+    if (transfer != NULL)
+        delete transfer->digest;
+    delete transfer;
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_Utility_OtaTransferKt_otaTransferNext(JNIEnv *env, jclass clazz, jlong handle) {
+    probe_scope jni(PROBE_JNI);
+    ota_transfer *transfer = reinterpret_cast<ota_transfer *>(handle);
+    std::vector<unsigned char> frame(ota_transfer_frame_size(transfer));
+    size_t frameLength;
+    if (ota_transfer_next(transfer, probe_now_ns(), frame.data(), &frameLength) < 0)
+        return NULL;
+    jni.bytes = frameLength;
+    jbyteArray ret = env->NewByteArray(frameLength);
+    env->SetByteArrayRegion(ret, 0, frameLength, reinterpret_cast<const jbyte *>(frame.data()));
+    return ret;
+}extern "C"
+JNIEXPORT void JNICALL
+Java_com_trial_bluetoothtrials_Utility_OtaTransferKt_otaTransferRefused(JNIEnv *env, jclass clazz, jlong handle) {
+    ota_transfer_refused(reinterpret_cast<ota_transfer *>(handle));
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_OtaTransferKt_otaTransferComplete(JNIEnv *env, jclass clazz, jlong handle,
+                                                                         jint status) {
+    probe_scope jni(PROBE_JNI);
+    return ota_transfer_complete(reinterpret_cast<ota_transfer *>(handle), status, probe_now_ns());
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_OtaTransferKt_otaTransferPoll(JNIEnv *env, jclass clazz, jlong handle) {
+    probe_scope jni(PROBE_JNI);
+    return ota_transfer_poll(reinterpret_cast<ota_transfer *>(handle), probe_now_ns());
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_OtaTransferKt_otaTransferCompleted(JNIEnv *env, jclass clazz, jlong handle) {
+    return reinterpret_cast<ota_transfer *>(handle)->completed;
+}extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_com_trial_bluetoothtrials_Utility_OtaTransferKt_otaTransferStats(JNIEnv *env, jclass clazz, jlong handle) {
+    ota_transfer_stats stats;
+    ota_transfer_get_stats(reinterpret_cast<ota_transfer *>(handle), &stats);
+    jlong values[] = {(jlong)stats.chunks, (jlong)stats.completed, (jlong)stats.retransmits, (jlong)stats.refusals,
+                      stats.elapsedNs, stats.latencyMinNs, stats.latencyMeanNs, stats.latencyP95Ns,
+                      stats.latencyMaxNs};
+    jlongArray ret = env->NewLongArray(sizeof(values) / sizeof(values[0]));
+    env->SetLongArrayRegion(ret, 0, sizeof(values) / sizeof(values[0]), values);
+    return ret;
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_Utility_OtaTransferKt_otaTransferDigest(JNIEnv *env, jclass clazz, jlong handle) {
+    ota_transfer *transfer = reinterpret_cast<ota_transfer *>(handle);
+    if (transfer->digest == NULL || !image_digest_complete(transfer->digest, transfer->image))
+        return NULL;
+    unsigned char digest[IMAGE_DIGEST_SIZE];
+    image_digest_final(transfer->digest, digest);
+    jbyteArray ret = env->NewByteArray(IMAGE_DIGEST_SIZE);
+    env->SetByteArrayRegion(ret, 0, IMAGE_DIGEST_SIZE, reinterpret_cast<const jbyte *>(digest));
+    return ret;
+}
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_com_trial_bluetoothtrials_Utility_ProbesKt_probeSnapshot(JNIEnv *env, jclass clazz, jlongArray registries) {
+    probe_totals totals[PROBE_COUNT];
+    snapshot_registries(env, registries, totals);
+    // per probe: calls, bytes, total ns, max ns, then the PROBE_BUCKETS histogram
+    const jsize fields = 4 + PROBE_BUCKETS;
+    jlong values[PROBE_COUNT * fields];
+    for (int id = 0; id < PROBE_COUNT; id++) {
+        jlong *v = values + id * fields;
+        v[0] = totals[id].calls;
+        v[1] = totals[id].bytes;
+        v[2] = totals[id].totalNs;
+        v[3] = totals[id].maxNs;
+        for (int b = 0; b < PROBE_BUCKETS; b++)
+            v[4 + b] = totals[id].buckets[b];
+    }
+    jlongArray ret = env->NewLongArray(PROBE_COUNT * fields);
+    env->SetLongArrayRegion(ret, 0, PROBE_COUNT * fields, values);
+    return ret;
+}extern "C"
+JNIEXPORT jstring JNICALL
+Java_com_trial_bluetoothtrials_Utility_ProbesKt_probeExportJson(JNIEnv *env, jclass clazz, jlongArray registries) {
+    probe_totals totals[PROBE_COUNT];
+    snapshot_registries(env, registries, totals);
+    return env->NewStringUTF(probe_export_json(totals).c_str());
+}extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_com_trial_bluetoothtrials_Utility_ProbesKt_probeExportBinary(JNIEnv *env, jclass clazz, jlongArray registries) {
+    probe_totals totals[PROBE_COUNT];
+    snapshot_registries(env, registries, totals);
+    std::vector<unsigned char> trace = probe_export_binary(totals);
+    jbyteArray ret = env->NewByteArray(trace.size());
+    env->SetByteArrayRegion(ret, 0, trace.size(), reinterpret_cast<const jbyte *>(trace.data()));
+    return ret;
+}extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_trial_bluetoothtrials_Utility_LocatorEngineKt_locatorEngineCreate(JNIEnv *env, jclass clazz, jint filter) {
+    locator_config config;
+    locator_config_default(&config);
+    config.filter = filter == LOCATOR_FILTER_MEDIAN ? LOCATOR_FILTER_MEDIAN : LOCATOR_FILTER_KALMAN;
+    locator_engine *engine = new locator_engine;
+    locator_engine_init(engine, &config);
+    return reinterpret_cast<jlong>(engine);
+}extern "C"
+JNIEXPORT void JNICALL
+Java_com_trial_bluetoothtrials_Utility_LocatorEngineKt_locatorEngineDestroy(JNIEnv *env, jclass clazz, jlong handle) {
+    delete reinterpret_cast<locator_engine *>(handle);
+}extern "C"
+JNIEXPORT void JNICALL
+Java_com_trial_bluetoothtrials_Utility_LocatorEngineKt_locatorEnginePlace(JNIEnv *env, jclass clazz, jlong handle,
+                                                                          jlong locatorId, jfloat x, jfloat y) {
+    locator_engine_place(reinterpret_cast<locator_engine *>(handle), (uint32_t)locatorId, x, y);
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_LocatorEngineKt_locatorEngineUpdate(JNIEnv *env, jclass clazz, jlong handle,
+                                                                           jobject reports, jint count,
+                                                                           jlongArray timestamps, jobject fixes) {
+    probe_scope jni(PROBE_JNI);
+    // reports as beaconParseBatch left them, one fix per report written next to them
+    const beacon_report *input = static_cast<const beacon_report *>(env->GetDirectBufferAddress(reports));
+    locator_fix *output = static_cast<locator_fix *>(env->GetDirectBufferAddress(fixes));
+    if (input == NULL || output == NULL || count < 0 || count > env->GetArrayLength(timestamps) ||
+        count > env->GetDirectBufferCapacity(reports) / BEACON_REPORT_SIZE ||
+        count > env->GetDirectBufferCapacity(fixes) / LOCATOR_FIX_SIZE)
+        return -1;
+    std::vector<jlong> times(count);
+    env->GetLongArrayRegion(timestamps, 0, count, times.data());
+    locator_engine *engine = reinterpret_cast<locator_engine *>(handle);
+    for (jint i = 0; i < count; i++) {
+        if (locator_engine_update(engine, &input[i], times[i], &output[i]) < 0) {
+            memset(&output[i], 0, sizeof(output[i]));
+            output[i].tag = -1;
+        }
+    }
+    return count;
+}extern "C"
+JNIEXPORT jint JNICALL
+Java_com_trial_bluetoothtrials_Utility_LocatorEngineKt_locatorEngineReplay(JNIEnv *env, jclass clazz, jlong handle,
+                                                                           jlong store) {
+    return locator_engine_replay(reinterpret_cast<locator_engine *>(handle), reinterpret_cast<log_store *>(store),
+                                 NULL, NULL);
+}extern "C"
+JNIEXPORT jdoubleArray JNICALL
+Java_com_trial_bluetoothtrials_Utility_LocatorEngineKt_locatorEngineTagState(JNIEnv *env, jclass clazz, jlong handle,
+                                                                             jlong tagId) {
+    const locator_engine *engine = reinterpret_cast<locator_engine *>(handle);
+    int32_t row = locator_engine_find_tag(engine, (uint32_t)tagId);
+    if (row < 0)
+        return NULL;
+    const locator_tag &tag = engine->tags[row];
+    jdouble values[] = {(jdouble)tag.zone, (jdouble)tag.hasPosition, tag.x, tag.y, tag.residualCm,
+                        (jdouble)tag.reports, (jdouble)tag.fixes, (jdouble)tag.failures, (jdouble)tag.transitions,
+                        (jdouble)tag.dwellNs[LOCATOR_ZONE_INSIDE], (jdouble)tag.dwellNs[LOCATOR_ZONE_OUTSIDE],
+                        (jdouble)tag.dwellNs[LOCATOR_ZONE_FAILURE]};
+    jdoubleArray ret = env->NewDoubleArray(sizeof(values) / sizeof(values[0]));
+    env->SetDoubleArrayRegion(ret, 0, sizeof(values) / sizeof(values[0]), values);
+    return ret;
+}
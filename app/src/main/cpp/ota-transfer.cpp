@@ -0,0 +1,160 @@
+#include <algorithm>
+#include "ota-transfer.h"
+#include "probe.h"
+
+int ota_transfer_init(ota_transfer *transfer, const firmware_image *image, const rc5_session *session,
+                      size_t window, size_t maxAttempts, int64_t timeoutNs, size_t maxFrame)
+{
+    transfer->image = image;
+    transfer->session = session;
+    transfer->window = window;
+    transfer->maxAttempts = maxAttempts > 0 ? maxAttempts : 1;
+    transfer->timeoutNs = timeoutNs;
+    transfer->nextChunk = 0;
+    transfer->completed = 0;
+    transfer->inFlight.clear();
+    transfer->timing.assign(image->chunkCount, ota_chunk_timing());
+    transfer->retransmits = 0;
+    transfer->refusals = 0;
+    transfer->startNs = -1;
+    transfer->lastNs = -1;
+    transfer->endNs = -1;
+    transfer->failed = 0;
+    transfer->digest = NULL;
+    if (window == 0 || ota_transfer_frame_size(transfer) > maxFrame)
+        return -1;
+    // only the last chunk may end in a partial block
+    if (image->chunkCount > 1 && image->chunkSize % RC5_ENC_BLOCK_SIZE != 0)
+        return -1;
+    return 0;
+}
+
+void ota_transfer_attach_digest(ota_transfer *transfer, image_digest *digest)
+{
+    transfer->digest = digest;
+}
+
+size_t ota_transfer_frame_size(const ota_transfer *transfer)
+{
+    return cipher_rc5_frame_size(transfer->image->chunkSize);
+}
+
+int ota_transfer_state(const ota_transfer *transfer)
+{
+    if (transfer->failed)
+        return OTA_TRANSFER_FAILED;
+    if (transfer->completed == transfer->image->chunkCount)
+        return OTA_TRANSFER_DONE;
+    return (int)transfer->inFlight.size();
+}
+
+int64_t ota_transfer_next(ota_transfer *transfer, int64_t nowNs, unsigned char *frame, size_t *frameLength)
+{
+    int state = ota_transfer_state(transfer);
+    if (state < 0)
+        return state;
+    if (transfer->inFlight.size() >= transfer->window || transfer->nextChunk == transfer->image->chunkCount)
+        return OTA_TRANSFER_WAIT;
+    size_t chunk = transfer->nextChunk;
+    ota_chunk_timing &timing = transfer->timing[chunk];
+    if (timing.attempts >= transfer->maxAttempts) {
+        transfer->failed = 1;
+        transfer->endNs = nowNs;
+        return OTA_TRANSFER_FAILED;
+    }
+    {
+        probe_scope probe(PROBE_RC5_ENCRYPT);
+        *frameLength = firmware_image_encrypt_frame(transfer->image, transfer->session, chunk, frame);
+        probe.bytes = *frameLength;
+    }
+    if (transfer->digest != NULL)
+        image_digest_add_chunk(transfer->digest, transfer->image, chunk);
+    if (timing.attempts == 0)
+        timing.firstSentNs = nowNs;
+    else
+        transfer->retransmits++;
+    timing.sentNs = nowNs;
+    timing.attempts++;
+    if (transfer->startNs < 0)
+        transfer->startNs = nowNs;
+    transfer->lastNs = nowNs;
+    transfer->inFlight.push_back({(uint32_t)chunk, 0});
+    transfer->nextChunk++;
+    return (int64_t)chunk;
+}
+
+void ota_transfer_refused(ota_transfer *transfer)
+{
+    if (transfer->inFlight.empty())
+        return;
+    // never reached the air, so it is not an attempt
+    ota_chunk_timing &timing = transfer->timing[transfer->inFlight.back().chunk];
+    if (--timing.attempts > 0)
+        transfer->retransmits--;
+    transfer->nextChunk = transfer->inFlight.back().chunk;
+    transfer->inFlight.pop_back();
+    transfer->refusals++;
+}
+
+int ota_transfer_complete(ota_transfer *transfer, int status, int64_t nowNs)
+{
+    if (transfer->inFlight.empty() || transfer->failed)
+        return ota_transfer_state(transfer);
+    ota_in_flight entry = transfer->inFlight.front();
+    transfer->inFlight.pop_front();
+    transfer->lastNs = nowNs;
+    if (entry.stale)
+        return ota_transfer_state(transfer);
+    ota_chunk_timing &timing = transfer->timing[entry.chunk];
+    timing.completedNs = nowNs;
+    probe_record(PROBE_OTA_RTT, nowNs - timing.sentNs, transfer->image->chunkSize);
+    if (status == 0) {
+        transfer->completed = entry.chunk + 1;
+        if (transfer->completed == transfer->image->chunkCount)
+            transfer->endNs = nowNs;
+    } else {
+        for (ota_in_flight &later : transfer->inFlight)
+            later.stale = 1;
+        transfer->nextChunk = entry.chunk;
+        if (timing.attempts >= transfer->maxAttempts) {
+            transfer->failed = 1;
+            transfer->endNs = nowNs;
+        }
+    }
+    return ota_transfer_state(transfer);
+}
+
+int ota_transfer_poll(ota_transfer *transfer, int64_t nowNs)
+{
+    if (!transfer->failed && !transfer->inFlight.empty() && transfer->timeoutNs > 0 &&
+        nowNs - transfer->timing[transfer->inFlight.front().chunk].sentNs > transfer->timeoutNs) {
+        transfer->failed = 1;
+        transfer->endNs = nowNs;
+    }
+    return ota_transfer_state(transfer);
+}
+
+void ota_transfer_get_stats(const ota_transfer *transfer, ota_transfer_stats *stats)
+{
+    std::vector<int64_t> latencies;
+    latencies.reserve(transfer->completed);
+    for (size_t i = 0; i < transfer->completed; i++)
+        latencies.push_back(transfer->timing[i].completedNs - transfer->timing[i].sentNs);
+    std::sort(latencies.begin(), latencies.end());
+    stats->chunks = transfer->image->chunkCount;
+    stats->completed = transfer->completed;
+    stats->retransmits = transfer->retransmits;
+    stats->refusals = transfer->refusals;
+    int64_t endNs = transfer->endNs < 0 ? transfer->lastNs : transfer->endNs;
+    stats->elapsedNs = transfer->startNs < 0 ? 0 : endNs - transfer->startNs;
+    stats->latencyMinNs = stats->latencyMeanNs = stats->latencyP95Ns = stats->latencyMaxNs = 0;
+    if (latencies.empty())
+        return;
+    int64_t sum = 0;
+    for (int64_t latency : latencies)
+        sum += latency;
+    stats->latencyMinNs = latencies.front();
+    stats->latencyMaxNs = latencies.back();
+    stats->latencyMeanNs = sum / (int64_t)latencies.size();
+    stats->latencyP95Ns = latencies[(latencies.size() - 1) * 95 / 100];
+}
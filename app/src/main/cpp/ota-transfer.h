@@ -0,0 +1,93 @@
+#ifndef OTA_TRANSFER_H
+#define OTA_TRANSFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include "firmware-image.h"
+#include "image-digest.h"
+#include "rc5-core.h"
+
+// windowed OTA sender, independent of the radio: the caller asks for the next frame, writes
+// it (write without response) and reports back. Up to window frames may be outstanding, a
+// completion returns one credit. Completions arrive in send order and name no chunk, as
+// with onCharacteristicWrite, so the oldest outstanding frame is the one completed.
+//  - a refused write (stack busy) hands the frame back; it is resent first, nothing is lost
+//  - a failed completion rewinds to that chunk (go-back-N); frames sent after it still
+//    return their credits but are ignored, and every chunk from it is sent again
+//  - a chunk failing maxAttempts times, or no completion within timeoutNs, fails the transfer
+// all times are caller supplied monotonic nanoseconds
+// BluetoothGatt keeps one write outstanding, so the app runs with a window of 1 and the
+// throughput comes from write commands calling back as soon as the stack has buffered them
+
+#define OTA_TRANSFER_WAIT -1   // no credit or nothing left to send until a completion
+#define OTA_TRANSFER_DONE -2
+#define OTA_TRANSFER_FAILED -3
+
+struct ota_chunk_timing {
+    int64_t firstSentNs;
+    int64_t sentNs;        // last attempt
+    int64_t completedNs;
+    uint32_t attempts;
+};
+
+struct ota_in_flight {
+    uint32_t chunk;
+    uint32_t stale;        // sent before a rewind, only its credit matters
+};
+
+struct ota_transfer {
+    const firmware_image *image;
+    const rc5_session *session;
+    size_t window;
+    size_t maxAttempts;
+    int64_t timeoutNs;
+    size_t nextChunk;
+    size_t completed;      // chunks [0, completed) are confirmed
+    std::deque<ota_in_flight> inFlight;
+    std::vector<ota_chunk_timing> timing;
+    size_t retransmits;
+    size_t refusals;
+    int64_t startNs;
+    int64_t lastNs;        // latest send or completion
+    int64_t endNs;
+    int failed;
+    image_digest *digest;  // optional, fed each chunk the first time its frame is produced
+};
+
+struct ota_transfer_stats {
+    size_t chunks;
+    size_t completed;
+    size_t retransmits;
+    size_t refusals;
+    int64_t elapsedNs;
+    // send to completion of the last attempt of each chunk
+    int64_t latencyMinNs;
+    int64_t latencyMeanNs;
+    int64_t latencyP95Ns;
+    int64_t latencyMaxNs;
+};
+
+// image must have its chunk size set; returns -1 when window is 0, an encrypted frame would
+// not fit in maxFrame bytes (ATT MTU - 3) or the chunks are not whole RC5 blocks
+int ota_transfer_init(ota_transfer *transfer, const firmware_image *image, const rc5_session *session,
+                      size_t window, size_t maxAttempts, int64_t timeoutNs, size_t maxFrame);
+// digest must be freshly initialised and outlive the transfer; it is complete once every
+// chunk has been sent at least once
+void ota_transfer_attach_digest(ota_transfer *transfer, image_digest *digest);
+// bytes needed for a frame buffer
+size_t ota_transfer_frame_size(const ota_transfer *transfer);
+// writes the next frame and takes a credit; returns its chunk or one of the codes above
+int64_t ota_transfer_next(ota_transfer *transfer, int64_t nowNs, unsigned char *frame, size_t *frameLength);
+// the frame just returned by ota_transfer_next could not be written
+void ota_transfer_refused(ota_transfer *transfer);
+// the oldest outstanding frame completed, status 0 meaning success; returns the transfer state
+int ota_transfer_complete(ota_transfer *transfer, int status, int64_t nowNs);
+// checks the oldest outstanding frame against the timeout; returns the transfer state
+int ota_transfer_poll(ota_transfer *transfer, int64_t nowNs);
+// OTA_TRANSFER_DONE, OTA_TRANSFER_FAILED, or the number of frames outstanding
+int ota_transfer_state(const ota_transfer *transfer);
+void ota_transfer_get_stats(const ota_transfer *transfer, ota_transfer_stats *stats);
+
+#endif //OTA_TRANSFER_H
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <time.h>
+#include "probe.h"
+
+static const char *const probeNames[PROBE_COUNT] = {
+    "jni", "aes-encrypt", "aes-decrypt", "aes-mode", "rc5-encrypt", "rc5-decrypt", "beacon-parse", "ota-rtt",
+};
+
+static probe_registry localRegistry = {{NULL}};
+
+const char *probe_name(int id)
+{
+    return id >= 0 && id < PROBE_COUNT ? probeNames[id] : "unknown";
+}
+
+int64_t probe_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+probe_registry *probe_local_registry()
+{
+    return &localRegistry;
+}
+
+static probe_slab *thread_slab()
+{
+    thread_local probe_slab *slab = NULL;
+    if (slab == NULL) {
+        slab = new probe_slab();
+        probe_slab *head = localRegistry.slabs.load(std::memory_order_relaxed);
+        do {
+            slab->next = head;
+        } while (!localRegistry.slabs.compare_exchange_weak(head, slab, std::memory_order_release,
+                                                            std::memory_order_relaxed));
+    }
+    return slab;
+}
+
+// only the owning thread writes a slab, so a load and a store is enough
+static inline void bump(std::atomic<uint64_t> &counter, uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static int bucket_of(uint64_t ns)
+{
+    if (ns == 0)
+        return 0;
+    int bucket = 63 - __builtin_clzll(ns);
+    return bucket < PROBE_BUCKETS ? bucket : PROBE_BUCKETS - 1;
+}
+
+void probe_record(int id, uint64_t ns, uint64_t bytes)
+{
+    if (id < 0 || id >= PROBE_COUNT)
+        return;
+    probe_slab *slab = thread_slab();
+    bump(slab->calls[id], 1);
+    bump(slab->bytes[id], bytes);
+    bump(slab->totalNs[id], ns);
+    if (ns > slab->maxNs[id].load(std::memory_order_relaxed))
+        slab->maxNs[id].store(ns, std::memory_order_relaxed);
+    bump(slab->buckets[id][bucket_of(ns)], 1);
+}
+
+void probe_snapshot(probe_registry *const *registries, size_t count, probe_totals *totals)
+{
+    for (int id = 0; id < PROBE_COUNT; id++)
+        totals[id] = probe_totals();
+    for (size_t r = 0; r < count; r++) {
+        if (registries[r] == NULL)
+            continue;
+        for (probe_slab *slab = registries[r]->slabs.load(std::memory_order_acquire); slab != NULL;
+             slab = slab->next) {
+            for (int id = 0; id < PROBE_COUNT; id++) {
+                probe_totals &t = totals[id];
+                t.calls += slab->calls[id].load(std::memory_order_relaxed);
+                t.bytes += slab->bytes[id].load(std::memory_order_relaxed);
+                t.totalNs += slab->totalNs[id].load(std::memory_order_relaxed);
+                uint64_t maxNs = slab->maxNs[id].load(std::memory_order_relaxed);
+                if (maxNs > t.maxNs)
+                    t.maxNs = maxNs;
+                for (int b = 0; b < PROBE_BUCKETS; b++)
+                    t.buckets[b] += slab->buckets[id][b].load(std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+uint64_t probe_quantile_ns(const probe_totals *totals, double q)
+{
+    uint64_t events = 0;
+    for (int b = 0; b < PROBE_BUCKETS; b++)
+        events += totals->buckets[b];
+    if (events == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(q * (events - 1)) + 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < PROBE_BUCKETS; b++) {
+        seen += totals->buckets[b];
+        if (seen >= rank)
+            return b == PROBE_BUCKETS - 1 ? totals->maxNs : (2ull << b) - 1;
+    }
+    return totals->maxNs;
+}
+
+static void put64(std::vector<unsigned char> &out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        out.push_back((unsigned char)(value >> (8 * i)));
+}
+
+static void put32(std::vector<unsigned char> &out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out.push_back((unsigned char)(value >> (8 * i)));
+}
+
+std::vector<unsigned char> probe_export_binary(const probe_totals *totals)
+{
+    std::vector<unsigned char> out = {'P', 'R', 'B', '1'};
+    put32(out, PROBE_COUNT);
+    put32(out, PROBE_BUCKETS);
+    for (int id = 0; id < PROBE_COUNT; id++) {
+        put64(out, totals[id].calls);
+        put64(out, totals[id].bytes);
+        put64(out, totals[id].totalNs);
+        put64(out, totals[id].maxNs);
+        for (int b = 0; b < PROBE_BUCKETS; b++)
+            put64(out, totals[id].buckets[b]);
+    }
+    return out;
+}
+
+std::string probe_export_json(const probe_totals *totals)
+{
+    std::string json = "{";
+    char field[160];
+    for (int id = 0; id < PROBE_COUNT; id++) {
+        const probe_totals &t = totals[id];
+        snprintf(field, sizeof(field),
+                 "%s\"%s\":{\"calls\":%llu,\"bytes\":%llu,\"totalNs\":%llu,\"maxNs\":%llu,\"meanNs\":%llu,",
+                 id == 0 ? "" : ",", probeNames[id], (unsigned long long)t.calls, (unsigned long long)t.bytes,
+                 (unsigned long long)t.totalNs, (unsigned long long)t.maxNs,
+                 (unsigned long long)(t.calls > 0 ? t.totalNs / t.calls : 0));
+        json += field;
+        snprintf(field, sizeof(field), "\"p50Ns\":%llu,\"p95Ns\":%llu,\"p99Ns\":%llu,\"buckets\":{",
+                 (unsigned long long)probe_quantile_ns(&t, 0.5), (unsigned long long)probe_quantile_ns(&t, 0.95),
+                 (unsigned long long)probe_quantile_ns(&t, 0.99));
+        json += field;
+        // keyed by the bucket's lower bound in ns
+        bool first = true;
+        for (int b = 0; b < PROBE_BUCKETS; b++) {
+            if (t.buckets[b] == 0)
+                continue;
+            snprintf(field, sizeof(field), "%s\"%llu\":%llu", first ? "" : ",", b == 0 ? 0ull : 1ull << b,
+                     (unsigned long long)t.buckets[b]);
+            json += field;
+            first = false;
+        }
+        json += "}}";
+    }
+    json += "}";
+    return json;
+}
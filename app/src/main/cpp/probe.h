@@ -0,0 +1,83 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// hot-path instrumentation: call counts, bytes and log2 latency histograms per probe
+// every thread writes its own slab with plain relaxed stores (one writer, no read-modify-write,
+// no lock), slabs are chained into the registry of the library on first use and never freed,
+// and a snapshot sums them with relaxed loads, so a snapshot taken while threads are recording
+// may be a few events behind but is never torn per counter.
+// cipher-core is linked statically into both shared libraries, so each one has its own
+// registry; probe_snapshot merges any number of them (see probeSnapshot in native-lib).
+
+enum probe_id {
+    PROBE_JNI,          // instrumented JNI crossings, whole call including array copies
+    PROBE_AES_ENCRYPT,  // AES work inside the JNI calls
+    PROBE_AES_DECRYPT,
+    PROBE_AES_MODE,     // CBC, CTR and streams
+    PROBE_RC5_ENCRYPT,  // sessions, buffers and OTA frames
+    PROBE_RC5_DECRYPT,
+    PROBE_BEACON_PARSE,
+    PROBE_OTA_RTT,      // OTA frame handed out to its write completion
+    PROBE_COUNT
+};
+
+// bucket b counts latencies in [2^b, 2^(b+1)) ns, the last one everything from ~2 s up
+#define PROBE_BUCKETS 32
+
+struct probe_slab {
+    std::atomic<uint64_t> calls[PROBE_COUNT];
+    std::atomic<uint64_t> bytes[PROBE_COUNT];
+    std::atomic<uint64_t> totalNs[PROBE_COUNT];
+    std::atomic<uint64_t> maxNs[PROBE_COUNT];
+    std::atomic<uint64_t> buckets[PROBE_COUNT][PROBE_BUCKETS];
+    probe_slab *next;
+};
+
+struct probe_registry {
+    std::atomic<probe_slab *> slabs;
+};
+
+struct probe_totals {
+    uint64_t calls;
+    uint64_t bytes;
+    uint64_t totalNs;
+    uint64_t maxNs;
+    uint64_t buckets[PROBE_BUCKETS];
+};
+
+const char *probe_name(int id);
+int64_t probe_now_ns();
+// the registry this copy of cipher-core records into
+probe_registry *probe_local_registry();
+void probe_record(int id, uint64_t ns, uint64_t bytes);
+// totals must hold PROBE_COUNT entries
+void probe_snapshot(probe_registry *const *registries, size_t count, probe_totals *totals);
+// upper bound of the bucket holding the q quantile (0..1), 0 without calls
+uint64_t probe_quantile_ns(const probe_totals *totals, double q);
+
+// "PRB1", u32 PROBE_COUNT, u32 PROBE_BUCKETS, then per probe u64 calls, bytes, totalNs, maxNs
+// and the buckets, all little endian
+std::vector<unsigned char> probe_export_binary(const probe_totals *totals);
+// one object per probe with the counters, mean/p50/p95/p99 and the non-empty buckets
+std::string probe_export_json(const probe_totals *totals);
+
+// times the enclosing scope; bytes may be filled in before it ends
+struct probe_scope {
+    int id;
+    uint64_t bytes;
+    int64_t startNs;
+
+    explicit probe_scope(int probeId, uint64_t byteCount = 0)
+        : id(probeId), bytes(byteCount), startNs(probe_now_ns()) {}
+    ~probe_scope() { probe_record(id, probe_now_ns() - startNs, bytes); }
+    probe_scope(const probe_scope &) = delete;
+    probe_scope &operator=(const probe_scope &) = delete;
+};
+
+#endif //PROBE_H
@@ -0,0 +1,89 @@
+#include "rc5-core.h"
+
+// AVX2 RC5 kernel, 16 blocks per register pair
+// compiled with -mavx2, only entered after the CPU reported AVX2 at runtime
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+// per-lane rotate left as x * 2^n: the low half of the product is x << n, the high half
+// x >> (16 - n); 2^n comes from two 16-entry byte tables indexed by n
+static inline __m256i rotl16_avx2(__m256i x, __m256i n)
+{
+    const __m256i lo = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0, 0,
+                                        1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i hi = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, (char)128,
+                                        0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, (char)128);
+    __m256i index = _mm256_and_si256(n, _mm256_set1_epi16(15));
+    __m256i pow2 = _mm256_or_si256(_mm256_and_si256(_mm256_shuffle_epi8(lo, index), _mm256_set1_epi16(0xff)),
+                                   _mm256_slli_epi16(_mm256_shuffle_epi8(hi, index), 8));
+    return _mm256_or_si256(_mm256_mullo_epi16(x, pow2), _mm256_mulhi_epu16(x, pow2));
+}
+
+// 16 blocks in two registers -> A words and B words, packs/unpacks stay within 128-bit lanes
+// so join_avx2 restores the original block order
+static inline void split_avx2(const unsigned char *in, __m256i &A, __m256i &B)
+{
+    __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in));
+    __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in) + 1);
+    A = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(v0, 16), 16), _mm256_srai_epi32(_mm256_slli_epi32(v1, 16), 16));
+    B = _mm256_packs_epi32(_mm256_srai_epi32(v0, 16), _mm256_srai_epi32(v1, 16));
+}
+
+static inline void join_avx2(unsigned char *out, __m256i A, __m256i B)
+{
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm256_unpacklo_epi16(A, B));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out) + 1, _mm256_unpackhi_epi16(A, B));
+}
+
+static void avx2_encrypt_blocks(const WORD *S, const unsigned char *in, unsigned char *out, size_t blocks)
+{
+    size_t b = 0;
+    for (; b + 16 <= blocks; b += 16, in += 16 * RC5_ENC_BLOCK_SIZE, out += 16 * RC5_ENC_BLOCK_SIZE) {
+        __m256i A, B;
+        split_avx2(in, A, B);
+        A = _mm256_add_epi16(A, _mm256_set1_epi16(S[0]));
+        B = _mm256_add_epi16(B, _mm256_set1_epi16(S[1]));
+        for (int i = 1; i <= _round; i++) {
+            A = _mm256_add_epi16(rotl16_avx2(_mm256_xor_si256(A, B), B), _mm256_set1_epi16(S[2 * i]));
+            B = _mm256_add_epi16(rotl16_avx2(_mm256_xor_si256(B, A), A), _mm256_set1_epi16(S[2 * i + 1]));
+        }
+        join_avx2(out, A, B);
+    }
+    rc5_kernel_scalar()->encrypt_blocks(S, in, out, blocks - b);
+}
+
+static void avx2_decrypt_blocks(const WORD *S, const unsigned char *in, unsigned char *out, size_t blocks)
+{
+    const __m256i sixteen = _mm256_set1_epi16(16);
+    size_t b = 0;
+    for (; b + 16 <= blocks; b += 16, in += 16 * RC5_ENC_BLOCK_SIZE, out += 16 * RC5_ENC_BLOCK_SIZE) {
+        __m256i A, B;
+        split_avx2(in, A, B);
+        for (int i = _round; i > 0; i--) {
+            // rotate right by n == rotate left by 16 - n
+            B = _mm256_xor_si256(rotl16_avx2(_mm256_sub_epi16(B, _mm256_set1_epi16(S[2 * i + 1])), _mm256_sub_epi16(sixteen, A)), A);
+            A = _mm256_xor_si256(rotl16_avx2(_mm256_sub_epi16(A, _mm256_set1_epi16(S[2 * i])), _mm256_sub_epi16(sixteen, B)), B);
+        }
+        B = _mm256_sub_epi16(B, _mm256_set1_epi16(S[1]));
+        A = _mm256_sub_epi16(A, _mm256_set1_epi16(S[0]));
+        join_avx2(out, A, B);
+    }
+    rc5_kernel_scalar()->decrypt_blocks(S, in, out, blocks - b);
+}
+
+const rc5_kernel *rc5_kernel_avx2()
+{
+    static const rc5_kernel kernel = {"avx2", 16, avx2_encrypt_blocks, avx2_decrypt_blocks};
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported ? &kernel : NULL;
+}
+
+#else
+
+const rc5_kernel *rc5_kernel_avx2()
+{
+    return NULL;
+}
+
+#endif
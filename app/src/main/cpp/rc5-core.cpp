@@ -0,0 +1,198 @@
+#include <cstring>
+#include "rc5-core.h"
+
+WORD _S[_sTableSize]; //S table
+
+const WORD _P = (WORD)0xb7e1; //magic constants
+const WORD _Q = (WORD)0x9e37; //magic constants
+WORD CyclicRightShift(WORD x, WORD y)
+{
+    return (x >> (y&(_wordLengthInBit - 1))) | (x << (_wordLengthInBit - (y&(_wordLengthInBit - 1))));
+}
+
+WORD CyclicLeftShift(WORD x, WORD y)
+{
+    return (x << (y&(_wordLengthInBit - 1))) | (x >> (_wordLengthInBit - (y&(_wordLengthInBit - 1))));
+}
+// expand keyData into the key table S, only S is written so any number of tables can be
+// built concurrently
+void cipher_rc5_key_schedule(const unsigned char *keyData, WORD *S)
+{
+    int i = 0, j= 0, k =0;
+    WORD A = 0, B = 0;
+    WORD u = _wordLengthInBit / 8;
+    WORD L[_keyLengthInWord];
+    memset(L, 0, sizeof(L));
+    for (i = _keyLengthInByte - 1; i != -1; i--)
+        L[i / u] = (L[i / u] << 8) + keyData[i];
+    for (i = 1, S[0] = _P; i < _sTableSize; i++)
+        S[i] = S[i - 1] + _Q;
+    for (A = B = i = j = k = 0; k < 3 * _sTableSize; k++)
+    {
+        A = S[i] = CyclicLeftShift(S[i] + (A + B), 3);
+        B = L[j] = CyclicLeftShift(L[j] + (A + B), A + B);
+        i = (i + 1) % _sTableSize;
+        j = (j + 1) % _keyLengthInWord;
+    }
+    memset(L, 0, sizeof(L));
+}
+
+void cipher_rc5_setup(unsigned char *keyData)
+{
+    cipher_rc5_key_schedule(keyData, _S);
+}
+
+
+
+void cipher_rc5_encrypt(const WORD *pt, WORD *ct)
+{
+    int i = 0;
+    WORD A = pt[0] + _S[0], B = pt[1] + _S[1];
+    for (i = 1; i <= _round; i++)
+    {
+        A = CyclicLeftShift((WORD)(A^B), B) + _S[2 * i];
+        B = CyclicLeftShift((WORD)(B^A), A) + _S[2 * i + 1];
+    }
+    ct[0] = A;
+    ct[1] = B;
+}
+void cipher_rc5_Decrypt(const WORD * ct, WORD *pt)//must input WORD x[2] for in and out
+{
+    int i;
+    WORD B = ct[1], A = ct[0];
+    for (i = _round; i > 0; i--)
+    {
+        B = CyclicRightShift(B - _S[2 * i + 1], A) ^ A;
+        A = CyclicRightShift(A - _S[2 * i], B) ^ B;
+    }
+    pt[1] = B - _S[1];
+    pt[0] = A - _S[0];
+}
+
+static void scalar_encrypt_blocks(const WORD *S, const unsigned char *in, unsigned char *out, size_t blocks)
+{
+    int i = 0;
+    WORD w[2];
+    for (size_t b = 0; b < blocks; b++)
+    {
+        memcpy(w, in + b * RC5_ENC_BLOCK_SIZE, RC5_ENC_BLOCK_SIZE);
+        WORD A = w[0] + S[0], B = w[1] + S[1];
+        for (i = 1; i <= _round; i++)
+        {
+            A = CyclicLeftShift((WORD)(A^B), B) + S[2 * i];
+            B = CyclicLeftShift((WORD)(B^A), A) + S[2 * i + 1];
+        }
+        w[0] = A;
+        w[1] = B;
+        memcpy(out + b * RC5_ENC_BLOCK_SIZE, w, RC5_ENC_BLOCK_SIZE);
+    }
+}
+
+static void scalar_decrypt_blocks(const WORD *S, const unsigned char *in, unsigned char *out, size_t blocks)
+{
+    int i;
+    WORD w[2];
+    for (size_t b = 0; b < blocks; b++)
+    {
+        memcpy(w, in + b * RC5_ENC_BLOCK_SIZE, RC5_ENC_BLOCK_SIZE);
+        WORD B = w[1], A = w[0];
+        for (i = _round; i > 0; i--)
+        {
+            B = CyclicRightShift(B - S[2 * i + 1], A) ^ A;
+            A = CyclicRightShift(A - S[2 * i], B) ^ B;
+        }
+        w[1] = B - S[1];
+        w[0] = A - S[0];
+        memcpy(out + b * RC5_ENC_BLOCK_SIZE, w, RC5_ENC_BLOCK_SIZE);
+    }
+}
+
+const rc5_kernel *rc5_kernel_scalar()
+{
+    static const rc5_kernel kernel = {"scalar", 1, scalar_encrypt_blocks, scalar_decrypt_blocks};
+    return &kernel;
+}
+
+const rc5_kernel *rc5_kernel_select()
+{
+    static const rc5_kernel *selected = []() {
+        const rc5_kernel *kernel = rc5_kernel_avx2();
+        if (kernel == NULL)
+            kernel = rc5_kernel_sse2();
+        if (kernel == NULL)
+            kernel = rc5_kernel_neon();
+        if (kernel == NULL)
+            kernel = rc5_kernel_scalar();
+        return kernel;
+    }();
+    return selected;
+}
+
+// encrypt one RC5_ENC_BLOCK_SIZE block from in to out (in and out may alias)
+void cipher_rc5_encrypt_block(const unsigned char *in, unsigned char *out)
+{
+    scalar_encrypt_blocks(_S, in, out, 1);
+}
+
+// decrypt one RC5_ENC_BLOCK_SIZE block from in to out (in and out may alias)
+void cipher_rc5_decrypt_block(const unsigned char *in, unsigned char *out)
+{
+    scalar_decrypt_blocks(_S, in, out, 1);
+}
+
+// encrypt every whole RC5_ENC_BLOCK_SIZE block of in into out
+// trailing bytes that do not fill a block are skipped, same as sendBlock always did
+// returns the number of bytes written to out
+size_t cipher_rc5_encrypt_buffer(const unsigned char *in, unsigned char *out, size_t length)
+{
+    size_t blocks = length / RC5_ENC_BLOCK_SIZE;
+    rc5_kernel_select()->encrypt_blocks(_S, in, out, blocks);
+    return blocks * RC5_ENC_BLOCK_SIZE;
+}
+
+size_t cipher_rc5_decrypt_buffer(const unsigned char *in, unsigned char *out, size_t length)
+{
+    size_t blocks = length / RC5_ENC_BLOCK_SIZE;
+    rc5_kernel_select()->decrypt_blocks(_S, in, out, blocks);
+    return blocks * RC5_ENC_BLOCK_SIZE;
+}
+
+// size of the OTA frame for a chunk: one length byte followed by the encrypted whole blocks
+size_t cipher_rc5_frame_size(size_t chunkSize)
+{
+    return 1 + chunkSize - chunkSize % RC5_ENC_BLOCK_SIZE;
+}
+
+// build the OTA frame sendBlock writes for one chunk of the image
+size_t cipher_rc5_encrypt_frame(const unsigned char *chunk, size_t chunkSize, unsigned char *frame)
+{
+    frame[0] = (unsigned char)chunkSize;
+    return 1 + cipher_rc5_encrypt_buffer(chunk, frame + 1, chunkSize);
+}
+
+void rc5_session_init(rc5_session *session, const unsigned char *keyData)
+{
+    cipher_rc5_key_schedule(keyData, session->S);
+    session->kernel = rc5_kernel_select();
+}
+
+size_t rc5_session_encrypt(const rc5_session *session, const unsigned char *in, unsigned char *out, size_t length)
+{
+    size_t blocks = length / RC5_ENC_BLOCK_SIZE;
+    session->kernel->encrypt_blocks(session->S, in, out, blocks);
+    return blocks * RC5_ENC_BLOCK_SIZE;
+}
+
+size_t rc5_session_decrypt(const rc5_session *session, const unsigned char *in, unsigned char *out, size_t length)
+{
+    size_t blocks = length / RC5_ENC_BLOCK_SIZE;
+    session->kernel->decrypt_blocks(session->S, in, out, blocks);
+    return blocks * RC5_ENC_BLOCK_SIZE;
+}
+
+size_t rc5_session_encrypt_frame(const rc5_session *session, const unsigned char *chunk, size_t chunkSize,
+                                 unsigned char *frame)
+{
+    frame[0] = (unsigned char)chunkSize;
+    return 1 + rc5_session_encrypt(session, chunk, frame + 1, chunkSize);
+}
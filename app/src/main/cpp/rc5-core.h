@@ -0,0 +1,65 @@
+#ifndef RC5_CORE_H
+#define RC5_CORE_H
+
+#include <stddef.h>
+
+// RC5-16/12/16: 16-bit words, 12 rounds, 16 byte key
+#define RC5_ENC_BLOCK_SIZE  4
+
+typedef unsigned short WORD;
+#define _wordLengthInBit sizeof(WORD) * 8//w
+#define _round 12 //r
+#define _keyLengthInByte 16 //b
+#define _keyLengthInWord 8//_keyLengthInByte * 8 / _wordLengthInBit; //c: key length in
+#define _sTableSize 26 //2 * (_round + 1); // t: S table size
+
+// key table behind the legacy single-key calls (cipher_rc5_setup and everything using it
+// without a session); rc5_session below carries its own table instead
+extern WORD _S[_sTableSize]; //S table
+
+WORD CyclicRightShift(WORD x, WORD y);
+WORD CyclicLeftShift(WORD x, WORD y);
+
+void cipher_rc5_key_schedule(const unsigned char *keyData, WORD *S);
+void cipher_rc5_setup(unsigned char *keyData);
+void cipher_rc5_encrypt(const WORD *pt, WORD *ct);
+void cipher_rc5_Decrypt(const WORD * ct, WORD *pt);
+
+// a batch RC5 kernel, every kernel is bit-identical to the scalar one
+// blocks are processed from in to out (which may alias) with the expanded key table S
+struct rc5_kernel {
+    const char *name;
+    size_t lanes;   // blocks processed per instruction stream
+    void (*encrypt_blocks)(const WORD *S, const unsigned char *in, unsigned char *out, size_t blocks);
+    void (*decrypt_blocks)(const WORD *S, const unsigned char *in, unsigned char *out, size_t blocks);
+};
+
+// the SIMD kernels return NULL when not built for or not supported by this CPU
+const rc5_kernel *rc5_kernel_scalar();
+const rc5_kernel *rc5_kernel_sse2();
+const rc5_kernel *rc5_kernel_avx2();
+const rc5_kernel *rc5_kernel_neon();
+// widest kernel available on this CPU, detected once
+const rc5_kernel *rc5_kernel_select();
+
+void cipher_rc5_encrypt_block(const unsigned char *in, unsigned char *out);
+void cipher_rc5_decrypt_block(const unsigned char *in, unsigned char *out);
+size_t cipher_rc5_encrypt_buffer(const unsigned char *in, unsigned char *out, size_t length);
+size_t cipher_rc5_decrypt_buffer(const unsigned char *in, unsigned char *out, size_t length);
+size_t cipher_rc5_frame_size(size_t chunkSize);
+size_t cipher_rc5_encrypt_frame(const unsigned char *chunk, size_t chunkSize, unsigned char *frame);
+
+// one OTA connection's expanded key, read-only after rc5_session_init so sessions for
+// different devices (or several threads on one session) never share mutable state
+struct rc5_session {
+    WORD S[_sTableSize];
+    const rc5_kernel *kernel;
+};
+
+void rc5_session_init(rc5_session *session, const unsigned char *keyData);
+size_t rc5_session_encrypt(const rc5_session *session, const unsigned char *in, unsigned char *out, size_t length);
+size_t rc5_session_decrypt(const rc5_session *session, const unsigned char *in, unsigned char *out, size_t length);
+size_t rc5_session_encrypt_frame(const rc5_session *session, const unsigned char *chunk, size_t chunkSize,
+                                 unsigned char *frame);
+
+#endif //RC5_CORE_H
@@ -0,0 +1,171 @@
+#include "rc5-core.h"
+
+// baseline SIMD RC5 kernels: SSE2 on x86, NEON on ARM
+// the A and B words of a group of blocks are split into one vector each so every lane runs
+// its own block, including the data-dependent rotates; a partial group falls back to scalar
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+// per-lane rotate left as x * 2^n: the low half of the product is x << n, the high half
+// x >> (16 - n); SSE2 has no per-lane shifts, so 2^n is built as a float exponent in 32-bit
+// lanes and packed back, biased by 0x8000 so 2^15 survives the signed saturation
+static inline __m128i rotl16_sse2(__m128i x, __m128i n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi32(0x8000);
+    n = _mm_add_epi16(_mm_and_si128(n, _mm_set1_epi16(15)), _mm_set1_epi16(127));
+    __m128i lo = _mm_cvtps_epi32(_mm_castsi128_ps(_mm_slli_epi32(_mm_unpacklo_epi16(n, zero), 23)));
+    __m128i hi = _mm_cvtps_epi32(_mm_castsi128_ps(_mm_slli_epi32(_mm_unpackhi_epi16(n, zero), 23)));
+    __m128i pow2 = _mm_add_epi16(_mm_packs_epi32(_mm_sub_epi32(lo, bias), _mm_sub_epi32(hi, bias)),
+                                 _mm_set1_epi16((short)0x8000));
+    return _mm_or_si128(_mm_mullo_epi16(x, pow2), _mm_mulhi_epu16(x, pow2));
+}
+
+// 8 blocks in two registers -> A words and B words (sign extension keeps packs_epi32 exact)
+static inline void split_sse2(const unsigned char *in, __m128i &A, __m128i &B)
+{
+    __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in) + 1);
+    A = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(v0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(v1, 16), 16));
+    B = _mm_packs_epi32(_mm_srai_epi32(v0, 16), _mm_srai_epi32(v1, 16));
+}
+
+static inline void join_sse2(unsigned char *out, __m128i A, __m128i B)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi16(A, B));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out) + 1, _mm_unpackhi_epi16(A, B));
+}
+
+static void sse2_encrypt_blocks(const WORD *S, const unsigned char *in, unsigned char *out, size_t blocks)
+{
+    size_t b = 0;
+    // two groups of 8 lanes interleaved to hide the rotate latency
+    for (; b + 16 <= blocks; b += 16, in += 16 * RC5_ENC_BLOCK_SIZE, out += 16 * RC5_ENC_BLOCK_SIZE) {
+        __m128i A0, B0, A1, B1;
+        split_sse2(in, A0, B0);
+        split_sse2(in + 8 * RC5_ENC_BLOCK_SIZE, A1, B1);
+        A0 = _mm_add_epi16(A0, _mm_set1_epi16(S[0])); B0 = _mm_add_epi16(B0, _mm_set1_epi16(S[1]));
+        A1 = _mm_add_epi16(A1, _mm_set1_epi16(S[0])); B1 = _mm_add_epi16(B1, _mm_set1_epi16(S[1]));
+        for (int i = 1; i <= _round; i++) {
+            __m128i s0 = _mm_set1_epi16(S[2 * i]), s1 = _mm_set1_epi16(S[2 * i + 1]);
+            A0 = _mm_add_epi16(rotl16_sse2(_mm_xor_si128(A0, B0), B0), s0);
+            A1 = _mm_add_epi16(rotl16_sse2(_mm_xor_si128(A1, B1), B1), s0);
+            B0 = _mm_add_epi16(rotl16_sse2(_mm_xor_si128(B0, A0), A0), s1);
+            B1 = _mm_add_epi16(rotl16_sse2(_mm_xor_si128(B1, A1), A1), s1);
+        }
+        join_sse2(out, A0, B0);
+        join_sse2(out + 8 * RC5_ENC_BLOCK_SIZE, A1, B1);
+    }
+    rc5_kernel_scalar()->encrypt_blocks(S, in, out, blocks - b);
+}
+
+static void sse2_decrypt_blocks(const WORD *S, const unsigned char *in, unsigned char *out, size_t blocks)
+{
+    const __m128i sixteen = _mm_set1_epi16(16);
+    size_t b = 0;
+    for (; b + 16 <= blocks; b += 16, in += 16 * RC5_ENC_BLOCK_SIZE, out += 16 * RC5_ENC_BLOCK_SIZE) {
+        __m128i A0, B0, A1, B1;
+        split_sse2(in, A0, B0);
+        split_sse2(in + 8 * RC5_ENC_BLOCK_SIZE, A1, B1);
+        for (int i = _round; i > 0; i--) {
+            __m128i s0 = _mm_set1_epi16(S[2 * i]), s1 = _mm_set1_epi16(S[2 * i + 1]);
+            // rotate right by n == rotate left by 16 - n
+            B0 = _mm_xor_si128(rotl16_sse2(_mm_sub_epi16(B0, s1), _mm_sub_epi16(sixteen, A0)), A0);
+            B1 = _mm_xor_si128(rotl16_sse2(_mm_sub_epi16(B1, s1), _mm_sub_epi16(sixteen, A1)), A1);
+            A0 = _mm_xor_si128(rotl16_sse2(_mm_sub_epi16(A0, s0), _mm_sub_epi16(sixteen, B0)), B0);
+            A1 = _mm_xor_si128(rotl16_sse2(_mm_sub_epi16(A1, s0), _mm_sub_epi16(sixteen, B1)), B1);
+        }
+        join_sse2(out, _mm_sub_epi16(A0, _mm_set1_epi16(S[0])), _mm_sub_epi16(B0, _mm_set1_epi16(S[1])));
+        join_sse2(out + 8 * RC5_ENC_BLOCK_SIZE, _mm_sub_epi16(A1, _mm_set1_epi16(S[0])), _mm_sub_epi16(B1, _mm_set1_epi16(S[1])));
+    }
+    rc5_kernel_scalar()->decrypt_blocks(S, in, out, blocks - b);
+}
+
+const rc5_kernel *rc5_kernel_sse2()
+{
+    static const rc5_kernel kernel = {"sse2", 16, sse2_encrypt_blocks, sse2_decrypt_blocks};
+    return &kernel;
+}
+
+#else
+
+const rc5_kernel *rc5_kernel_sse2()
+{
+    return NULL;
+}
+
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+
+// per-lane rotate left, NEON shifts take a signed count per lane so n - 16 shifts right
+static inline uint16x8_t rotl16_neon(uint16x8_t x, uint16x8_t n)
+{
+    int16x8_t count = vreinterpretq_s16_u16(vandq_u16(n, vdupq_n_u16(15)));
+    return vorrq_u16(vshlq_u16(x, count), vshlq_u16(x, vsubq_s16(count, vdupq_n_s16(16))));
+}
+
+static void neon_encrypt_blocks(const WORD *S, const unsigned char *in, unsigned char *out, size_t blocks)
+{
+    size_t b = 0;
+    // two groups of 8 lanes interleaved to hide the rotate latency
+    for (; b + 16 <= blocks; b += 16, in += 16 * RC5_ENC_BLOCK_SIZE, out += 16 * RC5_ENC_BLOCK_SIZE) {
+        uint16x8x2_t v0 = vld2q_u16(reinterpret_cast<const uint16_t *>(in));
+        uint16x8x2_t v1 = vld2q_u16(reinterpret_cast<const uint16_t *>(in) + 16);
+        uint16x8_t A0 = vaddq_u16(v0.val[0], vdupq_n_u16(S[0])), B0 = vaddq_u16(v0.val[1], vdupq_n_u16(S[1]));
+        uint16x8_t A1 = vaddq_u16(v1.val[0], vdupq_n_u16(S[0])), B1 = vaddq_u16(v1.val[1], vdupq_n_u16(S[1]));
+        for (int i = 1; i <= _round; i++) {
+            uint16x8_t s0 = vdupq_n_u16(S[2 * i]), s1 = vdupq_n_u16(S[2 * i + 1]);
+            A0 = vaddq_u16(rotl16_neon(veorq_u16(A0, B0), B0), s0);
+            A1 = vaddq_u16(rotl16_neon(veorq_u16(A1, B1), B1), s0);
+            B0 = vaddq_u16(rotl16_neon(veorq_u16(B0, A0), A0), s1);
+            B1 = vaddq_u16(rotl16_neon(veorq_u16(B1, A1), A1), s1);
+        }
+        v0.val[0] = A0; v0.val[1] = B0;
+        v1.val[0] = A1; v1.val[1] = B1;
+        vst2q_u16(reinterpret_cast<uint16_t *>(out), v0);
+        vst2q_u16(reinterpret_cast<uint16_t *>(out) + 16, v1);
+    }
+    rc5_kernel_scalar()->encrypt_blocks(S, in, out, blocks - b);
+}
+
+static void neon_decrypt_blocks(const WORD *S, const unsigned char *in, unsigned char *out, size_t blocks)
+{
+    const uint16x8_t sixteen = vdupq_n_u16(16);
+    size_t b = 0;
+    for (; b + 16 <= blocks; b += 16, in += 16 * RC5_ENC_BLOCK_SIZE, out += 16 * RC5_ENC_BLOCK_SIZE) {
+        uint16x8x2_t v0 = vld2q_u16(reinterpret_cast<const uint16_t *>(in));
+        uint16x8x2_t v1 = vld2q_u16(reinterpret_cast<const uint16_t *>(in) + 16);
+        uint16x8_t A0 = v0.val[0], B0 = v0.val[1], A1 = v1.val[0], B1 = v1.val[1];
+        for (int i = _round; i > 0; i--) {
+            uint16x8_t s0 = vdupq_n_u16(S[2 * i]), s1 = vdupq_n_u16(S[2 * i + 1]);
+            // rotate right by n == rotate left by 16 - n
+            B0 = veorq_u16(rotl16_neon(vsubq_u16(B0, s1), vsubq_u16(sixteen, A0)), A0);
+            B1 = veorq_u16(rotl16_neon(vsubq_u16(B1, s1), vsubq_u16(sixteen, A1)), A1);
+            A0 = veorq_u16(rotl16_neon(vsubq_u16(A0, s0), vsubq_u16(sixteen, B0)), B0);
+            A1 = veorq_u16(rotl16_neon(vsubq_u16(A1, s0), vsubq_u16(sixteen, B1)), B1);
+        }
+        v0.val[0] = vsubq_u16(A0, vdupq_n_u16(S[0])); v0.val[1] = vsubq_u16(B0, vdupq_n_u16(S[1]));
+        v1.val[0] = vsubq_u16(A1, vdupq_n_u16(S[0])); v1.val[1] = vsubq_u16(B1, vdupq_n_u16(S[1]));
+        vst2q_u16(reinterpret_cast<uint16_t *>(out), v0);
+        vst2q_u16(reinterpret_cast<uint16_t *>(out) + 16, v1);
+    }
+    rc5_kernel_scalar()->decrypt_blocks(S, in, out, blocks - b);
+}
+
+const rc5_kernel *rc5_kernel_neon()
+{
+    static const rc5_kernel kernel = {"neon", 16, neon_encrypt_blocks, neon_decrypt_blocks};
+    return &kernel;
+}
+
+#else
+
+const rc5_kernel *rc5_kernel_neon()
+{
+    return NULL;
+}
+
+#endif
@@ -5,16 +5,47 @@ import android.bluetooth.BluetoothAdapter
 import android.bluetooth.le.AdvertiseCallback
 import android.bluetooth.le.AdvertiseData
 import android.bluetooth.le.AdvertiseSettings
+import android.bluetooth.le.BluetoothLeAdvertiser
 import android.os.Bundle
+import android.os.Handler
+import android.os.Looper
 import android.os.ParcelUuid
 import android.util.Log
 import androidx.appcompat.app.AppCompatActivity
+import com.trial.bluetoothtrials.Utility.AdvertisementRotator
 import com.trial.bluetoothtrials.Utility.PreferenceController
 import kotlinx.android.synthetic.main.activity_advertisement.*
+import java.nio.ByteBuffer
 import java.util.*
 
 
 class AdvertisementActivity : AppCompatActivity() {
+    private var aesContext: Long = 0
+    private var rotator: AdvertisementRotator? = null
+    private var advertiser: BluetoothLeAdvertiser? = null
+    private lateinit var settings: AdvertiseSettings
+    private val payload = ByteArray(AdvertisementRotator.ADV_PAYLOAD_SIZE)
+    private val rotateHandler = Handler(Looper.getMainLooper())
+    private val rotate = object : Runnable {
+        override fun run() {
+            val r = rotator ?: return
+            // the payload was encrypted ahead of time, this is only a copy
+            if (!r.payload(payload)) Log.w("BLE", "advertisement payload not cached")
+            advertiser?.stopAdvertising(advertisingCallback)
+            advertiser?.startAdvertising(settings, advertiseData(payload.copyOf()), advertisingCallback)
+            rotateHandler.postDelayed(this, r.intervalMs.toLong())
+        }
+    }
+    private val advertisingCallback: AdvertiseCallback = object : AdvertiseCallback() {
+        override fun onStartSuccess(settingsInEffect: AdvertiseSettings) {
+            super.onStartSuccess(settingsInEffect)
+        }
+
+        override fun onStartFailure(errorCode: Int) {
+            Log.e("BLE", "Advertising onStartFailure: $errorCode")
+            super.onStartFailure(errorCode)
+        }
+    }
 
     init {
         System.loadLibrary("aes-lib")
@@ -23,13 +54,14 @@ class AdvertisementActivity : AppCompatActivity() {
         super.onCreate(savedInstanceState)
         setContentView(R.layout.activity_advertisement)
         val key= PreferenceController.instance?.getKeyString(this, "Key")!!.decodeHex()
-        val a= aesEncrypt(key, key)
-        val b= aesDecrypt(a, key)
-        if (key != null) {
+        aesContext = aesCreateContext(key)
+        val a= aesContextEncrypt(aesContext, key)
+        val b= a?.let { aesContextDecrypt(aesContext, it) }
+        if (a != null) {
             textView.text=a.toString()
         }
-        val advertiser = BluetoothAdapter.getDefaultAdapter().bluetoothLeAdvertiser
-        val settings = AdvertiseSettings.Builder()
+        advertiser = BluetoothAdapter.getDefaultAdapter().bluetoothLeAdvertiser
+        settings = AdvertiseSettings.Builder()
             .setAdvertiseMode(AdvertiseSettings.ADVERTISE_MODE_LOW_LATENCY)
             .setTxPowerLevel(AdvertiseSettings.ADVERTISE_TX_POWER_HIGH)
             .setConnectable(false)
@@ -37,34 +69,62 @@ class AdvertisementActivity : AppCompatActivity() {
 
         val pUuid = ParcelUuid(UUID.fromString(getString(R.string.ble_uuid)))
 
-        val data = AdvertiseData.Builder()
-            .setIncludeDeviceName(false)
-            .addManufacturerData(0x197.toInt(), byteArrayOf(0x01,0x02))
-//            .addServiceData(pUuid, a)
-            .build()
-
-        val advertisingCallback: AdvertiseCallback = object : AdvertiseCallback() {
-            override fun onStartSuccess(settingsInEffect: AdvertiseSettings) {
-                super.onStartSuccess(settingsInEffect)
-            }
-
-            override fun onStartFailure(errorCode: Int) {
-                Log.e("BLE", "Advertising onStartFailure: $errorCode")
-                super.onStartFailure(errorCode)
-            }
+        // the identity is the upper half of the service uuid, every payload decrypts to it and its slot
+        val identity = ByteBuffer.allocate(8).putLong(pUuid.uuid.mostSignificantBits).array()
+        rotator = AdvertisementRotator.create(key, identity, ROTATE_INTERVAL_MS)
+        if (rotator != null) {
+            rotator?.start()
+            rotateHandler.post(rotate)
+        } else {
+            advertiser?.startAdvertising(settings, advertiseData(byteArrayOf(0x01,0x02)), advertisingCallback)
         }
-
-        advertiser.startAdvertising(settings, data, advertisingCallback)
 //        val d= a?.toByteArray(Charset.defaultCharset())
 //        Log.d("Encrypted value", d.toString())
 //        val e=key?.let { AesEncryption.shared?.decrypt(a, it) }
 //        Log.d("decrypt",e.toString())
     }
 
+    private fun advertiseData(manufacturerData: ByteArray): AdvertiseData = AdvertiseData.Builder()
+        .setIncludeDeviceName(false)
+        .addManufacturerData(0x197.toInt(), manufacturerData)
+//            .addServiceData(pUuid, a)
+        .build()
 
+    override fun onDestroy() {
+        super.onDestroy()
+        rotateHandler.removeCallbacks(rotate)
+        advertiser?.stopAdvertising(advertisingCallback)
+        rotator?.stats()?.let {
+            Log.d("BLE", "advertisement payloads: ${it[0]} generated at ${it[6]}/s, ${it[3]} hits, ${it[4]} misses")
+        }
+        rotator?.close()
+        rotator = null
+        aesDestroyContext(aesContext)
+        aesContext = 0
+    }
 }
+// sub-second identity rotation for phones acting as test beacons
+const val ROTATE_INTERVAL_MS = 500
+const val AES_MODE_ECB = 0
+const val AES_MODE_CBC = 1
+const val AES_MODE_CTR = 2
+
 fun String.decodeHex():ByteArray=chunked(2).map { it.toInt(16).toByte() }.toByteArray()
 
 
 external fun aesDecrypt(entry: ByteArray, key: ByteArray): ByteArray
-external fun aesEncrypt(entry: ByteArray, key: ByteArray): ByteArray
\ No newline at end of file
+external fun aesEncrypt(entry: ByteArray, key: ByteArray): ByteArray
+// 0 when the key is not 16, 24 or 32 bytes; the context calls return null or -1 for it
+external fun aesCreateContext(key: ByteArray): Long
+external fun aesDestroyContext(context: Long)
+external fun aesContextEncrypt(context: Long, entry: ByteArray): ByteArray?
+external fun aesContextDecrypt(context: Long, entry: ByteArray): ByteArray?
+// in place over the whole blocks of [offset, offset + length), with no allocation per call; the
+// buffer must be direct. Returns the bytes processed, -1 for a bad context, buffer or range
+external fun aesContextCryptDirect(context: Long, encrypt: Boolean, buffer: ByteBuffer, offset: Int, length: Int): Int
+// same over a heap array, pinned for the duration of the call
+external fun aesContextCryptArray(context: Long, encrypt: Boolean, array: ByteArray, offset: Int, length: Int): Int
+external fun aesCipher(mode: Int, encrypt: Boolean, key: ByteArray, iv: ByteArray?, entry: ByteArray): ByteArray?
+external fun aesStreamCreate(mode: Int, encrypt: Boolean, key: ByteArray, iv: ByteArray?): Long
+external fun aesStreamUpdate(stream: Long, entry: ByteArray): ByteArray?
+external fun aesStreamFinal(stream: Long): Boolean
@@ -0,0 +1,67 @@
+package com.trial.bluetoothtrials
+
+import android.os.Parcel
+import android.os.Parcelable
+import java.nio.ByteBuffer
+
+const val BEACON_STATUS_INSIDE = 0x04
+const val BEACON_STATUS_OUTSIDE = 0x05
+const val BEACON_STATUS_FAILURE = 0x06
+// size of one native beacon_report in the report buffer
+const val BEACON_REPORT_SIZE = 28
+
+// locator beacon decoded natively from the raw scan record, see beacon-parser.h
+data class BeaconReport(val tagId: Long, val status: Int, val locatorIds: LongArray, val distancesCm: IntArray,
+                        val errorCode: Int, val failureCount: Int) : Parcelable {
+    constructor(parcel: Parcel) : this(
+        parcel.readLong(),
+        parcel.readInt(),
+        parcel.createLongArray()!!,
+        parcel.createIntArray()!!,
+        parcel.readInt(),
+        parcel.readInt()
+    )
+
+    // hex id as it reads on air, matching the scan record text
+    fun locatorHex(i: Int): String = String.format("%08X", locatorIds[i])
+
+    fun distanceMetres(i: Int): Float = distancesCm[i] / 100f
+
+    override fun writeToParcel(parcel: Parcel, flags: Int) {
+        parcel.writeLong(tagId)
+        parcel.writeInt(status)
+        parcel.writeLongArray(locatorIds)
+        parcel.writeIntArray(distancesCm)
+        parcel.writeInt(errorCode)
+        parcel.writeInt(failureCount)
+    }
+
+    override fun describeContents(): Int {
+        return 0
+    }
+
+    companion object CREATOR : Parcelable.Creator<BeaconReport> {
+        override fun createFromParcel(parcel: Parcel): BeaconReport {
+            return BeaconReport(parcel)
+        }
+
+        override fun newArray(size: Int): Array<BeaconReport?> {
+            return arrayOfNulls(size)
+        }
+
+        // reads the native struct at offset, buffer must be in native byte order
+        fun read(buffer: ByteBuffer, offset: Int): BeaconReport {
+            val locatorCount = buffer.get(offset + 27).toInt() and 0xff
+            return BeaconReport(
+                buffer.getInt(offset).toLong() and 0xffffffffL,
+                buffer.get(offset + 24).toInt() and 0xff,
+                LongArray(locatorCount) { buffer.getInt(offset + 4 + 4 * it).toLong() and 0xffffffffL },
+                IntArray(locatorCount) { buffer.getShort(offset + 16 + 2 * it).toInt() and 0xffff },
+                buffer.get(offset + 25).toInt() and 0xff,
+                buffer.get(offset + 26).toInt() and 0xff
+            )
+        }
+
+        fun index(buffer: ByteBuffer, offset: Int): Int = buffer.getShort(offset + 22).toInt() and 0xffff
+    }
+}
@@ -14,6 +14,7 @@ import androidx.recyclerview.widget.RecyclerView
 class CustomAdapter(private val dataSet: ArrayList<Device>,val itemClick: ItemClick) :
         RecyclerView.Adapter<CustomAdapter.ViewHolder>(),Filterable {
     private lateinit var dataFilterSet: ArrayList<Device>
+    private var constraint: CharSequence? = null
 
     /**
      * Provide a reference to the type of views that you are using
@@ -62,7 +63,7 @@ class CustomAdapter(private val dataSet: ArrayList<Device>,val itemClick: ItemCl
             viewHolder.connect.visibility=View.GONE
         viewHolder.connect.setOnClickListener(View.OnClickListener {
 
-            itemClick.onItemClick(dataSet[position])
+            itemClick.onItemClick(dataFilterSet[position])
         })
     }
     init {
@@ -72,62 +73,76 @@ class CustomAdapter(private val dataSet: ArrayList<Device>,val itemClick: ItemCl
     override fun getItemCount(): Int {
         return dataFilterSet.size
     }
-    override fun getFilter(): Filter {
-        return object : Filter() {
-            override fun performFiltering(constraint: CharSequence?): FilterResults {
-                val charSearch = constraint.toString()
-                dataFilterSet=dataSet
-                if (charSearch.isEmpty()||charSearch.equals("N/A,N/A,N/A")) {
-                    dataFilterSet = dataSet
-                } else {
-                    var resultList = ArrayList<Device>()
-                    for (row in dataFilterSet) {
-                        if(!constraint.toString().split(",")[0].equals("N/A")){
-                            if (row.name!!.toLowerCase().contains(constraint.toString().split(",")[0].toLowerCase())) {
-                                resultList.add(row)
-                            }
-                        }
+    // a filter is typed, so positions are rows of the filtered list and not of dataSet
+    fun isFiltered(): Boolean = dataFilterSet !== dataSet
 
-                    }
-                    if(!resultList.isEmpty()) {
-                        dataFilterSet = resultList
+    // runs the current filter again over dataSet on the calling thread, for rows added or changed
+    fun refilter() {
+        dataFilterSet = filterDevices(constraint ?: "")
+        notifyDataSetChanged()
+    }
 
+    private fun filterDevices(constraint: CharSequence?): ArrayList<Device> {
+        val charSearch = constraint.toString()
+        var dataFilterSet=dataSet
+        if (charSearch.isEmpty()||charSearch.equals("N/A,N/A,N/A")) {
+            dataFilterSet = dataSet
+        } else {
+            var resultList = ArrayList<Device>()
+            for (row in dataFilterSet) {
+                if(!constraint.toString().split(",")[0].equals("N/A")){
+                    if (row.name!!.toLowerCase().contains(constraint.toString().split(",")[0].toLowerCase())) {
+                        resultList.add(row)
                     }
-                    if(!constraint.toString().split(",")[1].equals("N/A")) {
-                        resultList = ArrayList<Device>()
-                        for (row in dataFilterSet) {
+                }
 
-                            if (row.address!!.toLowerCase().contains(constraint.toString().split(",")[1].toLowerCase())) {
-                                resultList.add(row)
-                            }
+            }
+            if(!resultList.isEmpty()) {
+                dataFilterSet = resultList
 
+            }
+            if(!constraint.toString().split(",")[1].equals("N/A")) {
+                resultList = ArrayList<Device>()
+                for (row in dataFilterSet) {
 
-                        }
+                    if (row.address!!.toLowerCase().contains(constraint.toString().split(",")[1].toLowerCase())) {
+                        resultList.add(row)
                     }
-                    if(!resultList.isEmpty()) {
-                        dataFilterSet = resultList
 
-                    }
 
-                    if(!constraint.toString().split(",")[2].equals("N/A")){
-                    resultList = ArrayList<Device>()
-                    for (row in dataFilterSet) {
+                }
+            }
+            if(!resultList.isEmpty()) {
+                dataFilterSet = resultList
 
-                            if (row.scanHex!!.toLowerCase().contains(constraint.toString().split(",")[2].toLowerCase())) {
-                                resultList.add(row)
-                            }
+            }
 
+            if(!constraint.toString().split(",")[2].equals("N/A")){
+            resultList = ArrayList<Device>()
+            for (row in dataFilterSet) {
 
+                    if (row.scanHex!!.toLowerCase().contains(constraint.toString().split(",")[2].toLowerCase())) {
+                        resultList.add(row)
                     }
-                    }
-                    dataFilterSet = resultList
-                }
+
+
+            }
+            }
+            dataFilterSet = resultList
+        }
+        return dataFilterSet
+    }
+
+    override fun getFilter(): Filter {
+        return object : Filter() {
+            override fun performFiltering(constraint: CharSequence?): FilterResults {
                 val filterResults = FilterResults()
-                filterResults.values = dataFilterSet
+                filterResults.values = filterDevices(constraint)
                 return filterResults
             }
 
             override fun publishResults(constraint: CharSequence?, results: FilterResults?) {
+                this@CustomAdapter.constraint = constraint
 
                 if (results != null)
                     dataFilterSet = results.values as ArrayList<Device>
@@ -12,7 +12,9 @@ import androidx.core.content.ContextCompat
 import com.trial.bluetoothtrials.Utility.File
 import com.trial.bluetoothtrials.Utility.FileChooser
 import com.trial.bluetoothtrials.Utility.LoadingUtils
+import com.trial.bluetoothtrials.Utility.OtaTransfer
 import com.trial.bluetoothtrials.Utility.PreferenceController
+import com.trial.bluetoothtrials.Utility.Probes
 import kotlinx.android.synthetic.main.activity_device_detail.*
 import kotlinx.android.synthetic.main.progress_layout.*
 import java.nio.ByteBuffer
@@ -24,20 +26,27 @@ import java.util.*
 class DeviceDetailActivity : AppCompatActivity() {
     private lateinit var mHandler: Handler
     private var count:Int =0
-    var three: Int=0
-    var one: Char='0'
-    var two: Char='0'
-    var four: Int=0
     private var otaDoneFlag: Boolean=false
     lateinit var otaUpdateFlag: BluetoothGattCharacteristic
     lateinit var selectedCharacteristic: BluetoothGattCharacteristic
     lateinit var file: File
+    // rc5 key for this device's OTA, owned by the activity so other transfers keep their own
+    private var rc5Session: Long = 0
     lateinit var gatt: BluetoothGatt
     private var deviceId: String=""
-    var chunkCounter = -1
-    var blockCounter:Int = 0
-    var lastBlockSent = false
-    var lastBlock = false
+    // negotiated ATT MTU, the OTA frames are sized to fit it
+    private var otaMtu = 23
+    private var transfer: OtaTransfer? = null
+    // the transfer engine is driven from the main thread only
+    private val otaHandler = Handler(Looper.getMainLooper())
+    private val pumpOta = Runnable { sendBlock() }
+    private val otaWatchdog = object : Runnable {
+        override fun run() {
+            val t = transfer ?: return
+            if (otaDoneFlag) return
+            if (t.poll() == OtaTransfer.FAILED) failOta() else otaHandler.postDelayed(this, OTA_WATCHDOG_MS)
+        }
+    }
     val input = byteArrayOf(
             0x45,
             0x07,
@@ -62,8 +71,6 @@ class DeviceDetailActivity : AppCompatActivity() {
     }
 
 
-    var obuf = ByteArray(4)
-    var dbuf = ByteArray(4)
     private val mGattCallback = object : BluetoothGattCallback() {
         override fun onConnectionStateChange(gatt: BluetoothGatt, status: Int, newState: Int) {
             val intentAction: String
@@ -96,6 +103,7 @@ class DeviceDetailActivity : AppCompatActivity() {
 
         override fun onMtuChanged(gatt: BluetoothGatt?, mtu: Int, status: Int) {
             if (status == BluetoothGatt.GATT_SUCCESS) {
+                otaMtu = mtu
                 Log.e("TAG", "MTU request Success, status=${status.toString()}")
             } else {
                 Log.e("TAG", "MTU request failure, status=${status.toString()}")
@@ -182,9 +190,9 @@ class DeviceDetailActivity : AppCompatActivity() {
                 status: Int
         ) {
             super.onCharacteristicWrite(gatt, characteristic, status)
-            Log.d("Status", status.toString())
-            if(!otaDoneFlag)
-            sendBlock()
+            // every completion on the OTA characteristic returns one window credit
+            if(!otaDoneFlag && characteristic?.uuid == selectedCharacteristic.uuid)
+                otaHandler.post { onOtaWriteComplete(status) }
 
 
         }
@@ -231,6 +239,18 @@ class DeviceDetailActivity : AppCompatActivity() {
         gatt.disconnect()
     }
 
+    override fun onDestroy() {
+        super.onDestroy()
+        otaHandler.removeCallbacksAndMessages(null)
+        transfer?.close()
+        transfer = null
+        if (::file.isInitialized) file.close()
+        if (rc5Session != 0L) {
+            rc5SessionDestroy(rc5Session)
+            rc5Session = 0
+        }
+    }
+
     override fun onActivityResult(requestCode: Int, resultCode: Int, data: Intent?) {
         super.onActivityResult(requestCode, resultCode, data)
         if(requestCode==111&&resultCode== RESULT_OK){
@@ -243,122 +263,86 @@ class DeviceDetailActivity : AppCompatActivity() {
             }
             Log.d("Data", path)
             file= path?.let { File.getByFileName(it) }!!
-            file?.setFileBlockSize(3, 240)
+            if (OTA_COMPRESS && file.compress())
+                Log.d("TAG", "OTA image compressed to " + file.getNumberOfBytes() + " of " + file.rawBytes +
+                        " bytes, ratio " + String.format("%.2f", file.compressionRatio))
+            // the length byte and the chunk have to fit in one write, in whole RC5 blocks
+            file?.setFileBlockSize(3, minOf(OTA_CHUNK_SIZE, (otaMtu - 4) and 3.inv()))
 //            rc5Setup(input)
-            PreferenceController.instance?.getKeyString(this, "Key")?.let { rc5Setup(it.decodeHex()) }
+            var otaKey: ByteArray? = null
+            PreferenceController.instance?.getKeyString(this, "Key")?.let {
+                otaKey = it.decodeHex()
+                if (rc5Session != 0L) rc5SessionDestroy(rc5Session)
+                rc5Session = rc5SessionCreate(otaKey!!)
+            }
+            transfer?.close()
+            // the same key signs the image digest sent with the end-of-OTA flag
+            transfer = OtaTransfer.create(file, rc5Session, OTA_WINDOW, otaMtu, otaKey)
+            if (transfer == null) {
+                Toast.makeText(applicationContext, "Cannot start the update", Toast.LENGTH_SHORT).show()
+                return
+            }
             progress_layout.visibility=View.VISIBLE
             button.visibility=View.GONE
             sendBlock()
+            otaHandler.postDelayed(otaWatchdog, OTA_WATCHDOG_MS)
         }
     }
 
 
-    fun sendBlock(): Float{
-
-        val progress = (chunkCounter + 1).toFloat() / file.getBlock(blockCounter)!!.size.toFloat() * 100
-
-
-        runOnUiThread {
-            if(!lastBlockSent) {
-                percent.setText(progress.toInt().toString())
-                progress_bar.progress = progress.toInt()
-                Log.d("Percentage%", "$progress%")
-            }else{
-                Log.d("Percentage100", "100")
-
-                percent.setText("100")
-                progress_bar.progress =100
+    // writes the next frame; BluetoothGatt takes one write at a time, so the following one
+    // goes from its onCharacteristicWrite
+    fun sendBlock() {
+        val t = transfer ?: return
+        otaHandler.removeCallbacks(pumpOta)
+        val characteristic: BluetoothGattCharacteristic = selectedCharacteristic
+        val frame = t.next()
+        if (frame != null) {
+            characteristic.value = frame
+            characteristic.writeType = BluetoothGattCharacteristic.WRITE_TYPE_NO_RESPONSE
+            if (!gatt.writeCharacteristic(characteristic)) {
+                // stack busy: the frame goes back to the front, the retry resends it
+                t.refused()
+                otaHandler.postDelayed(pumpOta, OTA_RETRY_MS)
             }
         }
-        if (!lastBlockSent) {
-            Log.d("Percentage", "$progress%")
-            val block: Array<ByteArray?>? = file.getBlock(blockCounter)
-            val i: Int = ++chunkCounter
-            if (chunkCounter == 0) Log.d(
-                    "TAG",
-                    "Current block: " + (blockCounter + 1) + " of " + file.numberOfBlocks
-            )
-            var lastChunk = false
-            if (block != null) {
-                if (chunkCounter == block.size - 1) {
-                    chunkCounter = -1
-                    lastChunk = true
-                }
-            }
-            val chunk = block?.get(i)
-            val chunkNumber: Int = blockCounter * file.chunksPerBlockCount + i + 1
-             val systemLogMessage = "Sending block " + (blockCounter + 1) + ", chunk " + (i + 1) + " of " + block!!.size + ", size " + chunk!!.size
-            Log.d("TAG", systemLogMessage)
-            val characteristic: BluetoothGattCharacteristic =selectedCharacteristic
-            var buf: ByteArray
-
-//            val rc5 = RC5()
-//            rc5.rc5_KeyIninitialize(input)
-
-            var finalBytes:ByteArray= byteArrayOf(chunk.size.toByte())
-            for(i in 0..chunk.size step 4){
-                if(i!=0){
-                    one=(chunk[i - 1].toInt() shl 8 xor chunk[i - 2].toInt()).toChar()
-                    two=(chunk[i - 3].toInt() shl 8 xor chunk[i - 4].toInt()).toChar()
-                    three=(chunk[i - 1].toInt() shl 8 xor chunk[i - 2].toInt())
-                    four=(((chunk[i - 3].toInt() and 0xff) shl 8) xor chunk[i - 4].toInt())
-//                    buf= charArrayOf(
-//                        (chunk[i - 1].toInt() shl 8 xor chunk[i - 2].toInt()).toChar(),
-//                        (chunk[i - 3].toInt() shl 8 xor chunk[i - 4].toInt()).toChar()
-//                    )
-//                    obuf = rc5.rc5_Encrypt(buf)
-//                    dbuf = rc5.rc5_Decrypt(obuf)
-                    buf= byteArrayOf(chunk[i - 4], chunk[i - 3], chunk[i - 2], chunk[i - 1])
-                    obuf= rc5Encrypt(buf)
-                    dbuf= rc5Decrypt(obuf)
-                    val obufval=obuf[0].toInt() and 0xff00
-                    finalBytes+= byteArrayOf(
-                            obuf[0],
-                            obuf[1],
-                            obuf[2],
-                            obuf[3]
-                    )
-                }
-            }
-
-
-
-
+        val progress = t.completed() * 100 / maxOf(t.chunkCount, 1)
+        percent.setText(progress.toString())
+        progress_bar.progress = progress
+    }
 
-            characteristic.value =finalBytes
-            characteristic.writeType = BluetoothGattCharacteristic.WRITE_TYPE_DEFAULT
-            val r: Boolean = gatt.writeCharacteristic(characteristic)
-            Log.d("TAG", "writeCharacteristic: $r")
-            if (lastChunk) {
+    private fun onOtaWriteComplete(status: Int) {
+        val t = transfer ?: return
+        when (t.complete(status)) {
+            OtaTransfer.DONE -> finishOta()
+            OtaTransfer.FAILED -> failOta()
+            else -> sendBlock()
+        }
+    }
 
-                // SUOTA
-                if (file.numberOfBlocks === 1) {
-                    lastBlock = true
-                }
-                if (!lastBlock) {
-                    blockCounter++
-                } else {
-                    lastBlockSent = true
-                }
-                if (blockCounter + 1 == file.numberOfBlocks) {
-                    lastBlock = true
-                }
+    private fun finishOta() {
+        val stats = transfer!!.stats()
+        Log.d("TAG", "OTA sent " + stats[1] + " chunks in " + stats[4] / 1000000 + " ms, " + stats[2] +
+                " retransmits, " + stats[3] + " busy, latency p95 " + stats[7] / 1000 + " us")
+        // crypto, JNI and link time of the whole transfer, see Probes
+        Log.d("TAG", "OTA probes " + Probes.json())
+        percent.setText("100")
+        progress_bar.progress = 100
+        otaHandler.removeCallbacks(otaWatchdog)
+        val characteristic: BluetoothGattCharacteristic = otaUpdateFlag
+        // the flag byte, then CRC-32 and AES-CMAC of the payload for the peripheral to check
+        characteristic.value = byteArrayOf(1) + (transfer!!.digest() ?: ByteArray(0))
+        characteristic.writeType = BluetoothGattCharacteristic.WRITE_TYPE_DEFAULT
+        gatt.writeCharacteristic(characteristic)
+        otaDoneFlag = true
+    }
 
-/*                // SPOTA
-                if (type == SpotaManager.TYPE) {
-                    lastBlockSent = true
-                }*/
-            }
-        }else{
-            if(!otaDoneFlag) {
-                val characteristic: BluetoothGattCharacteristic = otaUpdateFlag
-                characteristic.value = byteArrayOf(1)
-                characteristic.writeType = BluetoothGattCharacteristic.WRITE_TYPE_DEFAULT
-                val r: Boolean = gatt.writeCharacteristic(characteristic)
-                otaDoneFlag = true
-            }
-        }
-        return progress
+    private fun failOta() {
+        otaHandler.removeCallbacks(otaWatchdog)
+        otaHandler.removeCallbacks(pumpOta)
+        Log.d("TAG", "OTA failed after " + transfer?.completed() + " chunks")
+        Toast.makeText(applicationContext, "Update failed", Toast.LENGTH_SHORT).show()
+        gatt.disconnect()
     }
 
     fun stringToCharArray(inputString: String?): CharArray? {
@@ -385,6 +369,16 @@ class DeviceDetailActivity : AppCompatActivity() {
     }
 }
 
+const val OTA_CHUNK_SIZE = 240
+// send the image LZ-block compressed; only for peripherals that decode the stream
+const val OTA_COMPRESS = false
+// frames outstanding; BluetoothGatt refuses a second write until the first calls back, and
+// write commands call back once the stack has buffered them, so one is enough to fill the
+// connection events
+const val OTA_WINDOW = 1
+const val OTA_RETRY_MS = 5L
+const val OTA_WATCHDOG_MS = 1000L
+
 private fun ByteArray.toCharArray(): CharArray {
     var chars:CharArray= CharArray(16)
     for(i in 0..15){
@@ -400,3 +394,10 @@ private fun ByteArray.toCharArray(): CharArray {
 external fun rc5Setup(entry: ByteArray)
 external fun rc5Decrypt(entry: ByteArray): ByteArray
 external fun rc5Encrypt(entry: ByteArray): ByteArray
+external fun rc5EncryptBuffer(entry: ByteArray): ByteArray
+external fun rc5DecryptBuffer(entry: ByteArray): ByteArray
+external fun rc5EncryptImage(image: ByteArray, chunkSize: Int): Array<ByteArray>
+external fun rc5SessionCreate(key: ByteArray): Long
+external fun rc5SessionDestroy(session: Long)
+external fun rc5SessionEncrypt(session: Long, entry: ByteArray): ByteArray?
+external fun rc5SessionDecrypt(session: Long, entry: ByteArray): ByteArray?
@@ -4,6 +4,7 @@ import androidx.appcompat.app.AppCompatActivity
 import android.os.Bundle
 import androidx.core.content.ContextCompat
 import androidx.recyclerview.widget.LinearLayoutManager
+import com.trial.bluetoothtrials.Utility.LogStore
 import kotlinx.android.synthetic.main.activity_logger.*
 
 class LoggerActivity : AppCompatActivity(), ItemClick {
@@ -14,12 +15,12 @@ class LoggerActivity : AppCompatActivity(), ItemClick {
         super.onCreate(savedInstanceState)
         setContentView(R.layout.activity_logger)
         val extras = intent.extras
-        val arraylist  = extras.getParcelableArrayList<LogRecord>("logList")
-        arraylist.reverse()
+        val store = LogStore.session(this)
+        val tag = store.findTag(extras.getLong("tagId"))
         window.statusBarColor = ContextCompat.getColor(this, R.color.black)
         linearLayoutManager = LinearLayoutManager(this)
         log_list.layoutManager = linearLayoutManager
-        adapter = LoggerAdapter(applicationContext,arraylist, this)
+        adapter = LoggerAdapter(applicationContext, store, tag, this)
         log_list.adapter = adapter
 
     }
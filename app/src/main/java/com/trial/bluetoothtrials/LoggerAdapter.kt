@@ -2,6 +2,7 @@ package com.trial.bluetoothtrials
 
 import android.bluetooth.le.ScanResult
 import android.content.Context
+import android.os.SystemClock
 import android.view.LayoutInflater
 import android.view.View
 import android.view.ViewGroup
@@ -9,10 +10,22 @@ import android.widget.LinearLayout
 import android.widget.TextView
 import androidx.cardview.widget.CardView
 import androidx.recyclerview.widget.RecyclerView
+import com.trial.bluetoothtrials.Utility.LogStore
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.text.SimpleDateFormat
+import java.util.Date
 
-class LoggerAdapter(val context:Context, private val dataSet: java.util.ArrayList<LogRecord>, val itemClick: ItemClick) :
+// newest record first, read from the native log store a page at a time
+class LoggerAdapter(val context:Context, private val store: LogStore, private val tag: Int, val itemClick: ItemClick) :
         RecyclerView.Adapter<LoggerAdapter.ViewHolder>() {
-    private lateinit var dataFilterSet: ArrayList<LogRecord>
+    private val recordCount = store.recordCount(tag)
+    private val records = ByteBuffer.allocateDirect(PAGE_RECORDS * LogStore.RECORD_SIZE).order(ByteOrder.nativeOrder())
+    private val reports = ByteBuffer.allocateDirect(PAGE_RECORDS * BEACON_REPORT_SIZE).order(ByteOrder.nativeOrder())
+    private var pageStart = -1
+    private val formatter = SimpleDateFormat("HH:mm:ss.SSS")
+    // record timestamps are elapsed realtime, this turns them into wall clock
+    private val bootMillis = System.currentTimeMillis() - SystemClock.elapsedRealtime()
 
     /**
      * Provide a reference to the type of views that you are using
@@ -67,21 +80,29 @@ class LoggerAdapter(val context:Context, private val dataSet: java.util.ArrayLis
 
         // Get element from your dataset at this position and replace the
         // contents of the view with that element
-        val rawString=dataFilterSet[position].rawData
-        val zoneStatus=rawString.subSequence(16,18)
+        val index = recordCount - 1 - position
+        if (index < pageStart || index >= pageStart + PAGE_RECORDS) {
+            pageStart = index / PAGE_RECORDS * PAGE_RECORDS
+            store.readPage(tag, pageStart, PAGE_RECORDS, records, reports)
+        }
+        val slot = index - pageStart
+        val report=BeaconReport.read(reports, slot * BEACON_REPORT_SIZE)
+        val timestamp=formatter.format(Date(bootMillis +
+                records.getLong(slot * LogStore.RECORD_SIZE + LogStore.RECORD_TIMESTAMP) / 1000000))
+        val zoneStatus=report.status
         var zone:String=""
-        if(zoneStatus.equals("04")){
-            zone="Inside Zone at "+dataFilterSet[position].timestamp
+        if(zoneStatus==BEACON_STATUS_INSIDE){
+            zone="Inside Zone at "+timestamp
             viewHolder.locationheader.text="Locator ID"
             viewHolder.distanceheader.text="Distance(m)"
             viewHolder.cardView.setCardBackgroundColor(context.getColor(R.color.red))
-        }else if(zoneStatus.equals("05")){
-            zone="Outside Zone at "+dataFilterSet[position].timestamp
+        }else if(zoneStatus==BEACON_STATUS_OUTSIDE){
+            zone="Outside Zone at "+timestamp
             viewHolder.locationheader.text="Locator ID"
             viewHolder.distanceheader.text="Distance(m)"
             viewHolder.cardView.setCardBackgroundColor(context.getColor(R.color.verygreen))
-        }else if(zoneStatus.equals("06")){
-            zone="Ranging Failure at "+dataFilterSet[position].timestamp
+        }else if(zoneStatus==BEACON_STATUS_FAILURE){
+            zone="Ranging Failure at "+timestamp
             viewHolder.locationheader.text="Error Code"
             viewHolder.distanceheader.text="Failure Count"
             viewHolder.cardView.setCardBackgroundColor(context.getColor(R.color.blue))
@@ -94,14 +115,14 @@ class LoggerAdapter(val context:Context, private val dataSet: java.util.ArrayLis
             viewHolder.distanceB.visibility=View.GONE
             viewHolder.distanceC.visibility=View.GONE
         }else{
-            zone="Unknown Status at"+dataFilterSet[position].timestamp
+            zone="Unknown Status at"+timestamp
             viewHolder.locationheader.text="Locator ID"
             viewHolder.distanceheader.text="Distance(m)"
             viewHolder.cardView.setCardBackgroundColor(context.getColor(R.color.black))
 
         }
         viewHolder.zoneStatus.text = zone
-        if(!zoneStatus.equals("06")){
+        if(zoneStatus!=BEACON_STATUS_FAILURE){
 //            viewHolder.locator_b_part.visibility=View.VISIBLE
 //            viewHolder.distance_b_part.visibility=View.VISIBLE
 //            viewHolder.locator_c_part.visibility=View.VISIBLE
@@ -114,16 +135,16 @@ class LoggerAdapter(val context:Context, private val dataSet: java.util.ArrayLis
             viewHolder.locationC.visibility=View.VISIBLE
             viewHolder.distanceB.visibility=View.VISIBLE
             viewHolder.distanceC.visibility=View.VISIBLE
-        viewHolder.locationA.text = rawString.subSequence(26,34)
-        viewHolder.distanceA.text = (Integer.decode("0x"+rawString.subSequence(36,38)+rawString.subSequence(34,36) as String).toString().toFloat()/100).toString()
-        viewHolder.locationB.text = rawString.subSequence(38,46)
-        viewHolder.locationC.text = rawString.subSequence(50,58)
-        viewHolder.distanceB.text = (Integer.decode("0x"+rawString.subSequence(48,50)+rawString.subSequence(46,48) as String).toString().toFloat()/100).toString()
-        viewHolder.distanceC.text = (Integer.decode("0x"+rawString.subSequence(60,62)+rawString.subSequence(58,60) as String).toString().toFloat()/100).toString()
+        val locations = arrayOf(viewHolder.locationA, viewHolder.locationB, viewHolder.locationC)
+        val distances = arrayOf(viewHolder.distanceA, viewHolder.distanceB, viewHolder.distanceC)
+        for (i in locations.indices) {
+            locations[i].text = if (i < report.locatorIds.size) report.locatorHex(i) else ""
+            distances[i].text = if (i < report.distancesCm.size) report.distanceMetres(i).toString() else ""
+        }
 
         }else{
-            viewHolder.locationA.text = rawString.subSequence(26,28)
-            viewHolder.distanceA.text =rawString.subSequence(28,30)
+            viewHolder.locationA.text = String.format("%02X", report.errorCode)
+            viewHolder.distanceA.text = String.format("%02X", report.failureCount)
 
         }
 //        viewHolder.card.setOnClickListener(View.OnClickListener {
@@ -131,12 +152,13 @@ class LoggerAdapter(val context:Context, private val dataSet: java.util.ArrayLis
 //            itemClick.onItemClick(dataSet[position])
 //        })
     }
-    init {
-        dataFilterSet = dataSet
-    }
     // Return the size of your dataset (invoked by the layout manager)
     override fun getItemCount(): Int {
-        return dataFilterSet.size
+        return recordCount
+    }
+
+    companion object {
+        private const val PAGE_RECORDS = 64
     }
     fun bytesToHex(bytes: ByteArray): String {
         var hexString:String=""
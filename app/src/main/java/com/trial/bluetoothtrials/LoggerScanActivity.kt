@@ -1,6 +1,7 @@
 package com.trial.bluetoothtrials
 
 import android.Manifest
+import android.app.AlertDialog
 import android.bluetooth.BluetoothAdapter
 import android.bluetooth.BluetoothManager
 import android.bluetooth.le.BluetoothLeScanner
@@ -13,14 +14,20 @@ import android.os.Bundle
 import android.os.Handler
 import android.util.Log
 import android.view.View
+import android.widget.EditText
 import android.widget.Toast
 import androidx.appcompat.app.AppCompatActivity
 import androidx.core.content.ContextCompat
 import androidx.recyclerview.widget.LinearLayoutManager
 import androidx.recyclerview.widget.RecyclerView
+import com.trial.bluetoothtrials.Utility.DeviceTable
+import com.trial.bluetoothtrials.Utility.LocatorEngine
+import com.trial.bluetoothtrials.Utility.LogStore
 import com.trial.bluetoothtrials.Utility.PermissionManager
+import com.trial.bluetoothtrials.Utility.PreferenceController
 import kotlinx.android.synthetic.main.activity_main.*
-import java.text.SimpleDateFormat
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
 import java.util.*
 import kotlin.collections.ArrayList
 
@@ -44,21 +51,36 @@ class LoggerScanActivity : AppCompatActivity(),ItemClick {
     var addressVal:String="N/A"
     var nameVal:String="N/A"
     var rawVal:String="N/A"
-    var loggerList: MutableMap<String, ArrayList<LogRecord>> = mutableMapOf()
+    // binary history of every tag seen, browsed page by page in LoggerActivity
+    private lateinit var logStore: LogStore
+    // scan records in, decoded reports out; reused for every batch
+    private val recordBuffer = ByteBuffer.allocateDirect(BEACON_BATCH_MAX * BEACON_RECORD_MAX)
+        .order(ByteOrder.LITTLE_ENDIAN)
+    private val reportBuffer = ByteBuffer.allocateDirect(BEACON_BATCH_MAX * BEACON_REPORT_SIZE)
+        .order(ByteOrder.nativeOrder())
+    // filtered distances, positions and zones of every tag, updated once per batch
+    private lateinit var locatorEngine: LocatorEngine
+    private val reportTimes = LongArray(BEACON_BATCH_MAX)
+    private val fixBuffer = ByteBuffer.allocateDirect(BEACON_BATCH_MAX * LocatorEngine.FIX_SIZE)
+        .order(ByteOrder.nativeOrder())
+    init {
+        System.loadLibrary("native-lib")
+    }
 
-    private fun isMacAlreadyScanned(tagId: String): Boolean {
-        for( scandevice in scannedDevice){
-            if(scandevice.scanHex.subSequence(18, 26).equals(tagId)){
-                return true
-            }
-        }
-        return false
+    // tag id -> row of scannedDevice, adapter updates are batched per frame
+    private val tagTable = DeviceTable(512)
+    private var changesPending = false
+    private val dispatchChanges = Runnable {
+        changesPending = false
+        tagTable.dispatchChanges(adapter)
     }
 
 
     override fun onCreate(savedInstanceState: Bundle?) {
         super.onCreate(savedInstanceState)
         setContentView(R.layout.activity_logger_scan)
+        logStore = LogStore.session(this)
+        locatorEngine = LocatorEngine.create(this)
         window.statusBarColor = ContextCompat.getColor(this, R.color.black)
         linearLayoutManager = LinearLayoutManager(this)
         device_list.layoutManager = linearLayoutManager
@@ -81,6 +103,10 @@ class LoggerScanActivity : AppCompatActivity(),ItemClick {
                 stopDeviceScan()
             }
         })
+        floatingActionButton.setOnLongClickListener {
+            editLayout()
+            true
+        }
 
 
         adapter.registerAdapterDataObserver(object : RecyclerView.AdapterDataObserver() {
@@ -94,10 +120,31 @@ class LoggerScanActivity : AppCompatActivity(),ItemClick {
 //                    device_list.visibility=View.VISIBLE
                 }
             }
+
+            override fun onItemRangeInserted(positionStart: Int, itemCount: Int) {
+                onChanged()
+            }
         })
     }
 
 
+    // where the locators are, for positions; applied right away and kept for the next session
+    private fun editLayout() {
+        val input = EditText(this)
+        input.hint = "A101:0:0;A102:12.5:0;A103:0:8"
+        input.setText(PreferenceController.instance!!.getKeyString(this, LocatorEngine.LAYOUT_KEY))
+        AlertDialog.Builder(this)
+            .setTitle("Locator layout (id:x:y in metres)")
+            .setView(input)
+            .setPositiveButton("Save") { _, _ ->
+                val layout = input.text.toString().trim()
+                PreferenceController.instance!!.addKeyString(this, LocatorEngine.LAYOUT_KEY, layout)
+                locatorEngine.placeAll(layout)
+            }
+            .setNegativeButton("Cancel", null)
+            .show()
+    }
+
     //checks for the permissions and shows permission dialog if no permission found else starts scan
     private fun checkPermissionsandStartScan(){
         if(PermissionManager.checkCoarseLocationPermission(this)){
@@ -112,6 +159,15 @@ class LoggerScanActivity : AppCompatActivity(),ItemClick {
         stopDeviceScan()
     }
 
+    override fun onDestroy() {
+        super.onDestroy()
+        handler!!.removeCallbacks(dispatchChanges)
+        tagTable.close()
+        locatorEngine.close()
+        // the session's history goes to the app's external files for offline analysis
+        if (isFinishing) LogStore.closeSession(getExternalFilesDir(null))
+    }
+
     //starts ble scan
     private fun startDeviceScan(){
 //        scannedHex.clear()
@@ -124,119 +180,12 @@ class LoggerScanActivity : AppCompatActivity(),ItemClick {
             ).build()
             callback = object : ScanCallback() {
                 override fun onScanResult(callbackType: Int, result: ScanResult) {
-                    Log.d("ScanRecords", bytesToHex(result.scanRecord.bytes))
-
-//                Log.d("ScanRecords", bytesToHex(result.scanRecord.bytes))
-//                if (!scannedHex.contains(bytesToHex(scanRecord))) {
-                    val device=result.device
-                    val scanRecord=result.scanRecord.bytes
-                    val tagid=bytesToHex(scanRecord).subSequence(18, 26).toString()
-                    val rssi=result.rssi
-                    var isConnectable:Boolean=false
-                    if(android.os.Build.VERSION.SDK_INT >26)
-                        isConnectable=result.isConnectable
-                    else
-                        isConnectable=true
-                    val hexstring=bytesToHex(scanRecord)
-                    if(hexstring.contains("970152")&&(hexstring.subSequence(16, 18).equals("04")||hexstring.subSequence(
-                            16,
-                            18
-                        ).equals("05")||hexstring.subSequence(16, 18).equals("06")))
-                    if (!isMacAlreadyScanned(tagid)) {
-                        var results:ArrayList<LogRecord> = arrayListOf()
-                        val date = Date(System.currentTimeMillis())
-
-                        val formatter = SimpleDateFormat("HH:mm:ss.SSS")
-//                        formatter.setTimeZone(TimeZone.getTimeZone("UTC"))
-
-                        val formatted: String = formatter.format(date)
-                        val record:LogRecord= LogRecord(bytesToHex(scanRecord),formatted,
-                            rssi.toString()
-                        )
-                        if(loggerList[tagid]!=null)
-                        results= loggerList[tagid]!!
-                        if (results != null) {
-                            results.add(record)
-                        }
-                        loggerList[tagid]=results
-//                        loggerList.plus(device.address to results)
-                        var name: String? = ""
-                        if (device.name != null)
-                            name = device.name
-                        else
-                            name = "NA"
-                        val scanHexRecord = Device(
-                            device.address,
-                            bytesToHex(scanRecord),
-                            name,
-                            rssi,
-                            isConnectable
-                        )
-                        scannedHex.add(bytesToHex(scanRecord))
-                        scannedDevice.add(scanHexRecord)
-//                        Log.d("Added", "new record"+rssi)
-                        adapter.notifyDataSetChanged()
-                    } else {
-                        var results:ArrayList<LogRecord> = arrayListOf()
-                        val date = Date(System.currentTimeMillis())
-
-                        val formatter = SimpleDateFormat("HH:mm:ss.SSS")
-//                        formatter.setTimeZone(TimeZone.getTimeZone("UTC"))
-
-                        val formatted: String = formatter.format(date)
-                        val record:LogRecord= LogRecord(bytesToHex(scanRecord),formatted,
-                            rssi.toString()
-                        )
-                        if(loggerList[tagid]!=null)
-                            results= loggerList[tagid]!!
-                        if (results != null) {
-                            results.add(record)
-                        }
-                        loggerList[tagid]=results
-                        var position: Int = -1
-                        for (i in 0..scannedDevice.size) {
-                            Log.d("SCannedDEV", scannedDevice.size.toString())
-                            if(i<scannedDevice.size)
-                                if (scannedDevice.get(i).scanHex.subSequence(18, 26).toString().equals(
-                                        tagid
-                                    )) {
-                                    position = i
-                                    Log.d("pos", position.toString())
-                                    break
-                                }
-//                            }else{
-//                                break
-//                            }
-                        }
-
-                        var name: String? = ""
-                        if (device.name != null)
-                            name = device.name
-                        else
-                            name = "NA"
-                        val scanHexRecord = Device(
-                            device.address,
-                            bytesToHex(scanRecord),
-                            name,
-                            rssi,
-                            isConnectable
-                        )
-                        if(position!=-1) {
-                            Log.d("Update", bytesToHex(scanRecord))
-                            scannedHex.set(position, bytesToHex(scanRecord))
-                            scannedDevice.set(position, scanHexRecord)
-//                        Log.d("Added", "new record"+rssi)
-                            adapter.notifyItemChanged(position)
-                        }
-
-                    }
-
-//                }
-
-
+                    handleScanResults(listOf(result))
                 }
 
-
+                override fun onBatchScanResults(results: MutableList<ScanResult>) {
+                    handleScanResults(results)
+                }
             }
         }
         scanner?.startScan(null, settings, callback)
@@ -253,6 +202,89 @@ class LoggerScanActivity : AppCompatActivity(),ItemClick {
 //        }
     }
 
+    // packs the raw scan records into the direct buffer and decodes the locator beacons among
+    // them in one native call, only the accepted ones are hex encoded (once) for the lists
+    private fun handleScanResults(results: List<ScanResult>) {
+        var start = 0
+        while (start < results.size) {
+            recordBuffer.clear()
+            var end = start
+            while (end < results.size && end - start < BEACON_BATCH_MAX) {
+                val bytes = results[end].scanRecord?.bytes ?: ByteArray(0)
+                if (recordBuffer.remaining() < 2 + bytes.size) break
+                recordBuffer.putShort(bytes.size.toShort())
+                recordBuffer.put(bytes)
+                end++
+            }
+            if (end == start) {
+                start++
+                continue
+            }
+            val count = beaconParseBatch(recordBuffer, recordBuffer.position(), reportBuffer)
+            for (i in 0 until count)
+                reportTimes[i] = results[start + BeaconReport.index(reportBuffer, i * BEACON_REPORT_SIZE)].timestampNanos
+            if (count > 0)
+                locatorEngine.update(reportBuffer, count, reportTimes, fixBuffer)
+            for (i in 0 until count) {
+                val offset = i * BEACON_REPORT_SIZE
+                onBeacon(results[start + BeaconReport.index(reportBuffer, offset)],
+                    BeaconReport.read(reportBuffer, offset))
+                onFix(i * LocatorEngine.FIX_SIZE)
+            }
+            start = end
+        }
+    }
+
+    private fun onBeacon(result: ScanResult, report: BeaconReport) {
+        val device=result.device
+        val hexstring=hexEncode(result.scanRecord!!.bytes)
+        val rssi=result.rssi
+        var isConnectable:Boolean=false
+        if(android.os.Build.VERSION.SDK_INT >26)
+            isConnectable=result.isConnectable
+        else
+            isConnectable=true
+        logStore.append(report.tagId, result.timestampNanos, rssi, result.scanRecord!!.bytes)
+        var name: String? = ""
+        if (device.name != null)
+            name = device.name
+        else
+            name = "NA"
+        val scanHexRecord = Device(
+            device.address,
+            hexstring,
+            name,
+            rssi,
+            isConnectable,
+            report.tagId
+        )
+        val position = tagTable.upsert(DeviceTable.tagKey(report.tagId))
+        if (position == scannedDevice.size) {
+            scannedHex.add(hexstring)
+            scannedDevice.add(scanHexRecord)
+        } else {
+            scannedHex.set(position, hexstring)
+            scannedDevice.set(position, scanHexRecord)
+        }
+        if (!changesPending) {
+            changesPending = true
+            handler!!.postDelayed(dispatchChanges, DeviceTable.FRAME_MILLIS)
+        }
+    }
+
+    // zone changes are rare enough to log as they happen
+    private fun onFix(offset: Int) {
+        if (fixBuffer.get(offset + LocatorEngine.FIX_TRANSITION).toInt() == 0) return
+        val tagId = fixBuffer.getInt(offset + LocatorEngine.FIX_TAG_ID).toLong() and 0xffffffffL
+        var text = String.format("tag %08X zone %d -> %d", tagId,
+            fixBuffer.get(offset + LocatorEngine.FIX_PREVIOUS_ZONE).toInt(),
+            fixBuffer.get(offset + LocatorEngine.FIX_ZONE).toInt())
+        if (fixBuffer.get(offset + LocatorEngine.FIX_HAS_POSITION).toInt() != 0)
+            text += String.format(" at %.2f, %.2f m", fixBuffer.getFloat(offset + LocatorEngine.FIX_X) / 100,
+                fixBuffer.getFloat(offset + LocatorEngine.FIX_Y) / 100)
+        Log.i("Zone", text)
+    }
+
     //Stops the ble scan
     private fun stopDeviceScan() {
 //        handler!!.removeCallbacks(scanTimer!!)
@@ -267,17 +299,12 @@ class LoggerScanActivity : AppCompatActivity(),ItemClick {
             device_not_found.visibility=View.GONE
 //            device_list.visibility=View.VISIBLE
         }
-        Log.d("Map", loggerList.size.toString())
+        Log.d("Map", logStore.tagCount().toString())
     }
 
     //Coverts byte array to hex string
     fun bytesToHex(bytes: ByteArray): String {
-        var hexString:String=""
-        for (b in bytes) {
-            val hexElement = String.format("%02X", b)
-            hexString+=hexElement
-        }
-        return hexString
+        return hexEncode(bytes)
     }
 
     //We get the permission request results over here
@@ -322,15 +349,20 @@ class LoggerScanActivity : AppCompatActivity(),ItemClick {
 
     override fun onItemClick(device: Device) {
         Log.d("On", "Item Click")
+        val tagId = device.tagId ?: return
         val intent=Intent(this, LoggerActivity::class.java)
 //        intent.putExtra("device", device.address)
-        intent.putParcelableArrayListExtra(
-            "logList",
-            loggerList[device.scanHex.subSequence(18, 26)]
-        )
+        intent.putExtra("tagId", tagId)
         startActivity(intent)
 
     }
 
 
-}
\ No newline at end of file
+}
+
+const val BEACON_BATCH_MAX = 64
+// 2 length bytes plus a legacy (62 byte) scan record with room to spare
+const val BEACON_RECORD_MAX = 2 + 255
+
+external fun beaconParseBatch(records: ByteBuffer, length: Int, reports: ByteBuffer): Int
+external fun hexEncode(bytes: ByteArray): String
@@ -52,14 +52,14 @@ class LoggerScanAdapter(private val dataSet: ArrayList<Device>, val itemClick: I
         // contents of the view with that element
         if(position<dataFilterSet.size) {
 
-            viewHolder.deviceName.text = dataFilterSet[position].scanHex.substring(18, 26).toLong(16).toString()
+            viewHolder.deviceName.text = dataFilterSet[position].tagId.toString()
             viewHolder.deviceAddress.text = dataFilterSet[position].address
             viewHolder.scanRecord.text = dataFilterSet[position].scanHex.substring(0, 62)
             viewHolder.rssi.text = dataFilterSet[position].rssi.toString()
 
             viewHolder.card.setOnClickListener(View.OnClickListener {
 
-                itemClick.onItemClick(dataSet[position])
+                itemClick.onItemClick(dataFilterSet[position])
             })
         }
     }
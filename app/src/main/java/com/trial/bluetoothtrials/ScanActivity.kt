@@ -2,7 +2,6 @@ package com.trial.bluetoothtrials
 
 import android.Manifest
 import android.bluetooth.BluetoothAdapter
-import android.bluetooth.BluetoothDevice
 import android.bluetooth.BluetoothManager
 import android.bluetooth.le.BluetoothLeScanner
 import android.bluetooth.le.ScanCallback
@@ -21,6 +20,7 @@ import androidx.appcompat.app.AppCompatActivity
 import androidx.core.content.ContextCompat
 import androidx.recyclerview.widget.LinearLayoutManager
 import androidx.recyclerview.widget.RecyclerView
+import com.trial.bluetoothtrials.Utility.DeviceTable
 import com.trial.bluetoothtrials.Utility.PermissionManager
 import kotlinx.android.synthetic.main.activity_main.*
 import kotlinx.android.synthetic.main.hidden_layout.*
@@ -47,14 +47,19 @@ class ScanActivity : AppCompatActivity(),ItemClick {
     var rawVal:String="N/A"
 
 
-    private fun isMacAlreadyScanned(device: BluetoothDevice): Boolean {
-    for( scandevice in scannedDevice){
-        if(scandevice.address.equals(device.address)){
-            return true
+    // MAC -> row of scannedDevice, adapter updates are batched per frame
+    private val deviceTable = DeviceTable(512)
+    private var changesPending = false
+    private val dispatchChanges = Runnable {
+        changesPending = false
+        // table rows are adapter positions only while no filter is typed
+        if (adapter.isFiltered()) {
+            deviceTable.discardChanges()
+            adapter.refilter()
+        } else {
+            deviceTable.dispatchChanges(adapter)
         }
     }
-        return false
-    }
 
 
     override fun onCreate(savedInstanceState: Bundle?) {
@@ -121,6 +126,10 @@ class ScanActivity : AppCompatActivity(),ItemClick {
 //                    device_list.visibility=View.VISIBLE
                 }
             }
+
+            override fun onItemRangeInserted(positionStart: Int, itemCount: Int) {
+                onChanged()
+            }
         })
     }
 
@@ -219,80 +228,59 @@ class ScanActivity : AppCompatActivity(),ItemClick {
         stopDeviceScan()
     }
 
+    override fun onDestroy() {
+        super.onDestroy()
+        handler!!.removeCallbacks(dispatchChanges)
+        deviceTable.close()
+    }
+
     //starts ble scan
     private fun startDeviceScan(){
         scannedHex.clear()
         scannedDevice.clear()
+        deviceTable.clear()
+        handler!!.removeCallbacks(dispatchChanges)
+        changesPending = false
         adapter.notifyDataSetChanged()
         if (scanner == null) {
             scanner = mBluetoothAdapter.bluetoothLeScanner
             settings = ScanSettings.Builder().setScanMode(ScanSettings.SCAN_MODE_LOW_LATENCY).setReportDelay(0).build()
             callback = object : ScanCallback() {
                 override fun onScanResult(callbackType: Int, result: ScanResult) {
-                    Log.d("ScanRecords", bytesToHex(result.scanRecord.bytes))
-
-//                Log.d("ScanRecords", bytesToHex(result.scanRecord.bytes))
-//                if (!scannedHex.contains(bytesToHex(scanRecord))) {
-                        val device=result.device
-                        val scanRecord=result.scanRecord.bytes
-                        val rssi=result.rssi
-                        var isConnectable:Boolean=false
-                        if(android.os.Build.VERSION.SDK_INT >26)
+                    val device=result.device
+                    val scanRecord=bytesToHex(result.scanRecord.bytes)
+                    Log.d("ScanRecords", scanRecord)
+                    val rssi=result.rssi
+                    var isConnectable:Boolean=false
+                    if(android.os.Build.VERSION.SDK_INT >26)
                         isConnectable=result.isConnectable
-                        else
-                            isConnectable=true
-                        if (!isMacAlreadyScanned(device)) {
-                            var name: String? = ""
-                            if (device.name != null)
-                                name = device.name
-                            else
-                                name = "NA"
-                            val scanHexRecord = Device(
-                                    device.address,
-                                    bytesToHex(scanRecord),
-                                    name,
-                                    rssi,
-                                    isConnectable
-                            )
-                            scannedHex.add(bytesToHex(scanRecord))
-                            scannedDevice.add(scanHexRecord)
-//                        Log.d("Added", "new record"+rssi)
-                            adapter.notifyDataSetChanged()
-                        } else {
-                            var position: Int = -1
-                            for (i in 0..scannedDevice.size) {
-//                                if(i<scannedDevice.size)
-                                if (scannedDevice.get(i).address.equals(device.address)) {
-                                    position = i
-                                    break
-                                }
-                            }
-
-                            var name: String? = ""
-                            if (device.name != null)
-                                name = device.name
-                            else
-                                name = "NA"
-                            val scanHexRecord = Device(
-                                    device.address,
-                                    bytesToHex(scanRecord),
-                                    name,
-                                    rssi,
-                                    isConnectable
-                            )
-                            scannedHex[position] = bytesToHex(scanRecord)
-                            scannedDevice[position] = scanHexRecord
-//                        Log.d("Added", "new record"+rssi)
-                            adapter.notifyItemChanged(position)
-
-                        }
-
-//                }
-
-
+                    else
+                        isConnectable=true
+                    var name: String? = ""
+                    if (device.name != null)
+                        name = device.name
+                    else
+                        name = "NA"
+                    val scanHexRecord = Device(
+                            device.address,
+                            scanRecord,
+                            name,
+                            rssi,
+                            isConnectable
+                    )
+                    val position = deviceTable.upsert(DeviceTable.macKey(device.address))
+                    if (position == scannedDevice.size) {
+                        scannedHex.add(scanRecord)
+                        scannedDevice.add(scanHexRecord)
+                    } else {
+                        scannedHex[position] = scanRecord
+                        scannedDevice[position] = scanHexRecord
+                    }
+                    if (!changesPending) {
+                        changesPending = true
+                        handler!!.postDelayed(dispatchChanges, DeviceTable.FRAME_MILLIS)
+                    }
                 }
-
-
             }
         }
         scanner?.startScan(null, settings, callback)
@@ -328,12 +316,7 @@ class ScanActivity : AppCompatActivity(),ItemClick {
 
     //Coverts byte array to hex string
     fun bytesToHex(bytes: ByteArray): String {
-        var hexString:String=""
-        for (b in bytes) {
-            val hexElement = String.format("%02X", b)
-            hexString+=hexElement
-        }
-        return hexString
+        return hexEncode(bytes)
     }
 
     //We get the permission request results over here
@@ -0,0 +1,56 @@
+package com.trial.bluetoothtrials.Utility
+
+import java.util.concurrent.Executors
+import java.util.concurrent.ScheduledExecutorService
+import java.util.concurrent.TimeUnit
+
+// rolling encrypted advertisement payloads, see adv-rotator.h
+// a background thread keeps the native cache CAPACITY slots ahead of the wall clock, so
+// payload() on the main thread only copies a block that was encrypted in advance
+class AdvertisementRotator private constructor(private var handle: Long, val intervalMs: Int) {
+    private var refiller: ScheduledExecutorService? = null
+
+    fun start() {
+        if (refiller != null) return
+        refiller = Executors.newSingleThreadScheduledExecutor().also {
+            val period = intervalMs.toLong() * CAPACITY / 2
+            it.scheduleAtFixedRate({ advRotatorRefill(handle, System.currentTimeMillis()) }, 0, period,
+                    TimeUnit.MILLISECONDS)
+        }
+    }
+
+    // payload of the current slot written to out (ADV_PAYLOAD_SIZE bytes); false when it was
+    // not cached and had to be encrypted on the calling thread
+    fun payload(out: ByteArray): Boolean = advRotatorPayload(handle, System.currentTimeMillis(), out) == 1
+
+    // generated, generation ns, refills, hits, misses, slots cached ahead, payloads per second;
+    // null once closed
+    fun stats(): LongArray? = advRotatorStats(handle, System.currentTimeMillis())
+
+    fun close() {
+        refiller?.shutdownNow()
+        refiller?.awaitTermination(1, TimeUnit.SECONDS)
+        refiller = null
+        if (handle != 0L) {
+            advRotatorDestroy(handle)
+            handle = 0
+        }
+    }
+
+    companion object {
+        const val ADV_PAYLOAD_SIZE = 16
+        const val CAPACITY = 256
+
+        // key of 16, 24 or 32 bytes, the first 8 bytes of identity go into every payload
+        fun create(key: ByteArray, identity: ByteArray, intervalMs: Int): AdvertisementRotator? {
+            val handle = advRotatorCreate(key, identity, intervalMs, CAPACITY)
+            return if (handle != 0L) AdvertisementRotator(handle, intervalMs) else null
+        }
+    }
+}
+
+external fun advRotatorCreate(key: ByteArray, identity: ByteArray, intervalMs: Int, capacity: Int): Long
+external fun advRotatorDestroy(handle: Long)
+external fun advRotatorRefill(handle: Long, timeMs: Long): Int
+external fun advRotatorPayload(handle: Long, timeMs: Long, out: ByteArray): Int
+external fun advRotatorStats(handle: Long, timeMs: Long): LongArray?
@@ -0,0 +1,70 @@
+package com.trial.bluetoothtrials.Utility
+
+import androidx.recyclerview.widget.RecyclerView
+
+// native hash index from a device key (MAC or tag id) to its stable row in the scan list
+// upserts mark rows changed; dispatchChanges turns them into batched adapter notifications
+class DeviceTable(expectedRows: Int) {
+    private var handle: Long = deviceTableCreate(expectedRows)
+    private val changes = IntArray(2 + 2 * MAX_RANGES)
+
+    // row of key, a new key gets the next row (== the current row count)
+    fun upsert(key: Long): Int = deviceTableUpsert(handle, key)
+
+    fun find(key: Long): Int = deviceTableFind(handle, key)
+
+    fun clear() {
+        deviceTableClear(handle)
+    }
+
+    // notifies the rows changed and added since the last call, meant to run once per frame
+    fun dispatchChanges(adapter: RecyclerView.Adapter<*>) {
+        val ranges = deviceTableTakeChanges(handle, changes)
+        for (i in 0 until ranges)
+            adapter.notifyItemRangeChanged(changes[2 + 2 * i], changes[3 + 2 * i])
+        if (changes[1] > 0)
+            adapter.notifyItemRangeInserted(changes[0], changes[1])
+    }
+
+    // forgets the pending changes, for an adapter that was refreshed as a whole instead
+    fun discardChanges() {
+        deviceTableTakeChanges(handle, changes)
+    }
+
+    fun close() {
+        if (handle != 0L) {
+            deviceTableDestroy(handle)
+            handle = 0
+        }
+    }
+
+    companion object {
+        private const val MAX_RANGES = 32
+        // how long upserts are collected before the adapter is told, about one frame
+        const val FRAME_MILLIS = 16L
+        init {
+            System.loadLibrary("native-lib")
+        }
+
+        // "AA:BB:CC:DD:EE:FF" -> 0xAABBCCDDEEFF without allocating
+        fun macKey(address: String): Long {
+            var key = 0L
+            for (c in address) {
+                val digit = Character.digit(c, 16)
+                if (digit >= 0)
+                    key = key shl 4 or digit.toLong()
+            }
+            return key
+        }
+
+        // tag ids live in their own key space above the 48-bit MACs
+        fun tagKey(tagId: Long): Long = (1L shl 48) or (tagId and 0xffffffffL)
+    }
+}
+
+external fun deviceTableCreate(expectedRows: Int): Long
+external fun deviceTableDestroy(handle: Long)
+external fun deviceTableClear(handle: Long)
+external fun deviceTableUpsert(handle: Long, key: Long): Int
+external fun deviceTableFind(handle: Long, key: Long): Int
+external fun deviceTableTakeChanges(handle: Long, changes: IntArray): Int
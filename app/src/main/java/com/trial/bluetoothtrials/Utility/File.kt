@@ -2,25 +2,17 @@ package com.trial.bluetoothtrials.Utility
 
 import android.content.Context
 import android.os.Environment
-import android.util.Log
-import java.io.FileInputStream
 import java.io.IOException
-import java.io.InputStream
-import java.util.*
-import kotlin.experimental.and
-import kotlin.experimental.xor
 
-class File private constructor(inputStream: InputStream) {
+class File private constructor(val handle: Long) {
     private val DEFAULT_FILE_CHUNK_SIZE: Int=20
-    private val inputStream: InputStream?
-    var crc: Byte = 0
-        private set
-    private lateinit var bytes: ByteArray
-    private lateinit var blocks: Array<Array<ByteArray?>?>
     var fileBlockSize = 0
         private set
     private var fileChunkSize: Int = DEFAULT_FILE_CHUNK_SIZE
-    private val bytesAvailable: Int
+    // the image stays memory-mapped in native code, nothing but the handle lives on the heap
+    // bytesAvailable is what goes over the air, rawBytes the size of the file
+    private var bytesAvailable: Int = firmwareSize(handle)
+    val rawBytes: Int = bytesAvailable
     var numberOfBlocks = -1
         private set
     var chunksPerBlockCount = 0
@@ -43,75 +35,40 @@ class File private constructor(inputStream: InputStream) {
     }
 
     fun getNumberOfBytes(): Int {
-        return bytes.size
+        return bytesAvailable
+    }
+
+    // sends the LZ-block stream of the image instead of the image itself (see lz-block.h), the
+    // peripheral must know the format; false when the image would not shrink and goes out raw.
+    // Call before setFileBlockSize.
+    fun compress(): Boolean {
+        val packed = firmwareCompress(handle, COMPRESS_BLOCK_SIZE)
+        if (packed < 0) return false
+        bytesAvailable = packed
+        return true
     }
 
+    // bytes over the air per byte of image
+    val compressionRatio: Float
+        get() = if (rawBytes == 0) 1f else bytesAvailable.toFloat() / rawBytes
+
     fun setFileBlockSize(fileBlockSize: Int, fileChunkSize: Int) {
-        bytes = ByteArray(bytesAvailable)
-//        inputStream!!.read(bytes)
         this.fileBlockSize = Math.max(fileBlockSize, fileChunkSize)
         this.fileChunkSize = fileChunkSize
-        if (this.fileBlockSize > bytes.size) {
-            this.fileBlockSize = bytes.size
+        if (this.fileBlockSize > bytesAvailable) {
+            this.fileBlockSize = bytesAvailable
             if (this.fileChunkSize > this.fileBlockSize) this.fileChunkSize = this.fileBlockSize
         }
         chunksPerBlockCount = this.fileBlockSize / this.fileChunkSize + if (this.fileBlockSize % this.fileChunkSize != 0) 1 else 0
-        numberOfBlocks = bytes.size / this.fileBlockSize + if (bytes.size % this.fileBlockSize != 0) 1 else 0
+        numberOfBlocks = bytesAvailable / this.fileBlockSize + if (bytesAvailable % this.fileBlockSize != 0) 1 else 0
         initBlocks()
     }
 
-    private fun initBlocksSuota() {
-        totalChunkCount = 0
-        blocks = arrayOfNulls(numberOfBlocks)
-        var byteOffset = 0
-        // Loop through all the bytes and split them into pieces the size of the default chunk size
-        for (i in 0 until numberOfBlocks) {
-            var blockSize = fileBlockSize
-            var numberOfChunksInBlock = chunksPerBlockCount
-            // Check if the last block needs to be smaller
-            if (byteOffset + fileBlockSize > bytes.size) {
-                blockSize = bytes.size % fileBlockSize
-                numberOfChunksInBlock = blockSize / fileChunkSize + if (blockSize % fileChunkSize != 0) 1 else 0
-            }
-            var chunkNumber = 0
-            blocks[i] = arrayOfNulls(numberOfChunksInBlock)
-            var j = 0
-            while (j < blockSize) {
-
-                // Default chunk size
-                var chunkSize = fileChunkSize
-                // Last chunk in block
-                if (j + fileChunkSize > blockSize) {
-                    chunkSize = blockSize % fileChunkSize
-                }
-
-                //Log.d("chunk", "total bytes: " + bytes.length + ", offset: " + byteOffset + ", block: " + i + ", chunk: " + (chunkNumber + 1) + ", blocksize: " + blockSize + ", chunksize: " + chunkSize);
-                val chunk = Arrays.copyOfRange(bytes, byteOffset, byteOffset + chunkSize)
-                blocks[i]?.set(chunkNumber, chunk)
-                byteOffset += chunkSize
-                chunkNumber++
-                totalChunkCount++
-                j += fileChunkSize
-            }
-        }
-    }
-
     private fun initBlocksSpota() {
-
+        // chunks are views into the mapped image, only their count is kept here
         numberOfBlocks = 1
-        fileBlockSize = bytes.size
-        totalChunkCount = bytes.size / fileChunkSize + if (bytes.size % fileChunkSize != 0) 1 else 0
-        blocks = Array(numberOfBlocks) { arrayOfNulls(totalChunkCount) }
-        var byteOffset = 0
-        var chunkSize = fileChunkSize
-        for (i in 0 until totalChunkCount) {
-            if (byteOffset + fileChunkSize > bytes.size) {
-                chunkSize = bytes.size - byteOffset
-            }
-            val chunk = Arrays.copyOfRange(bytes, byteOffset, byteOffset + chunkSize)
-            blocks[0]?.set(i, chunk)
-            byteOffset += fileChunkSize
-        }
+        fileBlockSize = bytesAvailable
+        totalChunkCount = firmwareSetChunkSize(handle, fileChunkSize)
     }
 
     // Create the array of blocks using the given block size.
@@ -123,39 +80,33 @@ class File private constructor(inputStream: InputStream) {
 //        }
     }
 
-    fun getBlock(index: Int): Array<ByteArray?>? {
-        return blocks[index]
+    fun getBlockChunkCount(index: Int): Int {
+        return totalChunkCount
     }
 
-    fun close() {
-        if (inputStream != null) {
-            try {
-                inputStream.close()
-            } catch (e: IOException) {
-                e.printStackTrace()
-            }
-        }
+    fun getChunk(index: Int): ByteArray? {
+        return firmwareReadChunk(handle, index)
     }
 
-    @Throws(IOException::class)
-    private fun calculateCrc(): Byte {
-        var crc_code: Byte = 0
-        for (i in 0 until bytesAvailable) {
-            val byteValue = bytes[i]
-            val intVal = byteValue.toInt()
-            crc_code = crc_code xor intVal.toByte()
-        }
-        Log.d("crc", String.format("Fimware CRC: %#04x", crc_code and 0xff.toByte()))
-        return crc_code
+    // encrypted, length-prefixed OTA frame for the chunk, produced on demand with the session key
+    fun getFrame(session: Long, index: Int): ByteArray? {
+        return firmwareEncryptFrame(handle, session, index)
+    }
+
+    fun close() {
+        firmwareClose(handle)
     }
 
     companion object {
+        // what the peripheral has to buffer to decode a block
+        const val COMPRESS_BLOCK_SIZE = 4096
         private val filesDir = Environment.getExternalStorageDirectory().absolutePath + "/Suota"
         @Throws(IOException::class)
         fun getByFileName(filename: String): File {
-            // Get the file and store it in fileStream
-            val `is`: InputStream = FileInputStream(filename)
-            return File(`is`)
+            // Map the file natively instead of reading it onto the heap
+            val handle = firmwareOpen(filename)
+            if (handle == 0L) throw IOException("Unable to open $filename")
+            return File(handle)
         }
 //
 //        fun list(): ArrayList<String>? {
@@ -187,9 +138,12 @@ class File private constructor(inputStream: InputStream) {
             return directory.exists() || directory.mkdirs()
         }
     }
-
-    init {
-        this.inputStream = inputStream
-        bytesAvailable = this.inputStream.available()
-    }
 }
+
+external fun firmwareOpen(path: String): Long
+external fun firmwareClose(handle: Long)
+external fun firmwareSize(handle: Long): Int
+external fun firmwareCompress(handle: Long, blockSize: Int): Int
+external fun firmwareSetChunkSize(handle: Long, chunkSize: Int): Int
+external fun firmwareReadChunk(handle: Long, index: Int): ByteArray?
+external fun firmwareEncryptFrame(handle: Long, session: Long, index: Int): ByteArray?
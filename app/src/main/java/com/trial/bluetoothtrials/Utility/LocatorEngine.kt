@@ -0,0 +1,87 @@
+package com.trial.bluetoothtrials.Utility
+
+import android.content.Context
+import java.nio.ByteBuffer
+
+// smoothed locator distances, trilaterated positions and debounced zones per tag, see
+// locator-engine.h; fed with the reports of every scan batch, or replayed from a LogStore
+class LocatorEngine private constructor(private var handle: Long) {
+
+    fun place(locatorId: Long, xMetres: Float, yMetres: Float) {
+        locatorEnginePlace(handle, locatorId, xMetres * 100, yMetres * 100)
+    }
+
+    // every locator of a LAYOUT_KEY string; malformed entries are skipped, locators it does
+    // not name keep their position
+    fun placeAll(layout: String) {
+        for (entry in layout.split(';')) {
+            val parts = entry.trim().split(':')
+            if (parts.size != 3) continue
+            val id = parts[0].toLongOrNull(16) ?: continue
+            val x = parts[1].toFloatOrNull() ?: continue
+            val y = parts[2].toFloatOrNull() ?: continue
+            place(id, x, y)
+        }
+    }
+
+    // reports as beaconParseBatch wrote them, timestamps (elapsed realtime ns) per report;
+    // one FIX_SIZE fix per report goes to fixes, direct and in native order
+    fun update(reports: ByteBuffer, count: Int, timestamps: LongArray, fixes: ByteBuffer): Int =
+        locatorEngineUpdate(handle, reports, count, timestamps, fixes)
+
+    // feeds every stored record, tags in parallel; returns the number of reports
+    fun replay(store: LogStore): Int = locatorEngineReplay(handle, store.handle)
+
+    // zone, has position, x, y, residual (cm), reports, fixes, failures, transitions, then the
+    // ns spent inside, outside and failing; null for a tag never reported
+    fun tagState(tagId: Long): DoubleArray? = locatorEngineTagState(handle, tagId)
+
+    fun close() {
+        if (handle != 0L) {
+            locatorEngineDestroy(handle)
+            handle = 0
+        }
+    }
+
+    companion object {
+        const val FILTER_KALMAN = 0
+        const val FILTER_MEDIAN = 1
+        const val ZONE_UNKNOWN = 0
+        const val ZONE_INSIDE = 1
+        const val ZONE_OUTSIDE = 2
+        const val ZONE_FAILURE = 3
+        const val FIX_SIZE = 48
+        // offsets inside a fix
+        const val FIX_TIMESTAMP = 0
+        const val FIX_TAG_ID = 8
+        const val FIX_DISTANCES = 16
+        const val FIX_X = 28
+        const val FIX_Y = 32
+        const val FIX_RESIDUAL = 36
+        const val FIX_HAS_POSITION = 40
+        const val FIX_ZONE = 41
+        const val FIX_PREVIOUS_ZONE = 42
+        const val FIX_TRANSITION = 43
+        // "A101:0:0;A102:12.5:0;A103:0:8" - locator id in hex and its position in metres;
+        // set from the logger scan screen with a long press on the scan button
+        const val LAYOUT_KEY = "locatorLayout"
+
+        init {
+            System.loadLibrary("native-lib")
+        }
+
+        fun create(context: Context, filter: Int = FILTER_KALMAN): LocatorEngine {
+            val engine = LocatorEngine(locatorEngineCreate(filter))
+            engine.placeAll(PreferenceController.instance!!.getKeyString(context, LAYOUT_KEY))
+            return engine
+        }
+    }
+}
+
+external fun locatorEngineCreate(filter: Int): Long
+external fun locatorEngineDestroy(handle: Long)
+external fun locatorEnginePlace(handle: Long, locatorId: Long, x: Float, y: Float)
+external fun locatorEngineUpdate(handle: Long, reports: ByteBuffer, count: Int, timestamps: LongArray,
+                                 fixes: ByteBuffer): Int
+external fun locatorEngineReplay(handle: Long, store: Long): Int
+external fun locatorEngineTagState(handle: Long, tagId: Long): DoubleArray?
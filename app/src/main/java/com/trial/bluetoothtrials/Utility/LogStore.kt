@@ -0,0 +1,81 @@
+package com.trial.bluetoothtrials.Utility
+
+import android.content.Context
+import java.nio.ByteBuffer
+import java.util.concurrent.ExecutorService
+import java.util.concurrent.Executors
+
+// per-tag scan history kept natively as binary records, see log-store.h
+// one store lives for the whole scanning session and is shared by the scan and log screens
+class LogStore private constructor(internal val handle: Long) {
+
+    // returns the tag's row or -1 when the record was not stored
+    fun append(tagId: Long, timestampNs: Long, rssi: Int, payload: ByteArray): Int =
+        logStoreAppend(handle, tagId, timestampNs, rssi, payload)
+
+    fun findTag(tagId: Long): Int = logStoreFindTag(handle, tagId)
+
+    fun tagCount(): Int = logStoreTagCount(handle)
+
+    fun recordCount(tag: Int): Int = logStoreRecordCount(handle, tag)
+
+    // copies records [index, index + count) of tag (0 = oldest) into records and their decoded
+    // beacon reports into reports, both direct and in native order; returns the number read
+    fun readPage(tag: Int, index: Int, count: Int, records: ByteBuffer, reports: ByteBuffer): Int =
+        logStoreReadPage(handle, tag, index, count, records, reports)
+
+    // writes every kept record to path for host/log-replay; returns the record count or -1
+    fun export(path: String): Long = logStoreExport(handle, path)
+
+    companion object {
+        const val RECORD_SIZE = 72
+        // offsets inside a record
+        const val RECORD_TIMESTAMP = 0
+        const val RECORD_RSSI = 8
+        // arena for the newest history, older pages spill to a file in the cache directory
+        private const val MEMORY_CAP = 8L * 1024 * 1024
+        private var shared: LogStore? = null
+        // exports and closes ended sessions off the main thread, in the order they ended
+        private val closer: ExecutorService = Executors.newSingleThreadExecutor()
+
+        init {
+            System.loadLibrary("native-lib")
+        }
+
+        fun session(context: Context): LogStore {
+            shared?.let { return it }
+            val spill = java.io.File(context.cacheDir, "scan-log.spill").absolutePath
+            var handle = logStoreOpen(MEMORY_CAP, spill)
+            if (handle == 0L)
+                handle = logStoreOpen(MEMORY_CAP, null)
+            val store = LogStore(handle)
+            shared = store
+            return store
+        }
+
+        // ends the session, the next session() starts an empty store; when exportDir is given
+        // the history is written there first as scan-<time>.btlog. Both happen in the
+        // background, the old store stays open until its export is written
+        fun closeSession(exportDir: java.io.File? = null) {
+            shared?.let { store ->
+                val name = "scan-${System.currentTimeMillis()}.btlog"
+                closer.execute {
+                    if (exportDir != null && store.tagCount() > 0)
+                        store.export(java.io.File(exportDir, name).absolutePath)
+                    logStoreClose(store.handle)
+                }
+            }
+            shared = null
+        }
+    }
+}
+
+external fun logStoreOpen(memoryCap: Long, spillPath: String?): Long
+external fun logStoreClose(handle: Long)
+external fun logStoreAppend(handle: Long, tagId: Long, timestampNs: Long, rssi: Int, payload: ByteArray): Int
+external fun logStoreExport(handle: Long, path: String): Long
+external fun logStoreFindTag(handle: Long, tagId: Long): Int
+external fun logStoreTagCount(handle: Long): Int
+external fun logStoreRecordCount(handle: Long, tag: Int): Int
+external fun logStoreReadPage(handle: Long, tag: Int, index: Int, count: Int, records: ByteBuffer,
+                              reports: ByteBuffer): Int
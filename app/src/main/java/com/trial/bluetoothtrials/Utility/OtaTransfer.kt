@@ -0,0 +1,61 @@
+package com.trial.bluetoothtrials.Utility
+
+// windowed OTA sender over the mapped image and an rc5 session, see ota-transfer.h
+// next() hands out frames while credits last; every onCharacteristicWrite for the OTA
+// characteristic is one complete() and a failed writeCharacteristic is refused()
+class OtaTransfer private constructor(private var handle: Long, val chunkCount: Int) {
+
+    fun next(): ByteArray? = otaTransferNext(handle)
+
+    fun refused() {
+        otaTransferRefused(handle)
+    }
+
+    // DONE, FAILED, or the number of frames still outstanding
+    fun complete(status: Int): Int = otaTransferComplete(handle, status)
+
+    // fails the transfer when the oldest frame has waited longer than the timeout
+    fun poll(): Int = otaTransferPoll(handle)
+
+    fun completed(): Int = otaTransferCompleted(handle)
+
+    // CRC-32 (little endian) and AES-CMAC of the payload, IMAGE_DIGEST_SIZE bytes; null until
+    // every chunk has been sent or when the transfer was created without a key
+    fun digest(): ByteArray? = otaTransferDigest(handle)
+
+    // chunks, completed, retransmits, refusals, elapsed ns, latency min/mean/p95/max ns
+    fun stats(): LongArray = otaTransferStats(handle)
+
+    fun close() {
+        if (handle != 0L) {
+            otaTransferDestroy(handle)
+            handle = 0
+        }
+    }
+
+    companion object {
+        const val DONE = -2
+        const val FAILED = -3
+        private const val MAX_ATTEMPTS = 5
+        const val TIMEOUT_MS = 5000
+        const val IMAGE_DIGEST_SIZE = 20
+
+        // null when a frame would not fit in the ATT MTU; the digest is built while sending
+        // when a 16 byte digestKey is given
+        fun create(file: File, session: Long, window: Int, mtu: Int, digestKey: ByteArray?): OtaTransfer? {
+            val handle = otaTransferCreate(file.handle, session, window, MAX_ATTEMPTS, TIMEOUT_MS, mtu - 3, digestKey)
+            return if (handle != 0L) OtaTransfer(handle, file.totalChunkCount) else null
+        }
+    }
+}
+
+external fun otaTransferCreate(image: Long, session: Long, window: Int, maxAttempts: Int, timeoutMs: Int,
+                               maxFrame: Int, digestKey: ByteArray?): Long
+external fun otaTransferDestroy(handle: Long)
+external fun otaTransferNext(handle: Long): ByteArray?
+external fun otaTransferRefused(handle: Long)
+external fun otaTransferComplete(handle: Long, status: Int): Int
+external fun otaTransferPoll(handle: Long): Int
+external fun otaTransferCompleted(handle: Long): Int
+external fun otaTransferStats(handle: Long): LongArray
+external fun otaTransferDigest(handle: Long): ByteArray?
@@ -0,0 +1,44 @@
+package com.trial.bluetoothtrials.Utility
+
+// native hot-path counters and latency histograms, see probe.h
+// native-lib and aes-lib each record into their own registry; every call here merges both, so
+// one snapshot shows JNI crossings, cipher time and OTA round trips side by side
+object Probes {
+    const val JNI = 0
+    const val AES_ENCRYPT = 1
+    const val AES_DECRYPT = 2
+    const val AES_MODE = 3
+    const val RC5_ENCRYPT = 4
+    const val RC5_DECRYPT = 5
+    const val BEACON_PARSE = 6
+    const val OTA_RTT = 7
+    const val COUNT = 8
+    const val BUCKETS = 32
+    // per probe in snapshot(): calls, bytes, total ns, max ns, then BUCKETS counts where bucket b
+    // holds latencies in [2^b, 2^(b+1)) ns
+    const val FIELDS = 4 + BUCKETS
+
+    init {
+        System.loadLibrary("native-lib")
+        System.loadLibrary("aes-lib")
+    }
+
+    private fun registries(): LongArray = longArrayOf(aesProbeRegistry())
+
+    fun snapshot(): LongArray = probeSnapshot(registries())
+
+    fun calls(snapshot: LongArray, probe: Int): Long = snapshot[probe * FIELDS]
+
+    fun totalNs(snapshot: LongArray, probe: Int): Long = snapshot[probe * FIELDS + 2]
+
+    // counters, mean and p50/p95/p99 per probe, for logs and bug reports
+    fun json(): String = probeExportJson(registries())
+
+    // "PRB1" trace with the raw histograms, see probe_export_binary
+    fun binary(): ByteArray = probeExportBinary(registries())
+}
+
+external fun aesProbeRegistry(): Long
+external fun probeSnapshot(registries: LongArray?): LongArray
+external fun probeExportJson(registries: LongArray?): String
+external fun probeExportBinary(registries: LongArray?): ByteArray